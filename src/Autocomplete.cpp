@@ -0,0 +1,411 @@
+#include "pch.h"
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <memory>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "PluginSession.hpp"
+#include "Ui.hpp"
+#include "Autocomplete.hpp"
+
+constexpr size_t MAX_COMPLETIONS = 30;
+
+// Synonyms are fetched last so a table or view of the same name keeps its own kind after deduplication
+const char* const OBJECT_IDENTIFIERS_SQL = "select object_name, object_type from all_objects "
+    "where object_type in ('TABLE', 'VIEW', 'SYNONYM', 'PACKAGE', 'PROCEDURE', 'FUNCTION', 'TYPE', 'SEQUENCE') "
+    "order by decode(object_type, 'SYNONYM', 1, 0)";
+const char* const SUBPROGRAM_IDENTIFIERS_SQL = "select distinct procedure_name from all_procedures where procedure_name is not null";
+const char* const COLUMN_IDENTIFIERS_SQL = "select distinct column_name from all_tab_columns";
+
+IdentifierIndex schemaIdentifiers;
+bool schemaIdentifiersLoaded = false;
+
+inline char foldIdentifierChar(char c)
+{
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+std::string foldIdentifier(std::string_view name)
+{
+    std::string folded(name);
+    for (auto& c : folded)
+        c = foldIdentifierChar(c);
+    return folded;
+}
+
+// Same as fuzzyMatchScore, for arguments that are already folded. Each query character is located
+// with memchr, which keeps the scan over thousands of candidates cheap.
+int fuzzyMatchScoreFolded(std::string_view foldedQuery, std::string_view foldedCandidate)
+{
+    const char* candidateStart = foldedCandidate.data();
+    const char* candidateEnd = candidateStart + foldedCandidate.size();
+    const char* searchFrom = candidateStart;
+    const char* previousMatch = NULL;
+
+    int score = 0;
+    for (char queryChar : foldedQuery)
+    {
+        auto match = static_cast<const char*>(std::memchr(searchFrom, queryChar, candidateEnd - searchFrom));
+        if (match == NULL)
+            return -1;
+
+        score += 1;
+        if (previousMatch != NULL && match == previousMatch + 1)
+            score += 5;
+        if (match == candidateStart || match[-1] == '_')
+            score += 3;
+
+        previousMatch = match;
+        searchFrom = match + 1;
+    }
+
+    return score * 4 - static_cast<int>(foldedCandidate.size());
+}
+
+uint32_t identifierCharMask(std::string_view name)
+{
+    uint32_t mask = 0;
+    for (char c : name)
+    {
+        if (c >= 'A' && c <= 'Z')
+            mask |= 1u << (c - 'A');
+        else if (c >= '0' && c <= '9')
+            mask |= 1u << 26;
+        else if (c == '_')
+            mask |= 1u << 27;
+        else if (c == '$')
+            mask |= 1u << 28;
+        else if (c == '#')
+            mask |= 1u << 29;
+        else
+            mask |= 1u << 30;
+    }
+    return mask;
+}
+
+const char* identifierKindName(IdentifierKind kind)
+{
+    switch (kind)
+    {
+    case IdentifierKind::Table:
+        return "table";
+    case IdentifierKind::View:
+        return "view";
+    case IdentifierKind::Synonym:
+        return "synonym";
+    case IdentifierKind::Package:
+        return "package";
+    case IdentifierKind::Procedure:
+        return "procedure";
+    case IdentifierKind::Function:
+        return "function";
+    case IdentifierKind::Type:
+        return "type";
+    case IdentifierKind::Sequence:
+        return "sequence";
+    case IdentifierKind::Column:
+        return "column";
+    }
+
+    return "";
+}
+
+void IdentifierIndex::clear()
+{
+    names.clear();
+    foldedNames.clear();
+    entries.clear();
+    nodes.clear();
+}
+
+void IdentifierIndex::add(std::string_view name, IdentifierKind kind)
+{
+    if (name.empty() || name.size() > UINT16_MAX)
+        return;
+
+    Entry entry;
+    entry.nameOffset = static_cast<uint32_t>(names.size());
+    entry.nameLength = static_cast<uint16_t>(name.size());
+    entry.kind = kind;
+    names.insert(names.end(), name.begin(), name.end());
+    for (char c : name)
+        foldedNames.push_back(foldIdentifierChar(c));
+    entry.charMask = identifierCharMask(entryFoldedName(entry));
+    entries.push_back(entry);
+}
+
+void IdentifierIndex::build()
+{
+    std::stable_sort(entries.begin(), entries.end(), [this](const Entry& a, const Entry& b) {
+        return entryFoldedName(a) < entryFoldedName(b);
+    });
+    entries.erase(std::unique(entries.begin(), entries.end(), [this](const Entry& a, const Entry& b) {
+        return entryFoldedName(a) == entryFoldedName(b);
+    }), entries.end());
+    entries.shrink_to_fit();
+
+    nodes.clear();
+    nodes.push_back({ 0, 0, 0, static_cast<uint32_t>(entries.size()), '\0' });
+    buildTrie(0, 0);
+}
+
+void IdentifierIndex::buildTrie(uint32_t nodeIndex, size_t depth)
+{
+    if (depth == TRIE_DEPTH)
+        return;
+
+    // Node 0 is the root, which is never anyone's child, so 0 also means "no node"
+    uint32_t previousChild = 0;
+    uint32_t i = nodes[nodeIndex].rangeBegin;
+    uint32_t end = nodes[nodeIndex].rangeEnd;
+    while (i < end)
+    {
+        // Names exactly as long as the node prefix sort first within its range and have no child
+        if (entries[i].nameLength <= depth)
+        {
+            i++;
+            continue;
+        }
+
+        char label = entryFoldedName(entries[i])[depth];
+        uint32_t groupEnd = i + 1;
+        while (groupEnd < end && entryFoldedName(entries[groupEnd])[depth] == label)
+            groupEnd++;
+
+        auto child = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({ 0, 0, i, groupEnd, label });
+        if (previousChild != 0)
+            nodes[previousChild].nextSibling = child;
+        else
+            nodes[nodeIndex].firstChild = child;
+        previousChild = child;
+
+        buildTrie(child, depth + 1);
+        i = groupEnd;
+    }
+}
+
+bool IdentifierIndex::findPrefixRange(std::string_view foldedPrefix, uint32_t& rangeBegin, uint32_t& rangeEnd) const
+{
+    if (nodes.empty())
+        return false;
+
+    uint32_t node = 0;
+    size_t depth = 0;
+    while (depth < foldedPrefix.size() && depth < TRIE_DEPTH)
+    {
+        char label = foldedPrefix[depth];
+        uint32_t child = nodes[node].firstChild;
+        while (child != 0 && nodes[child].label != label)
+            child = nodes[child].nextSibling;
+
+        if (child == 0)
+            return false;
+
+        node = child;
+        depth++;
+    }
+
+    rangeBegin = nodes[node].rangeBegin;
+    rangeEnd = nodes[node].rangeEnd;
+
+    if (depth < foldedPrefix.size())
+    {
+        auto first = entries.begin() + rangeBegin;
+        auto last = entries.begin() + rangeEnd;
+        first = std::lower_bound(first, last, foldedPrefix, [this](const Entry& entry, std::string_view value) {
+            return entryFoldedName(entry) < value;
+        });
+        last = std::upper_bound(first, last, foldedPrefix, [this](std::string_view value, const Entry& entry) {
+            return value < entryFoldedName(entry).substr(0, value.size());
+        });
+        rangeBegin = static_cast<uint32_t>(first - entries.begin());
+        rangeEnd = static_cast<uint32_t>(last - entries.begin());
+    }
+
+    return rangeBegin < rangeEnd;
+}
+
+void IdentifierIndex::findCompletions(std::string_view query, size_t maxResults, std::vector<Completion>& results) const
+{
+    results.clear();
+    if (query.empty() || maxResults == 0)
+        return;
+
+    auto foldedQuery = foldIdentifier(query);
+
+    uint32_t prefixBegin = 0, prefixEnd = 0;
+    if (findPrefixRange(foldedQuery, prefixBegin, prefixEnd))
+    {
+        for (uint32_t i = prefixBegin; i < prefixEnd && results.size() < maxResults; i++)
+            results.push_back({ entryName(entries[i]), entries[i].kind });
+    }
+
+    if (results.size() >= maxResults || query.size() < 2)
+        return;
+
+    uint32_t candidatesBegin, candidatesEnd;
+    if (!findPrefixRange(std::string_view(foldedQuery).substr(0, 1), candidatesBegin, candidatesEnd))
+        return;
+
+    uint32_t queryMask = identifierCharMask(foldedQuery);
+    std::vector<std::pair<int, uint32_t>> scored;
+    for (uint32_t i = candidatesBegin; i < candidatesEnd; i++)
+    {
+        if (i >= prefixBegin && i < prefixEnd)
+            continue;
+
+        if ((entries[i].charMask & queryMask) != queryMask)
+            continue;
+
+        int score = fuzzyMatchScoreFolded(foldedQuery, entryFoldedName(entries[i]));
+        if (score >= 0)
+            scored.emplace_back(score, i);
+    }
+
+    size_t fuzzyCount = std::min(maxResults - results.size(), scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + fuzzyCount, scored.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    for (size_t i = 0; i < fuzzyCount; i++)
+    {
+        const Entry& entry = entries[scored[i].second];
+        results.push_back({ entryName(entry), entry.kind });
+    }
+}
+
+int fuzzyMatchScore(std::string_view query, std::string_view candidate)
+{
+    return fuzzyMatchScoreFolded(foldIdentifier(query), foldIdentifier(candidate));
+}
+
+IdentifierKind objectTypeToIdentifierKind(std::string_view objectType)
+{
+    if (objectType == "TABLE")
+        return IdentifierKind::Table;
+    if (objectType == "VIEW")
+        return IdentifierKind::View;
+    if (objectType == "PACKAGE")
+        return IdentifierKind::Package;
+    if (objectType == "PROCEDURE")
+        return IdentifierKind::Procedure;
+    if (objectType == "FUNCTION")
+        return IdentifierKind::Function;
+    if (objectType == "TYPE")
+        return IdentifierKind::Type;
+    if (objectType == "SEQUENCE")
+        return IdentifierKind::Sequence;
+    return IdentifierKind::Synonym;
+}
+
+bool loadSchemaIdentifiers()
+{
+    if (!IDE_Connected())
+        return false;
+
+    IDE_SplashCreate(0);
+    IDE_SplashWriteLn("Loading schema identifiers...");
+
+    schemaIdentifiers.clear();
+    bool success;
+    {
+        PluginSession session;
+        success = session.isOpen()
+            && queryRows(OBJECT_IDENTIFIERS_SQL, [] {
+                schemaIdentifiers.add(SQL_Field(0), objectTypeToIdentifierKind(SQL_Field(1)));
+            })
+            && queryRows(SUBPROGRAM_IDENTIFIERS_SQL, [] {
+                schemaIdentifiers.add(SQL_Field(0), IdentifierKind::Procedure);
+            })
+            && queryRows(COLUMN_IDENTIFIERS_SQL, [] {
+                schemaIdentifiers.add(SQL_Field(0), IdentifierKind::Column);
+            });
+    }
+
+    IDE_SplashHide();
+
+    // Left unloaded, so the next completion tries again
+    if (!success)
+    {
+        schemaIdentifiers.clear();
+        IDE_SetStatusMessage("Can't load the schema identifiers");
+        MessageBeep(MB_OK);
+        return false;
+    }
+    schemaIdentifiers.build();
+
+    schemaIdentifiersLoaded = true;
+    return true;
+}
+
+void resetSchemaIdentifiers()
+{
+    schemaIdentifiers.clear();
+    schemaIdentifiersLoaded = false;
+}
+
+void completeIdentifier()
+{
+    if (!IDE_WindowHasEditor(false) || IDE_GetReadOnly())
+        return;
+
+    if (!schemaIdentifiersLoaded && !loadSchemaIdentifiers())
+        return;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+
+    int currLine = SendMessage(editorWindow, EM_LINEFROMCHAR, selectionEnd, NULL);
+    int currLineCharIndex = SendMessage(editorWindow, EM_LINEINDEX, currLine, NULL);
+    int currLineLength = SendMessage(editorWindow, EM_LINELENGTH, currLineCharIndex, NULL);
+
+    if (currLineLength == 0)
+        return;
+
+    auto lineBuffer = std::make_unique<EDITOR_CHAR[]>(currLineLength);
+    lineBuffer[0] = currLineLength;
+    SendMessage(editorWindow, EM_GETLINE, currLine, reinterpret_cast<WPARAM>(lineBuffer.get()));
+
+    int caretX = selectionEnd - currLineCharIndex;
+    int wordStartX = findWordStart(lineBuffer.get(), caretX);
+    if (wordStartX == caretX)
+        return;
+
+    auto prefix = EditorStringView(lineBuffer.get() + wordStartX, caretX - wordStartX);
+
+    std::vector<Completion> completions;
+    schemaIdentifiers.findCompletions(toAnsiString(prefix), MAX_COMPLETIONS, completions);
+    if (completions.empty())
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    size_t picked = 0;
+    if (completions.size() > 1)
+    {
+        std::vector<std::wstring> items;
+        items.reserve(completions.size());
+        for (auto& completion : completions)
+            items.push_back(toEditorString(completion.name) + EDT_TX('\t') + toEditorString(identifierKindName(completion.kind)));
+
+        int pickedItem = showPopupList(editorWindow, getCharScreenPosition(editorWindow, selectionEnd), items);
+        if (pickedItem < 0)
+            return;
+        picked = pickedItem;
+    }
+
+    auto replacement = toEditorString(completions[picked].name);
+
+    // Keep the user's casing style when they type identifiers in lowercase
+    bool typedLowerCase = std::any_of(prefix.begin(), prefix.end(), [](EDITOR_CHAR c) { return std::iswlower(c); })
+        && std::none_of(prefix.begin(), prefix.end(), [](EDITOR_CHAR c) { return std::iswupper(c); });
+    if (typedLowerCase)
+        std::transform(replacement.begin(), replacement.end(), replacement.begin(), [](EDITOR_CHAR c) { return static_cast<EDITOR_CHAR>(std::towlower(c)); });
+
+    SendMessage(editorWindow, EM_SETSEL, currLineCharIndex + wordStartX, selectionEnd);
+    SendMessage(editorWindow, EM_REPLACESEL, TRUE, reinterpret_cast<LPARAM>(replacement.c_str()));
+}
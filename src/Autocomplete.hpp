@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class IdentifierKind : uint8_t
+{
+    Table,
+    View,
+    Synonym,
+    Package,
+    Procedure,
+    Function,
+    Type,
+    Sequence,
+    Column,
+};
+
+const char* identifierKindName(IdentifierKind kind);
+
+struct Completion
+{
+    std::string_view name;
+    IdentifierKind kind;
+};
+
+// Index of schema identifiers answering prefix and fuzzy (subsequence) queries.
+//
+// Names are kept in one arena next to an uppercase copy used for matching, sorted by the latter. The first TRIE_DEPTH characters are
+// indexed by a small trie whose nodes hold the range of sorted entries sharing that prefix;
+// longer prefixes are narrowed with a binary search inside that range. Fuzzy matching only
+// scans entries sharing the first character and skips candidates whose character set can't
+// contain the query, so both lookups stay well below a millisecond for 500k identifiers.
+class IdentifierIndex
+{
+public:
+    void clear();
+    void add(std::string_view name, IdentifierKind kind);
+    // Must be called after adding identifiers and before querying.
+    void build();
+
+    size_t size() const { return entries.size(); }
+
+    // Query is matched case-insensitively; prefix matches come first, then fuzzy matches by score.
+    void findCompletions(std::string_view query, size_t maxResults, std::vector<Completion>& results) const;
+
+private:
+    static constexpr size_t TRIE_DEPTH = 4;
+
+    struct Entry
+    {
+        uint32_t nameOffset;
+        uint16_t nameLength;
+        IdentifierKind kind;
+        uint32_t charMask;
+    };
+
+    struct TrieNode
+    {
+        uint32_t firstChild;
+        uint32_t nextSibling;
+        uint32_t rangeBegin;
+        uint32_t rangeEnd;
+        char label;
+    };
+
+    std::string_view entryName(const Entry& entry) const { return std::string_view(names.data() + entry.nameOffset, entry.nameLength); }
+    std::string_view entryFoldedName(const Entry& entry) const { return std::string_view(foldedNames.data() + entry.nameOffset, entry.nameLength); }
+    void buildTrie(uint32_t nodeIndex, size_t depth);
+    bool findPrefixRange(std::string_view foldedPrefix, uint32_t& rangeBegin, uint32_t& rangeEnd) const;
+
+    std::vector<char> names;
+    std::vector<char> foldedNames;
+    std::vector<Entry> entries;
+    std::vector<TrieNode> nodes;
+};
+
+// Scores how well query matches candidate as a case-insensitive subsequence, or returns -1 if it
+// doesn't. Consecutive characters and characters at word starts (after '_') score higher.
+int fuzzyMatchScore(std::string_view query, std::string_view candidate);
+
+void resetSchemaIdentifiers();
+void completeIdentifier();
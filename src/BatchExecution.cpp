@@ -0,0 +1,469 @@
+#include "pch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "FileUtils.hpp"
+#include "PlSqlLexer.hpp"
+#include "Plugin.hpp"
+#include "StatementTimings.hpp"
+#include "Ui.hpp"
+#include "BatchExecution.hpp"
+
+constexpr auto BATCH_SIZE_PREFERENCE = "BatchExecutionSize";
+constexpr auto DEFAULT_BATCH_SIZE = 500;
+// All values of a column in a batch travel in one varchar2 bind, which PL/SQL limits to 32767 bytes
+// in the database character set
+constexpr size_t MAX_PACKED_VALUES_LENGTH = 32000;
+// Bytes a non-ASCII byte of the client's ANSI text may take in the database character set: ANSI
+// code pages only hold characters that take at most 3 bytes in AL32UTF8
+constexpr size_t MAX_NON_ASCII_BYTE_LENGTH = 3;
+// Terminates each packed value, matches chr(30) in the generated block
+constexpr char PACKED_VALUE_TERMINATOR = '\x1e';
+
+struct BindTable
+{
+    std::vector<std::string> columnNames;
+    // Row-major cell texts
+    std::vector<std::string> cells;
+    size_t columnCount = 0;
+
+    size_t rowCount() const { return columnCount > 0 ? cells.size() / columnCount : 0; }
+    const std::string& cell(size_t row, size_t column) const { return cells[row * columnCount + column]; }
+};
+
+struct BatchStatement
+{
+    // DML with every bind variable replaced by an element of its value collection
+    std::string dml;
+    // Uppercase, in order of first appearance
+    std::vector<std::string> bindNames;
+};
+
+std::string toUpperAscii(std::string_view text)
+{
+    std::string result(text);
+    for (auto& c : result)
+        c = toUpperAsciiChar(c);
+    return result;
+}
+
+std::string_view trimStatementTerminators(std::string_view sql)
+{
+    auto trimWhitespace = [](std::string_view text) {
+        while (!text.empty() && BasicPlSqlLexer<char>::isWhitespace(text.back()))
+            text.remove_suffix(1);
+        return text;
+    };
+
+    sql = trimWhitespace(sql);
+    if (!sql.empty() && sql.back() == '/')
+        sql = trimWhitespace(sql.substr(0, sql.size() - 1));
+    if (!sql.empty() && sql.back() == ';')
+        sql = trimWhitespace(sql.substr(0, sql.size() - 1));
+    return sql;
+}
+
+bool prepareBatchStatement(std::string_view sql, BatchStatement& statement, std::wstring& error)
+{
+    sql = trimStatementTerminators(sql);
+
+    BasicPlSqlLexer<char> lexer(sql.data(), sql.size());
+    Token token;
+    bool firstToken = true;
+    size_t copiedUpTo = 0;
+    while (lexer.next(token))
+    {
+        if (token.type == TokenType::Comment)
+            continue;
+
+        if (firstToken)
+        {
+            firstToken = false;
+            if (!tokenEquals(sql.data(), token, "INSERT") && !tokenEquals(sql.data(), token, "UPDATE")
+                && !tokenEquals(sql.data(), token, "DELETE") && !tokenEquals(sql.data(), token, "MERGE"))
+            {
+                error = L"Batch execution needs a single INSERT, UPDATE, DELETE or MERGE statement.";
+                return false;
+            }
+        }
+
+        if (token.type != TokenType::BindVariable)
+            continue;
+
+        auto name = toUpperAscii(sql.substr(token.offset + 1, token.length - 1));
+        auto bind = std::find(statement.bindNames.begin(), statement.bindNames.end(), name);
+        size_t bindIndex = bind - statement.bindNames.begin();
+        if (bind == statement.bindNames.end())
+            statement.bindNames.push_back(name);
+
+        statement.dml.append(sql.substr(copiedUpTo, token.offset - copiedUpTo));
+        statement.dml += "v_" + std::to_string(bindIndex + 1) + "(i)";
+        copiedUpTo = token.offset + token.length;
+    }
+    statement.dml.append(sql.substr(copiedUpTo));
+
+    if (statement.bindNames.empty())
+    {
+        error = L"The statement has no bind variables to fill from the bind source.";
+        return false;
+    }
+
+    return true;
+}
+
+// The block receives each column as one packed bind, unpacks them into index-by tables and runs
+// the DML once for all rows with FORALL
+std::string buildBatchBlock(const BatchStatement& statement)
+{
+    std::ostringstream block;
+    block << "declare\n"
+        << "  type value_list is table of varchar2(32767) index by pls_integer;\n";
+    for (size_t i = 0; i < statement.bindNames.size(); i++)
+        block << "  v_" << i + 1 << " value_list;\n";
+    block << "  procedure unpack(p_values in varchar2, p_list in out nocopy value_list) is\n"
+        << "    l_start pls_integer := 1;\n"
+        << "    l_end pls_integer;\n"
+        << "  begin\n"
+        << "    loop\n"
+        << "      l_end := instr(p_values, chr(30), l_start);\n"
+        << "      exit when nvl(l_end, 0) = 0;\n"
+        << "      p_list(p_list.count + 1) := substr(p_values, l_start, l_end - l_start);\n"
+        << "      l_start := l_end + 1;\n"
+        << "    end loop;\n"
+        << "  end;\n"
+        << "begin\n";
+    for (size_t i = 0; i < statement.bindNames.size(); i++)
+        block << "  unpack(:b" << i + 1 << ", v_" << i + 1 << ");\n";
+    block << "  forall i in 1 .. v_1.count\n"
+        << "    " << statement.dml << ";\n"
+        << "  :row_count := sql%rowcount;\n"
+        << "end;";
+    return block.str();
+}
+
+// Binds are matched to columns by name when the source has a header, otherwise by position
+bool mapBindsToColumns(const BatchStatement& statement, const BindTable& table, std::vector<size_t>& bindColumns, std::wstring& error)
+{
+    bindColumns.clear();
+    for (auto& bindName : statement.bindNames)
+    {
+        auto column = std::find_if(table.columnNames.begin(), table.columnNames.end(), [&](const std::string& columnName) {
+            return toUpperAscii(columnName) == bindName;
+        });
+        if (column == table.columnNames.end())
+            break;
+        bindColumns.push_back(column - table.columnNames.begin());
+    }
+
+    if (bindColumns.size() == statement.bindNames.size())
+        return true;
+
+    if (statement.bindNames.size() > table.columnCount)
+    {
+        error = L"The statement has " + std::to_wstring(statement.bindNames.size()) + L" bind variables but the bind source only has "
+            + std::to_wstring(table.columnCount) + L" columns.";
+        return false;
+    }
+
+    bindColumns.clear();
+    for (size_t i = 0; i < statement.bindNames.size(); i++)
+        bindColumns.push_back(i);
+    return true;
+}
+
+// Length of the value in the database character set at worst, ASCII being the same in all of them
+size_t getBoundLength(std::string_view value)
+{
+    size_t nonAsciiCount = std::count_if(value.begin(), value.end(), [](char c) { return static_cast<unsigned char>(c) >= 0x80; });
+    return value.size() + nonAsciiCount * (MAX_NON_ASCII_BYTE_LENGTH - 1);
+}
+
+// Splits rows into batches of at most batchSize rows whose packed values fit into one bind
+bool planBatches(const BindTable& table, const std::vector<size_t>& bindColumns, size_t batchSize, std::vector<size_t>& batchStarts, std::wstring& error)
+{
+    std::vector<size_t> packedLengths(bindColumns.size(), 0);
+    std::vector<size_t> rowLengths(bindColumns.size(), 0);
+    size_t batchRows = 0;
+    batchStarts.assign(1, 0);
+
+    for (size_t row = 0; row < table.rowCount(); row++)
+    {
+        bool startNewBatch = batchRows == batchSize;
+        for (size_t i = 0; i < bindColumns.size(); i++)
+        {
+            auto& value = table.cell(row, bindColumns[i]);
+            rowLengths[i] = getBoundLength(value) + 1;
+            if (rowLengths[i] > MAX_PACKED_VALUES_LENGTH || value.find(PACKED_VALUE_TERMINATOR) != std::string::npos)
+            {
+                error = L"The value in row " + std::to_wstring(row + 1) + L", column " + std::to_wstring(bindColumns[i] + 1)
+                    + L" is too long or contains the chr(30) separator.";
+                return false;
+            }
+            startNewBatch = startNewBatch || packedLengths[i] + rowLengths[i] > MAX_PACKED_VALUES_LENGTH;
+        }
+
+        if (startNewBatch)
+        {
+            batchStarts.push_back(row);
+            std::fill(packedLengths.begin(), packedLengths.end(), 0);
+            batchRows = 0;
+        }
+
+        for (size_t i = 0; i < bindColumns.size(); i++)
+            packedLengths[i] += rowLengths[i];
+        batchRows++;
+    }
+
+    batchStarts.push_back(table.rowCount());
+    return true;
+}
+
+std::vector<std::string> packBatchValues(const BindTable& table, const std::vector<size_t>& bindColumns, size_t rowBegin, size_t rowEnd)
+{
+    std::vector<std::string> packedValues(bindColumns.size());
+    for (size_t i = 0; i < bindColumns.size(); i++)
+    {
+        auto& packed = packedValues[i];
+        size_t packedLength = 0;
+        for (size_t row = rowBegin; row < rowEnd; row++)
+            packedLength += table.cell(row, bindColumns[i]).size() + 1;
+
+        packed.reserve(packedLength);
+        for (size_t row = rowBegin; row < rowEnd; row++)
+        {
+            packed += table.cell(row, bindColumns[i]);
+            packed += PACKED_VALUE_TERMINATOR;
+        }
+    }
+    return packedValues;
+}
+
+void executeBatches(const BindTable& table)
+{
+    if (table.rowCount() == 0)
+    {
+        showMessage(L"The bind source has no rows.", MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    const char* selectedText = IDE_GetSelectedText();
+    std::string sql = selectedText != NULL && *selectedText != '\0' ? selectedText : IDE_GetText();
+
+    std::wstring error;
+    BatchStatement statement;
+    std::vector<size_t> bindColumns;
+    if (!prepareBatchStatement(sql, statement, error) || !mapBindsToColumns(statement, table, bindColumns, error))
+    {
+        showMessage(error, MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    int batchSize = getPluginPreference(BATCH_SIZE_PREFERENCE, DEFAULT_BATCH_SIZE);
+    if (!showIntegerInputBox(L"Batch execution", L"Rows per FORALL batch:", batchSize))
+        return;
+    setPluginPreference(BATCH_SIZE_PREFERENCE, batchSize);
+
+    std::vector<size_t> batchStarts;
+    if (!planBatches(table, bindColumns, batchSize, batchStarts, error))
+    {
+        showMessage(error, MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    std::string block = buildBatchBlock(statement);
+    size_t batchCount = batchStarts.size() - 1;
+
+    IDE_SplashCreate(static_cast<int>(batchCount));
+    IDE_SplashWriteLn("Executing batches...");
+
+    auto startTime = std::chrono::steady_clock::now();
+    long long affectedRows = 0;
+    size_t executedBatches = 0;
+
+    // Values of the next batch are packed on a worker thread while the current one executes
+    auto packBatch = [&](size_t batch) {
+        return packBatchValues(table, bindColumns, batchStarts[batch], batchStarts[batch + 1]);
+    };
+    auto nextBatchValues = std::async(std::launch::async, packBatch, 0);
+    for (size_t batch = 0; batch < batchCount; batch++)
+    {
+        auto batchValues = nextBatchValues.get();
+        if (batch + 1 < batchCount)
+            nextBatchValues = std::async(std::launch::async, packBatch, batch + 1);
+
+        SQL_ClearVariables();
+        for (size_t i = 0; i < batchValues.size(); i++)
+            SQL_SetVariable(("b" + std::to_string(i + 1)).c_str(), batchValues[i].c_str());
+        SQL_SetVariable("row_count", "");
+
+        if (executeTimedSql(block.c_str()) != 0)
+        {
+            error = L"Batch " + std::to_wstring(batch + 1) + L" (rows " + std::to_wstring(batchStarts[batch] + 1) + L"-"
+                + std::to_wstring(batchStarts[batch + 1]) + L") failed:\n" + toEditorString(SQL_ErrorMessage());
+            break;
+        }
+
+        const char* rowCount = SQL_GetVariable("row_count");
+        affectedRows += rowCount != NULL ? std::atoll(rowCount) : 0;
+        executedBatches++;
+        IDE_SplashProgress(static_cast<int>(executedBatches));
+    }
+    SQL_ClearVariables();
+
+    IDE_SplashHide();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    size_t executedRows = batchStarts[executedBatches];
+    std::wostringstream report;
+    report.precision(1);
+    report << std::fixed << L"Executed " << executedRows << L" rows in " << executedBatches << L" batches, " << seconds << L" s ("
+        << (seconds > 0 ? executedRows / seconds : 0.0) << L" rows/s), " << affectedRows << L" rows affected.";
+    if (!error.empty())
+        report << L"\n\n" << error;
+    report << L"\n\nThe changes are not committed.";
+
+    showMessage(report.str(), error.empty() ? MB_OK | MB_ICONINFORMATION : MB_OK | MB_ICONWARNING);
+}
+
+bool loadResultGrid(BindTable& table)
+{
+    int columnCount = IDE_ResultGridColCount();
+    int rowCount = IDE_ResultGridRowCount();
+    if (columnCount <= 0 || rowCount <= 0)
+        return false;
+
+    table.columnCount = columnCount;
+    table.cells.reserve(static_cast<size_t>(columnCount) * rowCount);
+    for (int row = 0; row < rowCount; row++)
+    {
+        for (int column = 0; column < columnCount; column++)
+        {
+            const char* cell = IDE_ResultGridCell(column, row);
+            table.cells.emplace_back(cell != NULL ? cell : "");
+        }
+    }
+
+    return true;
+}
+
+// RFC 4180 records; the first one holds the column names. Semicolon-separated files are
+// recognized by their header.
+void parseCsv(std::string_view csv, BindTable& table)
+{
+    size_t headerEnd = csv.find('\n');
+    std::string_view header = csv.substr(0, headerEnd);
+    char separator = std::count(header.begin(), header.end(), ';') > std::count(header.begin(), header.end(), ',') ? ';' : ',';
+
+    std::vector<std::string> record;
+    std::string field;
+    bool inQuotes = false;
+    bool headerParsed = false;
+
+    auto endRecord = [&] {
+        record.push_back(std::move(field));
+        field.clear();
+        if (!headerParsed)
+        {
+            table.columnNames = std::move(record);
+            table.columnCount = table.columnNames.size();
+            headerParsed = true;
+        }
+        else if (!(record.size() == 1 && record[0].empty()))
+        {
+            record.resize(table.columnCount);
+            for (auto& value : record)
+                table.cells.push_back(std::move(value));
+        }
+        record.clear();
+    };
+
+    for (size_t i = 0; i < csv.size(); i++)
+    {
+        char c = csv[i];
+        if (inQuotes)
+        {
+            if (c == '"')
+            {
+                if (i + 1 < csv.size() && csv[i + 1] == '"')
+                {
+                    field += '"';
+                    i++;
+                }
+                else
+                {
+                    inQuotes = false;
+                }
+            }
+            else
+            {
+                field += c;
+            }
+        }
+        else if (c == '"')
+        {
+            inQuotes = true;
+        }
+        else if (c == separator)
+        {
+            record.push_back(std::move(field));
+            field.clear();
+        }
+        else if (c == '\n')
+        {
+            endRecord();
+        }
+        else if (c != '\r')
+        {
+            field += c;
+        }
+    }
+
+    if (!field.empty() || !record.empty())
+        endRecord();
+}
+
+void batchExecuteFromResultGrid()
+{
+    BindTable table;
+    if (!loadResultGrid(table))
+    {
+        showMessage(L"The current window has no result grid rows to use as binds.", MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    executeBatches(table);
+}
+
+void batchExecuteFromCsvFile()
+{
+    std::wstring fileName;
+    if (!showOpenFileDialog(L"CSV files (*.csv)\0*.csv\0All files (*.*)\0*.*\0", fileName))
+        return;
+
+    std::string contents;
+    if (!readFile(fileName, contents))
+    {
+        showMessage(L"Can't read " + fileName, MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    // Bind values go through the ANSI callbacks, so UTF-8 files are converted first
+    if (contents.compare(0, 3, "\xEF\xBB\xBF") == 0)
+    {
+        int length = MultiByteToWideChar(CP_UTF8, 0, contents.data() + 3, static_cast<int>(contents.size() - 3), NULL, 0);
+        EditorString wideContents(length, EDT_TX('\0'));
+        MultiByteToWideChar(CP_UTF8, 0, contents.data() + 3, static_cast<int>(contents.size() - 3), wideContents.data(), length);
+        contents = toAnsiString(wideContents);
+    }
+
+    BindTable table;
+    parseCsv(contents, table);
+    executeBatches(table);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Runs the selected (or whole) INSERT/UPDATE/DELETE/MERGE statement once per row of a bind
+// source. Rows are sent in FORALL batches so a batch costs one round trip instead of one per row.
+void batchExecuteFromResultGrid();
+void batchExecuteFromCsvFile();
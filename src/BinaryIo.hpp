@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Little-endian encoding of the plug-in's binary files.
+
+inline void appendUint16(std::string& output, uint16_t value)
+{
+    char bytes[2] = { static_cast<char>(value), static_cast<char>(value >> 8) };
+    output.append(bytes, sizeof(bytes));
+}
+
+inline void appendUint32(std::string& output, uint32_t value)
+{
+    char bytes[4] = { static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16), static_cast<char>(value >> 24) };
+    output.append(bytes, sizeof(bytes));
+}
+
+inline void appendUint64(std::string& output, uint64_t value)
+{
+    appendUint32(output, static_cast<uint32_t>(value));
+    appendUint32(output, static_cast<uint32_t>(value >> 32));
+}
+
+// Length-prefixed bytes
+inline void appendBytes(std::string& output, std::string_view bytes)
+{
+    appendUint32(output, static_cast<uint32_t>(bytes.size()));
+    output.append(bytes);
+}
+
+// 7 bits per byte, the high bit set on all but the last, so small numbers take one byte
+inline void appendVarint(std::string& output, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        output.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+// Reads what the append functions wrote. Reading past the end yields zeros and sets failed(),
+// so a truncated file can be checked for once at the end instead of after every read.
+class ByteReader
+{
+public:
+    explicit ByteReader(std::string_view data)
+        : data(data)
+    {
+    }
+
+    uint16_t readUint16()
+    {
+        auto bytes = take(2);
+        return bytes.empty() ? 0 : static_cast<uint16_t>(byteAt(bytes, 0) | byteAt(bytes, 1) << 8);
+    }
+
+    uint32_t readUint32()
+    {
+        auto bytes = take(4);
+        return bytes.empty() ? 0 : byteAt(bytes, 0) | byteAt(bytes, 1) << 8 | byteAt(bytes, 2) << 16 | byteAt(bytes, 3) << 24;
+    }
+
+    uint64_t readUint64()
+    {
+        uint64_t low = readUint32();
+        return low | static_cast<uint64_t>(readUint32()) << 32;
+    }
+
+    uint32_t readVarint()
+    {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7)
+        {
+            auto byte = take(1);
+            if (byte.empty())
+                return 0;
+            value |= (byteAt(byte, 0) & 0x7F) << shift;
+            if (byteAt(byte, 0) < 0x80)
+                return value;
+        }
+        readFailed = true;
+        return value;
+    }
+
+    std::string_view readBytes()
+    {
+        return take(readUint32());
+    }
+
+    std::string_view take(size_t length)
+    {
+        if (length > data.size())
+        {
+            data = std::string_view();
+            readFailed = true;
+            return std::string_view();
+        }
+
+        auto bytes = data.substr(0, length);
+        data.remove_prefix(length);
+        return bytes;
+    }
+
+    bool atEnd() const { return data.empty(); }
+    size_t remaining() const { return data.size(); }
+    bool failed() const { return readFailed; }
+
+private:
+    static uint32_t byteAt(std::string_view bytes, size_t index)
+    {
+        return static_cast<unsigned char>(bytes[index]);
+    }
+
+    std::string_view data;
+    bool readFailed = false;
+};
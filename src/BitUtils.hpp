@@ -0,0 +1,19 @@
+#pragma once
+
+#include <intrin.h>
+#include <cstdint>
+
+// Index of the highest set bit of a nonzero value. _BitScanReverse64 exists only on x64, so the
+// 32-bit build scans the halves.
+inline unsigned long highestSetBit(uint64_t value)
+{
+    unsigned long index;
+#ifndef _WIN64
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+        return index + 32;
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+#else
+    _BitScanReverse64(&index, value);
+#endif
+    return index;
+}
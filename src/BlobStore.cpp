@@ -0,0 +1,183 @@
+#include "pch.h"
+#include "BinaryIo.hpp"
+#include "Hash.hpp"
+#include "BlobStore.hpp"
+
+constexpr uint64_t BLOB_ID_SEED = 0x6C6F63616C686973ull;
+// Two id halves, raw length and stored length
+constexpr size_t BLOB_HEADER_SIZE = 24;
+
+BlobStore::BlobStore(const wchar_t* fileName, std::string_view magic)
+    : fileName(fileName), magic(magic)
+{
+}
+
+BlobStore::~BlobStore()
+{
+    close();
+}
+
+std::wstring BlobStore::getPath() const
+{
+    return getPluginDataDirectory() + fileName;
+}
+
+bool BlobStore::isCurrent() const
+{
+    return loaded && getFileSize(getPath()) == fileSize;
+}
+
+void BlobStore::load()
+{
+    loaded = true;
+    offsets.clear();
+    pending.clear();
+    end = 0;
+
+    std::wstring path = getPath();
+    fileSize = getFileSize(path);
+    MappedFile mapping;
+    if (!mapping.open(path))
+        return;
+    std::string_view data = mapping.data();
+    if (data.substr(0, magic.size()) != magic)
+        return;
+
+    // Only the headers are read
+    uint64_t offset = magic.size();
+    while (data.size() - offset >= BLOB_HEADER_SIZE)
+    {
+        ByteReader reader(data.substr(static_cast<size_t>(offset), BLOB_HEADER_SIZE));
+        BlobId id;
+        id.first = reader.readUint64();
+        id.second = reader.readUint64();
+        reader.readUint32();
+        uint32_t storedLength = reader.readUint32();
+        if (data.size() - offset - BLOB_HEADER_SIZE < storedLength)
+            break;
+        offsets.emplace(id, offset);
+        offset += BLOB_HEADER_SIZE + storedLength;
+    }
+    end = offset;
+}
+
+// Blobs compression doesn't make smaller are stored as they are
+std::string BlobStore::compress(std::string_view blob)
+{
+    if (compressor == NULL && !CreateCompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, NULL, &compressor))
+        compressor = NULL;
+
+    std::string compressed(blob.size(), '\0');
+    SIZE_T compressedLength = 0;
+    if (compressor != NULL && Compress(compressor, blob.data(), blob.size(), compressed.data(), compressed.size(), &compressedLength)
+        && compressedLength < blob.size())
+    {
+        compressed.resize(compressedLength);
+        return compressed;
+    }
+    return std::string(blob);
+}
+
+uint64_t BlobStore::add(std::string_view blob)
+{
+    if (pending.empty() && !isCurrent())
+        load();
+
+    BlobId id = { hashBytes(blob.data(), blob.size()), hashBytes(blob.data(), blob.size(), BLOB_ID_SEED) };
+    auto stored = offsets.find(id);
+    if (stored != offsets.end())
+        return stored->second;
+
+    if (end == 0 && pending.empty())
+        pending = magic;
+    uint64_t offset = end + pending.size();
+    std::string compressed = compress(blob);
+    appendUint64(pending, id.first);
+    appendUint64(pending, id.second);
+    appendUint32(pending, static_cast<uint32_t>(blob.size()));
+    appendUint32(pending, static_cast<uint32_t>(compressed.size()));
+    pending += compressed;
+    offsets.emplace(id, offset);
+    return offset;
+}
+
+bool BlobStore::flush()
+{
+    if (pending.empty())
+        return true;
+    if (!isCurrent())
+    {
+        load();
+        return false;
+    }
+
+    OutputFile file;
+    bool written = file.openAt(getPath(), end) && file.write(pending);
+    written = file.close() && written;
+    if (!written)
+    {
+        load();
+        return false;
+    }
+
+    end += pending.size();
+    fileSize = end;
+    pending.clear();
+    return true;
+}
+
+bool BlobStore::read(const std::vector<uint64_t>& blobOffsets, std::string& output)
+{
+    MappedFile mapping;
+    if (!mapping.open(getPath()))
+        return false;
+    for (uint64_t offset : blobOffsets)
+    {
+        if (!readBlob(mapping.data(), offset, output))
+            return false;
+    }
+    return true;
+}
+
+bool BlobStore::readBlob(std::string_view data, uint64_t offset, std::string& output)
+{
+    if (offset < magic.size() || offset > data.size() || data.size() - offset < BLOB_HEADER_SIZE)
+        return false;
+    ByteReader reader(data.substr(static_cast<size_t>(offset) + 16, 8));
+    uint32_t rawLength = reader.readUint32();
+    uint32_t storedLength = reader.readUint32();
+    if (data.size() - offset - BLOB_HEADER_SIZE < storedLength)
+        return false;
+    std::string_view stored = data.substr(static_cast<size_t>(offset) + BLOB_HEADER_SIZE, storedLength);
+    if (storedLength == rawLength)
+    {
+        output += stored;
+        return true;
+    }
+
+    if (decompressor == NULL && !CreateDecompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, NULL, &decompressor))
+    {
+        decompressor = NULL;
+        return false;
+    }
+    size_t start = output.size();
+    output.resize(start + rawLength);
+    SIZE_T decompressedLength = 0;
+    if (!Decompress(decompressor, stored.data(), stored.size(), output.data() + start, rawLength, &decompressedLength)
+        || decompressedLength != rawLength)
+    {
+        output.resize(start);
+        return false;
+    }
+    return true;
+}
+
+void BlobStore::close()
+{
+    if (compressor != NULL)
+        CloseCompressor(compressor);
+    if (decompressor != NULL)
+        CloseDecompressor(decompressor);
+    compressor = NULL;
+    decompressor = NULL;
+}
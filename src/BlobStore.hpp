@@ -0,0 +1,73 @@
+#pragma once
+
+#include "pch.h"
+#include <compressapi.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "FileUtils.hpp"
+
+// Append-only file of blobs, each kept once however often it's added and compressed when that
+// makes it smaller. A blob is referred to by its offset in the file and found again by two
+// 64-bit hashes of its content. Added blobs are written by the next flush in a single write; a
+// record a crash left half-written is overwritten then.
+class BlobStore
+{
+public:
+    // The file is in the plug-in's data directory
+    BlobStore(const wchar_t* fileName, std::string_view magic);
+    ~BlobStore();
+
+    BlobStore(const BlobStore&) = delete;
+    BlobStore& operator=(const BlobStore&) = delete;
+
+    // Reads the record headers, forgetting blobs added but not flushed
+    void load();
+    // Offset the blob has, or will have once flushed. Loads the store first when it isn't
+    // current at the start of a batch.
+    uint64_t add(std::string_view blob);
+    // Fails, dropping the added blobs, if the file changed since it was loaded, as when another
+    // IDE instance wrote to it
+    bool flush();
+    size_t pendingBytes() const { return pending.size(); }
+    // End of the last whole record; offsets past it aren't stored blobs
+    uint64_t storedEnd() const { return end; }
+    // Appends the blobs to output in order. Doesn't need the store to be loaded. The file is only
+    // mapped during the call, so that other IDE instances can write to it meanwhile.
+    bool read(const std::vector<uint64_t>& blobOffsets, std::string& output);
+    // Releases the compressors until next used
+    void close();
+
+private:
+    struct BlobId
+    {
+        uint64_t first;
+        uint64_t second;
+
+        bool operator==(const BlobId& other) const { return first == other.first && second == other.second; }
+    };
+
+    struct BlobIdHash
+    {
+        size_t operator()(const BlobId& id) const { return static_cast<size_t>(id.first); }
+    };
+
+    std::wstring getPath() const;
+    bool isCurrent() const;
+    std::string compress(std::string_view blob);
+    bool readBlob(std::string_view data, uint64_t offset, std::string& output);
+
+    const wchar_t* fileName;
+    std::string magic;
+    bool loaded = false;
+    std::unordered_map<BlobId, uint64_t, BlobIdHash> offsets;
+    // Records added since the last flush
+    std::string pending;
+    uint64_t end = 0;
+    // Size when last loaded or flushed
+    uint64_t fileSize = 0;
+    COMPRESSOR_HANDLE compressor = NULL;
+    DECOMPRESSOR_HANDLE decompressor = NULL;
+};
@@ -0,0 +1,332 @@
+#include "pch.h"
+#include <algorithm>
+#include "PlSqlDevFunctions.hpp"
+#include "CodeModel.hpp"
+#include "BlockMatches.hpp"
+
+enum class BlockToken : uint8_t
+{
+    Other,
+    OpenParen,
+    CloseParen,
+    OpenBlock,
+    CloseBlock,
+    // Parentheses can't span statements, so ; closes any left open
+    EndOfStatement,
+    // A slash alone on its line ends a PL/SQL unit in scripts, closing everything
+    EndOfUnit,
+};
+
+bool isSymbolToken(const std::string& text, const Token& token, char symbol)
+{
+    return token.type == TokenType::Symbol && token.length == 1 && text[token.offset] == symbol;
+}
+
+bool isWordToken(const std::string& text, const Token& token, const char* keyword)
+{
+    return token.type == TokenType::Word && tokenEquals(text.data(), token, keyword);
+}
+
+bool isAloneOnLine(const std::string& text, const Token& token)
+{
+    for (size_t i = token.offset; i > 0 && text[i - 1] != '\n'; i--)
+    {
+        if (!BasicPlSqlLexer<char>::isWhitespace(text[i - 1]))
+            return false;
+    }
+    for (size_t i = token.offset + token.length; i < text.size() && text[i] != '\n'; i++)
+    {
+        if (!BasicPlSqlLexer<char>::isWhitespace(text[i]))
+            return false;
+    }
+    return true;
+}
+
+// What the token does to the open blocks, given the significant token before it
+BlockToken classifyToken(const std::string& text, const std::vector<Token>& tokens, size_t index, uint32_t previous)
+{
+    const Token& token = tokens[index];
+    if (token.type == TokenType::Symbol)
+    {
+        if (isSymbolToken(text, token, '('))
+            return BlockToken::OpenParen;
+        if (isSymbolToken(text, token, ')'))
+            return BlockToken::CloseParen;
+        if (isSymbolToken(text, token, ';'))
+            return BlockToken::EndOfStatement;
+        if (isSymbolToken(text, token, '/') && isAloneOnLine(text, token))
+            return BlockToken::EndOfUnit;
+        return BlockToken::Other;
+    }
+
+    if (token.type != TokenType::Word)
+        return BlockToken::Other;
+    // record.end and the like are names
+    if (previous != BlockMatches::NONE && (isSymbolToken(text, tokens[previous], '.') || isSymbolToken(text, tokens[previous], '%')))
+        return BlockToken::Other;
+    if (isWordToken(text, token, "END"))
+        return BlockToken::CloseBlock;
+    if (isWordToken(text, token, "BEGIN"))
+        return BlockToken::OpenBlock;
+    // END IF, END LOOP and END CASE are closed by their END
+    if (isWordToken(text, token, "CASE") || isWordToken(text, token, "IF") || isWordToken(text, token, "LOOP"))
+        return previous != BlockMatches::NONE && isWordToken(text, tokens[previous], "END") ? BlockToken::Other : BlockToken::OpenBlock;
+    return BlockToken::Other;
+}
+
+void BlockMatches::repair(const std::string& text, const std::vector<Token>& tokens, size_t firstToken, size_t removedTokens, size_t insertedTokens)
+{
+    if (blocks.empty())
+    {
+        blocks.push_back(NONE);
+        parens.push_back(NONE);
+    }
+    size_t oldTokenCount = partners.size();
+    size_t insertedEnd = firstToken + insertedTokens;
+    ptrdiff_t delta = static_cast<ptrdiff_t>(insertedTokens) - static_cast<ptrdiff_t>(removedTokens);
+
+    // What was open at the first changed token is unchanged
+    auto collectOpen = [](const std::vector<uint32_t>& enclosing, uint32_t innermost, std::vector<uint32_t>& open) {
+        for (uint32_t opener = innermost; opener != NONE; opener = enclosing[opener])
+            open.push_back(opener);
+        std::reverse(open.begin(), open.end());
+    };
+    std::vector<uint32_t> openBlocks;
+    std::vector<uint32_t> openParens;
+    collectOpen(blocks, blocks[firstToken], openBlocks);
+    collectOpen(parens, parens[firstToken], openParens);
+
+    uint32_t previous = NONE;
+    for (size_t i = firstToken; i > 0 && previous == NONE; i--)
+    {
+        if (tokens[i - 1].type != TokenType::Comment)
+            previous = static_cast<uint32_t>(i - 1);
+    }
+
+    // Matches of the tokens from firstToken, until the old ones can be reused
+    std::vector<uint32_t> newPartners;
+    std::vector<uint32_t> newBlocks;
+    std::vector<uint32_t> newParens;
+    auto setPartner = [&](uint32_t token, uint32_t partner) {
+        if (token < firstToken)
+            partners[token] = partner;
+        else
+            newPartners[token - firstToken] = partner;
+    };
+    auto closeAll = [&](std::vector<uint32_t>& open) {
+        for (uint32_t opener : open)
+            setPartner(opener, NONE);
+        open.clear();
+    };
+
+    size_t index = firstToken;
+    size_t oldIndex = oldTokenCount;
+    bool reused = false;
+    for (;; index++)
+    {
+        uint32_t blockTop = openBlocks.empty() ? NONE : openBlocks.back();
+        uint32_t parenTop = openParens.empty() ? NONE : openParens.back();
+        // Past the edit, with the same token before and the same open blocks, what follows
+        // matches as before
+        if (index >= insertedEnd && previous != NONE && previous >= insertedEnd && (blockTop == NONE || blockTop < firstToken)
+            && (parenTop == NONE || parenTop < firstToken))
+        {
+            size_t oldToken = index - insertedTokens + removedTokens;
+            if (blocks[oldToken] == blockTop && parens[oldToken] == parenTop)
+            {
+                oldIndex = oldToken;
+                reused = true;
+                break;
+            }
+        }
+
+        newBlocks.push_back(blockTop);
+        newParens.push_back(parenTop);
+        if (index == tokens.size())
+            break;
+        newPartners.push_back(NONE);
+        if (tokens[index].type == TokenType::Comment)
+            continue;
+
+        uint32_t token = static_cast<uint32_t>(index);
+        switch (classifyToken(text, tokens, index, previous))
+        {
+        case BlockToken::OpenParen:
+            openParens.push_back(token);
+            break;
+        case BlockToken::CloseParen:
+            if (!openParens.empty())
+            {
+                setPartner(openParens.back(), token);
+                setPartner(token, openParens.back());
+                openParens.pop_back();
+            }
+            break;
+        case BlockToken::OpenBlock:
+            openBlocks.push_back(token);
+            break;
+        case BlockToken::CloseBlock:
+            if (!openBlocks.empty())
+            {
+                setPartner(openBlocks.back(), token);
+                setPartner(token, openBlocks.back());
+                openBlocks.pop_back();
+            }
+            break;
+        case BlockToken::EndOfStatement:
+            closeAll(openParens);
+            break;
+        case BlockToken::EndOfUnit:
+            closeAll(openParens);
+            closeAll(openBlocks);
+            break;
+        case BlockToken::Other:
+            break;
+        }
+        previous = token;
+    }
+
+    if (!reused)
+    {
+        // Left open at the end of the text
+        closeAll(openParens);
+        closeAll(openBlocks);
+    }
+
+    partners.erase(partners.begin() + firstToken, partners.begin() + oldIndex);
+    partners.insert(partners.begin() + firstToken, newPartners.begin(), newPartners.end());
+    blocks.erase(blocks.begin() + firstToken, reused ? blocks.begin() + oldIndex : blocks.end());
+    blocks.insert(blocks.begin() + firstToken, newBlocks.begin(), newBlocks.end());
+    parens.erase(parens.begin() + firstToken, reused ? parens.begin() + oldIndex : parens.end());
+    parens.insert(parens.begin() + firstToken, newParens.begin(), newParens.end());
+    if (!reused || delta == 0)
+        return;
+
+    // Indexes of tokens past the edit shift, including the partners of what is still open
+    auto shift = [firstToken, delta](uint32_t& token) {
+        if (token != NONE && token >= firstToken)
+            token = static_cast<uint32_t>(token + delta);
+    };
+    for (size_t i = index; i < partners.size(); i++)
+        shift(partners[i]);
+    for (size_t i = index; i < blocks.size(); i++)
+    {
+        shift(blocks[i]);
+        shift(parens[i]);
+    }
+    for (uint32_t opener : openBlocks)
+        shift(partners[opener]);
+    for (uint32_t opener : openParens)
+        shift(partners[opener]);
+}
+
+size_t nextSignificantToken(const std::vector<Token>& tokens, size_t index)
+{
+    while (index < tokens.size() && tokens[index].type == TokenType::Comment)
+        index++;
+    return index;
+}
+
+// Token with a partner at the offset or ending there, or NONE
+uint32_t findMatchedToken(const CodeModel& model, size_t offset)
+{
+    const std::vector<Token>& tokens = model.tokens();
+    const BlockMatches& matches = model.blockMatches();
+    size_t next = std::lower_bound(tokens.begin(), tokens.end(), offset + 1, [](const Token& token, size_t offset) {
+        return token.offset < offset;
+    }) - tokens.begin();
+
+    // The token the offset is in or at the start of, then the one just before it
+    for (size_t i = next; i > 0 && next - i < 2; i--)
+    {
+        const Token& token = tokens[i - 1];
+        if (offset > token.offset + token.length)
+            break;
+        if (matches.partner(i - 1) != BlockMatches::NONE)
+            return static_cast<uint32_t>(i - 1);
+
+        // The keyword of END IF, END LOOP and END CASE stands for the END
+        for (size_t j = i - 1; j > 0; j--)
+        {
+            if (tokens[j - 1].type == TokenType::Comment)
+                continue;
+            if (isWordToken(model.text(), tokens[j - 1], "END") && token.type == TokenType::Word && matches.partner(j - 1) != BlockMatches::NONE)
+                return static_cast<uint32_t>(j - 1);
+            break;
+        }
+    }
+    return BlockMatches::NONE;
+}
+
+void jumpToMatch()
+{
+    CodeModel* model = getEditorCodeModel();
+    if (model == nullptr)
+        return;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+    uint32_t token = findMatchedToken(*model, toModelOffset(editorWindow, *model, selectionEnd));
+    if (token == BlockMatches::NONE)
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    size_t position = toEditorPosition(editorWindow, *model, model->tokens()[model->blockMatches().partner(token)].offset);
+    SendMessage(editorWindow, EM_SETSEL, position, position);
+    SendMessage(editorWindow, EM_SCROLLCARET, 0, 0);
+}
+
+void selectEnclosingBlock()
+{
+    CodeModel* model = getEditorCodeModel();
+    if (model == nullptr)
+        return;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+    size_t start = toModelOffset(editorWindow, *model, selectionStart);
+    size_t end = toModelOffset(editorWindow, *model, selectionEnd);
+
+    const std::vector<Token>& tokens = model->tokens();
+    const BlockMatches& matches = model->blockMatches();
+    auto innermost = [&matches](size_t token) {
+        uint32_t block = matches.enclosingBlock(token);
+        uint32_t paren = matches.enclosingParen(token);
+        // Of two open blocks the one opened later is inside the other
+        return block == BlockMatches::NONE ? paren : paren == BlockMatches::NONE ? block : std::max(block, paren);
+    };
+
+    size_t next = std::lower_bound(tokens.begin(), tokens.end(), start, [](const Token& token, size_t offset) {
+        return token.offset < offset;
+    }) - tokens.begin();
+    // A block starting at the selection counts as around it
+    uint32_t opener = next < tokens.size() && matches.partner(next) != BlockMatches::NONE && matches.partner(next) > next
+        ? static_cast<uint32_t>(next) : innermost(next);
+    for (; opener != BlockMatches::NONE; opener = innermost(opener))
+    {
+        uint32_t closer = matches.partner(opener);
+        if (closer == BlockMatches::NONE)
+            continue;
+
+        size_t last = closer;
+        size_t keyword = nextSignificantToken(tokens, closer + 1);
+        if (tokens[opener].type == TokenType::Word && keyword < tokens.size()
+            && (isWordToken(model->text(), tokens[keyword], "IF") || isWordToken(model->text(), tokens[keyword], "LOOP")
+                || isWordToken(model->text(), tokens[keyword], "CASE")))
+            last = keyword;
+
+        size_t blockStart = tokens[opener].offset;
+        size_t blockEnd = tokens[last].offset + tokens[last].length;
+        if (blockStart <= start && blockEnd >= end && (blockStart != start || blockEnd != end))
+        {
+            SendMessage(editorWindow, EM_SETSEL, toEditorPosition(editorWindow, *model, blockStart), toEditorPosition(editorWindow, *model, blockEnd));
+            SendMessage(editorWindow, EM_SCROLLCARET, 0, 0);
+            return;
+        }
+    }
+    MessageBeep(MB_OK);
+}
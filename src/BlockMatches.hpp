@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PlSqlLexer.hpp"
+
+// Matching parentheses and BEGIN, CASE, IF and LOOP blocks with their END, for every token of a
+// text, so finding the partner or the enclosing block of a token takes a lookup.
+//
+// Besides its partner, the innermost block and parenthesis open before every token are kept.
+// They make the open blocks at any token known without scanning from the start: the innermost
+// one and what was open before it, and so on. After an edit only the tokens from the first
+// changed one are matched again, until past the edit the innermost open block and parenthesis
+// were open before the edit and are the same as before it; indexes past that are only shifted.
+class BlockMatches
+{
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // Brings the matches up to date after removedTokens tokens starting at firstToken were
+    // replaced by insertedTokens tokens.
+    void repair(const std::string& text, const std::vector<Token>& tokens, size_t firstToken, size_t removedTokens, size_t insertedTokens);
+
+    // Token matching an opening parenthesis or block keyword or their closing ) or END, or NONE
+    uint32_t partner(size_t token) const { return partners[token]; }
+    // Opening keyword of the innermost block open before the token, or NONE
+    uint32_t enclosingBlock(size_t token) const { return blocks[token]; }
+    // Innermost parenthesis open before the token, or NONE
+    uint32_t enclosingParen(size_t token) const { return parens[token]; }
+
+private:
+    std::vector<uint32_t> partners;
+    std::vector<uint32_t> blocks;
+    std::vector<uint32_t> parens;
+};
+
+// Moves the caret from a parenthesis, block keyword or END to its partner.
+void jumpToMatch();
+// Selects the innermost block or parenthesized text around the selection, and the one around
+// that when repeated.
+void selectEnclosingBlock();
@@ -0,0 +1,382 @@
+#include "pch.h"
+#include <compressapi.h>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "Hash.hpp"
+#include "Plugin.hpp"
+#include "Ui.hpp"
+#include "WorkerPool.hpp"
+#include "ClipboardRing.hpp"
+
+constexpr auto CLIPBOARD_LISTENER_CLASS = L"PsdEditorEnhancementsClipboardRing";
+constexpr auto CLIPBOARD_RING_SIZE_PREFERENCE = "ClipboardRingSize";
+constexpr auto CLIPBOARD_RING_MEGABYTES_PREFERENCE = "ClipboardRingMegabytes";
+constexpr int DEFAULT_CLIPBOARD_RING_SIZE = 30;
+constexpr int DEFAULT_CLIPBOARD_RING_MEGABYTES = 16;
+constexpr size_t MIN_COMPRESSED_ENTRY_BYTES = 64 * 1024;
+constexpr size_t ENTRY_PREVIEW_LENGTH = 60;
+// Posted to the listener by a finished compression, the wParam being its id
+constexpr UINT WM_ENTRY_COMPRESSED = WM_APP;
+
+struct RingEntry
+{
+    // Order of the copy, or of the last paste from the ring
+    uint64_t sequence;
+    uint64_t hash;
+    // Characters of the text
+    size_t length;
+    int lineCount;
+    std::wstring preview;
+    // Where the text is kept in the arena
+    size_t offset;
+    size_t storedBytes;
+    bool compressed;
+};
+
+// A big text stored as it is while the worker pool compresses it, reading it from the arena, whose
+// bytes can't be reused until then
+struct PendingCompression
+{
+    UINT_PTR id;
+    size_t offset;
+    size_t bytes;
+    std::future<std::string> compression;
+};
+
+// Byte ring the stored texts are written in back to back. Space is reclaimed in the order it
+// was taken, so ringEntries are kept in that order, oldest first, whatever their sequence.
+std::vector<char> ringArena;
+size_t ringArenaHead = 0;
+std::deque<RingEntry> ringEntries;
+std::vector<PendingCompression> pendingCompressions;
+UINT_PTR lastCompressionId = 0;
+uint64_t ringSequence = 0;
+size_t ringMaxEntries = DEFAULT_CLIPBOARD_RING_SIZE;
+size_t ringMaxBytes = static_cast<size_t>(DEFAULT_CLIPBOARD_RING_MEGABYTES) << 20;
+HWND clipboardListener = NULL;
+
+// Returns an empty string if compression doesn't make the text smaller. Runs on the worker pool,
+// so it has its own compressor.
+std::string compressText(std::string_view text)
+{
+    std::string compressed;
+    COMPRESSOR_HANDLE compressor = NULL;
+    if (!CreateCompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, NULL, &compressor))
+        return compressed;
+
+    size_t bytes = text.size();
+    compressed.resize(bytes);
+    SIZE_T compressedLength = 0;
+    if (Compress(compressor, text.data(), bytes, compressed.data(), compressed.size(), &compressedLength) && compressedLength < bytes)
+        compressed.resize(compressedLength);
+    else
+        compressed.clear();
+    CloseCompressor(compressor);
+    return compressed;
+}
+
+bool decompressText(std::string_view compressed, size_t length, EditorString& text)
+{
+    DECOMPRESSOR_HANDLE decompressor = NULL;
+    if (!CreateDecompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, NULL, &decompressor))
+        return false;
+
+    text.resize(length);
+    SIZE_T decompressedLength = 0;
+    bool decompressed = Decompress(decompressor, compressed.data(), compressed.size(), text.data(), length * sizeof(EDITOR_CHAR), &decompressedLength)
+        && decompressedLength == length * sizeof(EDITOR_CHAR);
+    CloseDecompressor(decompressor);
+    return decompressed;
+}
+
+// Drops the stored entries whose bytes are in [begin, end). Those are always the oldest ones,
+// the ring being filled in order. Compressions still reading the range are waited for, their
+// result being of no use any more.
+void evictArenaRange(size_t begin, size_t end)
+{
+    pendingCompressions.erase(std::remove_if(pendingCompressions.begin(), pendingCompressions.end(), [begin, end](PendingCompression& pending) {
+        if (pending.offset >= end || pending.offset + pending.bytes <= begin)
+            return false;
+        pending.compression.wait();
+        return true;
+    }), pendingCompressions.end());
+    while (!ringEntries.empty() && ringEntries.front().offset < end && ringEntries.front().offset + ringEntries.front().storedBytes > begin)
+        ringEntries.pop_front();
+}
+
+size_t allocateArena(size_t bytes)
+{
+    if (ringArena.empty())
+        ringArena.resize(ringMaxBytes);
+    if (ringArenaHead + bytes > ringArena.size())
+    {
+        // The end of the arena too small for the entry is left unused this round
+        evictArenaRange(ringArenaHead, ringArena.size());
+        ringArenaHead = 0;
+    }
+    evictArenaRange(ringArenaHead, ringArenaHead + bytes);
+    size_t offset = ringArenaHead;
+    ringArenaHead += bytes;
+    return offset;
+}
+
+// Fails for texts larger than the whole ring
+bool storeEntry(RingEntry entry, std::string_view bytes, bool compressed)
+{
+    if (bytes.size() > ringMaxBytes)
+        return false;
+
+    entry.offset = allocateArena(bytes.size());
+    entry.storedBytes = bytes.size();
+    entry.compressed = compressed;
+    std::memcpy(ringArena.data() + entry.offset, bytes.data(), bytes.size());
+    ringEntries.push_back(std::move(entry));
+    return true;
+}
+
+// Compresses the entry's text from the arena. The listener is told when it's done, so the ring
+// keeps the uncompressed text only that long.
+void startCompression(const RingEntry& entry)
+{
+    std::string_view stored(ringArena.data() + entry.offset, entry.storedBytes);
+    UINT_PTR id = ++lastCompressionId;
+    HWND listener = clipboardListener;
+    auto compression = getWorkerPool().submit([stored, id, listener] {
+        std::string compressed = compressText(stored);
+        PostMessage(listener, WM_ENTRY_COMPRESSED, id, 0);
+        return compressed;
+    });
+    pendingCompressions.push_back({ id, entry.offset, entry.storedBytes, std::move(compression) });
+}
+
+// Replaces the uncompressed entry with its compressed text, written at the head of the ring like
+// a new entry; the space of the uncompressed one is reclaimed when the ring comes round to it
+void storeCompressedEntry(UINT_PTR id)
+{
+    auto pending = std::find_if(pendingCompressions.begin(), pendingCompressions.end(),
+        [id](const PendingCompression& pending) { return pending.id == id; });
+    // Evicted meanwhile
+    if (pending == pendingCompressions.end())
+        return;
+    // Posted just before the result is set, so this doesn't wait for long
+    std::string compressed = pending->compression.get();
+    size_t offset = pending->offset;
+    pendingCompressions.erase(pending);
+
+    auto entry = std::find_if(ringEntries.begin(), ringEntries.end(),
+        [offset](const RingEntry& entry) { return entry.offset == offset && !entry.compressed; });
+    if (compressed.empty() || entry == ringEntries.end())
+        return;
+    RingEntry compressedEntry = std::move(*entry);
+    ringEntries.erase(entry);
+    storeEntry(std::move(compressedEntry), compressed, true);
+}
+
+RingEntry* findEntry(uint64_t sequence)
+{
+    for (auto& entry : ringEntries)
+    {
+        if (entry.sequence == sequence)
+            return &entry;
+    }
+    return nullptr;
+}
+
+// Newest first
+std::vector<uint64_t> getEntrySequences()
+{
+    std::vector<uint64_t> sequences;
+    for (auto& entry : ringEntries)
+        sequences.push_back(entry.sequence);
+    std::sort(sequences.begin(), sequences.end(), std::greater<uint64_t>());
+    return sequences;
+}
+
+void removeEntry(uint64_t sequence)
+{
+    ringEntries.erase(std::remove_if(ringEntries.begin(), ringEntries.end(),
+        [sequence](const RingEntry& entry) { return entry.sequence == sequence; }), ringEntries.end());
+}
+
+void trimRing()
+{
+    std::vector<uint64_t> sequences = getEntrySequences();
+    for (size_t i = ringMaxEntries; i < sequences.size(); i++)
+        removeEntry(sequences[i]);
+}
+
+bool loadEntryText(const RingEntry& entry, EditorString& text)
+{
+    std::string_view stored(ringArena.data() + entry.offset, entry.storedBytes);
+    if (entry.compressed)
+        return decompressText(stored, entry.length, text);
+    text.assign(reinterpret_cast<const EDITOR_CHAR*>(stored.data()), entry.length);
+    return true;
+}
+
+// First line with something on it, shortened to fit a menu
+std::wstring makeEntryPreview(const EditorString& text)
+{
+    size_t start = text.find_first_not_of(EDT_TX(" \t\r\n"));
+    if (start == EditorString::npos)
+        return L"(blank)";
+    size_t end = std::min(text.find_first_of(EDT_TX("\r\n"), start), text.size());
+
+    std::wstring preview;
+    for (size_t i = start; i < end && preview.size() < ENTRY_PREVIEW_LENGTH; i++)
+    {
+        // Tabs would split the item and & would underline the next character
+        if (text[i] == EDT_TX('\t'))
+            preview += L' ';
+        else if (text[i] == EDT_TX('&'))
+            preview += L"&&";
+        else
+            preview += text[i];
+    }
+    if (end - start > ENTRY_PREVIEW_LENGTH)
+        preview += L"...";
+    return preview;
+}
+
+void captureClipboard()
+{
+    // Only texts copied in the IDE are kept
+    HWND owner = GetClipboardOwner();
+    DWORD ownerProcess = 0;
+    if (owner == NULL || (GetWindowThreadProcessId(owner, &ownerProcess), ownerProcess != GetCurrentProcessId()))
+        return;
+
+    EditorString text = getClipboardText(clipboardListener);
+    if (text.empty())
+        return;
+
+    RingEntry entry = {};
+    entry.sequence = ++ringSequence;
+    entry.hash = hashBytes(text.data(), text.size() * sizeof(EDITOR_CHAR));
+    entry.length = text.size();
+    entry.lineCount = static_cast<int>(std::count(text.begin(), text.end(), EDT_TX('\n')) + 1);
+    entry.preview = makeEntryPreview(text);
+
+    // Copying a text again moves it to the top instead of keeping it twice
+    for (uint64_t sequence : getEntrySequences())
+    {
+        RingEntry* existing = findEntry(sequence);
+        if (existing->hash == entry.hash && existing->length == entry.length)
+            removeEntry(sequence);
+    }
+
+    // Big texts are kept as they are until compressed, which counts against the ring's size
+    size_t bytes = text.size() * sizeof(EDITOR_CHAR);
+    if (!storeEntry(std::move(entry), std::string_view(reinterpret_cast<const char*>(text.data()), bytes), false))
+        return;
+    if (bytes >= MIN_COMPRESSED_ENTRY_BYTES)
+        startCompression(ringEntries.back());
+    trimRing();
+}
+
+LRESULT CALLBACK clipboardListenerProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    if (message == WM_CLIPBOARDUPDATE)
+    {
+        captureClipboard();
+        return 0;
+    }
+    if (message == WM_ENTRY_COMPRESSED)
+    {
+        storeCompressedEntry(wParam);
+        return 0;
+    }
+    return DefWindowProc(window, message, wParam, lParam);
+}
+
+void startClipboardRing()
+{
+    if (clipboardListener != NULL)
+        return;
+
+    ringMaxEntries = std::max(1, getPluginPreference(CLIPBOARD_RING_SIZE_PREFERENCE, DEFAULT_CLIPBOARD_RING_SIZE));
+    ringMaxBytes = static_cast<size_t>(std::max(1, getPluginPreference(CLIPBOARD_RING_MEGABYTES_PREFERENCE, DEFAULT_CLIPBOARD_RING_MEGABYTES))) << 20;
+
+    static bool classRegistered = false;
+    if (!classRegistered)
+    {
+        WNDCLASSEX windowClass = {};
+        windowClass.cbSize = sizeof(windowClass);
+        windowClass.lpfnWndProc = clipboardListenerProc;
+        windowClass.hInstance = GetModuleHandle(NULL);
+        windowClass.lpszClassName = CLIPBOARD_LISTENER_CLASS;
+        classRegistered = RegisterClassEx(&windowClass) != 0;
+    }
+
+    // Message-only window, which gets WM_CLIPBOARDUPDATE without ever being shown
+    clipboardListener = CreateWindowEx(0, CLIPBOARD_LISTENER_CLASS, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, GetModuleHandle(NULL), NULL);
+    if (clipboardListener != NULL)
+        AddClipboardFormatListener(clipboardListener);
+}
+
+void stopClipboardRing()
+{
+    if (clipboardListener != NULL)
+    {
+        RemoveClipboardFormatListener(clipboardListener);
+        DestroyWindow(clipboardListener);
+        clipboardListener = NULL;
+    }
+
+    // Called before the worker pool shuts down, which would leave the compressions unfinished, and
+    // before the arena they read is freed
+    for (auto& pending : pendingCompressions)
+        pending.compression.wait();
+    pendingCompressions.clear();
+    ringEntries.clear();
+    ringArena = std::vector<char>();
+    ringArenaHead = 0;
+}
+
+void pasteFromClipboardRing()
+{
+    if (!IDE_WindowHasEditor(false) || IDE_GetReadOnly())
+        return;
+
+    std::vector<uint64_t> sequences = getEntrySequences();
+    if (sequences.empty())
+    {
+        IDE_SetStatusMessage("The clipboard ring is empty");
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    std::vector<std::wstring> items;
+    for (uint64_t sequence : sequences)
+    {
+        const RingEntry* entry = findEntry(sequence);
+        items.push_back(entry->preview + L"\t" + (entry->lineCount > 1 ? std::to_wstring(entry->lineCount) + L" lines"
+            : std::to_wstring(entry->length) + L" characters"));
+    }
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+    int picked = showPopupList(editorWindow, getCharScreenPosition(editorWindow, selectionEnd), items);
+    if (picked < 0)
+        return;
+
+    // The menu runs its own message loop, so the ring may have taken a copy meanwhile
+    RingEntry* entry = findEntry(sequences[picked]);
+    EditorString text;
+    if (entry == nullptr || !loadEntryText(*entry, text))
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    SendMessage(editorWindow, EM_REPLACESEL, TRUE, reinterpret_cast<LPARAM>(text.c_str()));
+    SendMessage(editorWindow, EM_SCROLLCARET, 0, 0);
+    entry->sequence = ++ringSequence;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "pch.h"
+
+// The last texts cut or copied in the IDE, kept in a fixed-size byte ring so they cost bounded
+// memory however big they are. Texts from 64 KB up are written to the ring as they are and
+// compressed from there on the worker pool, so taking even a huge cut costs the IDE a copy of the
+// text. When the ring is full the oldest texts are dropped; texts larger than the ring aren't
+// kept. Its size is set by the ClipboardRingSize (number of texts) and ClipboardRingMegabytes
+// preferences.
+
+// Starts listening to clipboard changes. Texts put on the clipboard by other programs are ignored.
+void startClipboardRing();
+void stopClipboardRing();
+// Lists the ring at the caret and pastes the picked text over the selection. A pasted text
+// moves to the top of the list.
+void pasteFromClipboardRing();
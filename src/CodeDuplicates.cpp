@@ -0,0 +1,355 @@
+#include "pch.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "Hash.hpp"
+#include "LogWindow.hpp"
+#include "PlSqlLexer.hpp"
+#include "SourceIndex.hpp"
+#include "WorkerPool.hpp"
+#include "CodeDuplicates.hpp"
+
+// Shorter copies are too common to be worth reporting
+constexpr size_t MIN_DUPLICATE_TOKENS = 50;
+constexpr size_t FINGERPRINT_TOKENS = 25;
+// A copy of MIN_DUPLICATE_TOKENS tokens spans a whole window
+constexpr size_t WINNOWING_WINDOW = MIN_DUPLICATE_TOKENS - FINGERPRINT_TOKENS + 1;
+constexpr uint64_t ROLLING_HASH_BASE = 0x100000001B3ull;
+// Fingerprints found in more places are boilerplate, not copied logic
+constexpr size_t MAX_FINGERPRINT_OCCURRENCES = 32;
+// Token hashes and offsets, 8 bytes per token of about 4 characters, and the fingerprints
+constexpr size_t ESTIMATED_BYTES_PER_SOURCE_BYTE = 3;
+constexpr size_t MAX_ESTIMATED_MEMORY = 768 * 1024 * 1024;
+constexpr size_t SHARD_SOURCE_BYTES = 1024 * 1024;
+constexpr size_t MAX_LISTED_DUPLICATES = 2000;
+constexpr size_t DUPLICATES_LOG_MAX_BYTES = 1024 * 1024;
+
+struct TokenStream
+{
+    std::vector<uint32_t> hashes;
+    std::vector<uint32_t> offsets;
+};
+
+struct Fingerprint
+{
+    uint64_t hash;
+    uint32_t source;
+    uint32_t token;
+
+    bool operator<(const Fingerprint& other) const
+    {
+        return hash != other.hash ? hash < other.hash : source != other.source ? source < other.source : token < other.token;
+    }
+};
+
+struct Duplicate
+{
+    uint32_t length;
+    uint32_t firstSource;
+    uint32_t firstToken;
+    uint32_t secondSource;
+    uint32_t secondToken;
+
+    // Longest first
+    bool operator<(const Duplicate& other) const
+    {
+        if (length != other.length)
+            return length > other.length;
+        if (firstSource != other.firstSource)
+            return firstSource < other.firstSource;
+        if (firstToken != other.firstToken)
+            return firstToken < other.firstToken;
+        if (secondSource != other.secondSource)
+            return secondSource < other.secondSource;
+        return secondToken < other.secondToken;
+    }
+
+    bool operator==(const Duplicate& other) const
+    {
+        return length == other.length && firstSource == other.firstSource && firstToken == other.firstToken
+            && secondSource == other.secondSource && secondToken == other.secondToken;
+    }
+};
+
+struct DuplicateLocation
+{
+    std::string type;
+    std::string name;
+    size_t line;
+};
+
+// Locations by result line
+std::vector<DuplicateLocation> duplicateLocations;
+
+// Literals hash by their kind only, words and bind variables regardless of case
+uint32_t normalizedTokenHash(std::string_view text, const Token& token)
+{
+    uint64_t hash = static_cast<uint64_t>(token.type) + 1;
+    if (token.type != TokenType::Number && token.type != TokenType::String)
+    {
+        bool foldCase = token.type == TokenType::Word || token.type == TokenType::BindVariable;
+        for (uint32_t i = 0; i < token.length; i++)
+        {
+            char c = text[token.offset + i];
+            if (foldCase && c >= 'a' && c <= 'z')
+                c = static_cast<char>(c - 'a' + 'A');
+            hash = (hash ^ static_cast<unsigned char>(c)) * ROLLING_HASH_BASE;
+        }
+    }
+    return static_cast<uint32_t>(mixHash(hash));
+}
+
+void winnow(const std::vector<uint32_t>& tokenHashes, uint32_t source, std::vector<Fingerprint>& fingerprints)
+{
+    if (tokenHashes.size() < MIN_DUPLICATE_TOKENS)
+        return;
+
+    uint64_t leadingPower = 1;
+    for (size_t i = 1; i < FINGERPRINT_TOKENS; i++)
+        leadingPower *= ROLLING_HASH_BASE;
+
+    // Hashes of every FINGERPRINT_TOKENS tokens, rolled one token at a time
+    std::vector<uint64_t> gramHashes(tokenHashes.size() - FINGERPRINT_TOKENS + 1);
+    uint64_t rolling = 0;
+    for (size_t i = 0; i < tokenHashes.size(); i++)
+    {
+        if (i >= FINGERPRINT_TOKENS)
+            rolling -= tokenHashes[i - FINGERPRINT_TOKENS] * leadingPower;
+        rolling = rolling * ROLLING_HASH_BASE + tokenHashes[i];
+        if (i + 1 >= FINGERPRINT_TOKENS)
+            gramHashes[i + 1 - FINGERPRINT_TOKENS] = mixHash(rolling);
+    }
+
+    // Candidates for the window's minimum, the rightmost of equal ones kept
+    std::deque<size_t> minimums;
+    size_t lastChosen = SIZE_MAX;
+    for (size_t i = 0; i < gramHashes.size(); i++)
+    {
+        while (!minimums.empty() && gramHashes[minimums.back()] >= gramHashes[i])
+            minimums.pop_back();
+        minimums.push_back(i);
+        if (minimums.front() + WINNOWING_WINDOW <= i)
+            minimums.pop_front();
+
+        if (i + 1 >= WINNOWING_WINDOW && minimums.front() != lastChosen)
+        {
+            lastChosen = minimums.front();
+            fingerprints.push_back({ gramHashes[lastChosen], source, static_cast<uint32_t>(lastChosen) });
+        }
+    }
+}
+
+// Runs on a worker thread
+std::vector<Fingerprint> fingerprintSources(const std::vector<IndexedSource>& sources, std::vector<TokenStream>& streams, size_t begin,
+    size_t end)
+{
+    std::vector<Fingerprint> fingerprints;
+    for (size_t i = begin; i < end; i++)
+    {
+        std::string_view text = sources[i].text;
+        TokenStream& stream = streams[i];
+        BasicPlSqlLexer<char> lexer(text.data(), text.size());
+        Token token;
+        while (lexer.next(token))
+        {
+            if (token.type == TokenType::Comment)
+                continue;
+            stream.hashes.push_back(normalizedTokenHash(text, token));
+            stream.offsets.push_back(token.offset);
+        }
+        winnow(stream.hashes, static_cast<uint32_t>(i), fingerprints);
+    }
+    return fingerprints;
+}
+
+// Grows the copy at the two fingerprints both ways. Returns false when the fingerprints only
+// collided or the copy is too short.
+bool growDuplicate(const std::vector<TokenStream>& streams, const Fingerprint& first, const Fingerprint& second, Duplicate& duplicate)
+{
+    const std::vector<uint32_t>& firstHashes = streams[first.source].hashes;
+    const std::vector<uint32_t>& secondHashes = streams[second.source].hashes;
+
+    size_t before = 0;
+    while (before < first.token && before < second.token
+        && firstHashes[first.token - before - 1] == secondHashes[second.token - before - 1])
+        before++;
+    size_t after = 0;
+    while (first.token + after < firstHashes.size() && second.token + after < secondHashes.size()
+        && firstHashes[first.token + after] == secondHashes[second.token + after])
+        after++;
+
+    size_t firstToken = first.token - before;
+    size_t secondToken = second.token - before;
+    size_t length = before + after;
+    // Repeated code within a source isn't reported overlapping itself
+    if (first.source == second.source)
+        length = std::min(length, secondToken - firstToken);
+    if (length < MIN_DUPLICATE_TOKENS)
+        return false;
+
+    duplicate = { static_cast<uint32_t>(length), first.source, static_cast<uint32_t>(firstToken), second.source,
+        static_cast<uint32_t>(secondToken) };
+    return true;
+}
+
+// Runs on a worker thread for fingerprints [begin, end), which don't split a run of equal hashes
+std::vector<Duplicate> findDuplicates(const std::vector<TokenStream>& streams, const std::vector<Fingerprint>& fingerprints, size_t begin,
+    size_t end)
+{
+    std::vector<Duplicate> duplicates;
+    for (size_t runStart = begin; runStart < end;)
+    {
+        size_t runEnd = runStart + 1;
+        while (runEnd < end && fingerprints[runEnd].hash == fingerprints[runStart].hash)
+            runEnd++;
+
+        if (runEnd - runStart <= MAX_FINGERPRINT_OCCURRENCES)
+        {
+            for (size_t i = runStart; i < runEnd; i++)
+            {
+                for (size_t j = i + 1; j < runEnd; j++)
+                {
+                    Duplicate duplicate;
+                    if (growDuplicate(streams, fingerprints[i], fingerprints[j], duplicate))
+                        duplicates.push_back(duplicate);
+                }
+            }
+        }
+        runStart = runEnd;
+    }
+
+    // Every fingerprint of a copy grows into the same one
+    std::sort(duplicates.begin(), duplicates.end());
+    duplicates.erase(std::unique(duplicates.begin(), duplicates.end()), duplicates.end());
+    return duplicates;
+}
+
+void goToDuplicate(size_t line)
+{
+    if (line >= duplicateLocations.size())
+        return;
+
+    const DuplicateLocation& location = duplicateLocations[line];
+    editSchemaSource(location.type, location.name, location.line, 0);
+}
+
+void findDuplicateCode()
+{
+    const SourceIndex* index = getUpdatedSourceIndex();
+    if (index == nullptr)
+        return;
+
+    auto analysisStart = std::chrono::steady_clock::now();
+    const std::vector<IndexedSource>& sources = index->sources();
+
+    // Sources are fingerprinted in shards of similar size; those past the memory estimate are
+    // left out
+    std::vector<TokenStream> streams(sources.size());
+    std::vector<std::future<std::vector<Fingerprint>>> shards;
+    size_t estimatedMemory = 0;
+    size_t shardStart = 0;
+    size_t shardBytes = 0;
+    size_t analyzedCount = 0;
+    for (; analyzedCount < sources.size(); analyzedCount++)
+    {
+        size_t sourceBytes = sources[analyzedCount].text.size();
+        if (estimatedMemory + sourceBytes * ESTIMATED_BYTES_PER_SOURCE_BYTE > MAX_ESTIMATED_MEMORY)
+            break;
+        estimatedMemory += sourceBytes * ESTIMATED_BYTES_PER_SOURCE_BYTE;
+        shardBytes += sourceBytes;
+        if (shardBytes < SHARD_SOURCE_BYTES)
+            continue;
+
+        shards.push_back(getWorkerPool().submit([&sources, &streams, shardStart, shardEnd = analyzedCount + 1] {
+            return fingerprintSources(sources, streams, shardStart, shardEnd);
+        }));
+        shardStart = analyzedCount + 1;
+        shardBytes = 0;
+    }
+    if (shardStart < analyzedCount)
+    {
+        shards.push_back(getWorkerPool().submit([&sources, &streams, shardStart, shardEnd = analyzedCount] {
+            return fingerprintSources(sources, streams, shardStart, shardEnd);
+        }));
+    }
+
+    std::vector<Fingerprint> fingerprints;
+    for (auto& shard : shards)
+    {
+        std::vector<Fingerprint> shardFingerprints = shard.get();
+        fingerprints.insert(fingerprints.end(), shardFingerprints.begin(), shardFingerprints.end());
+    }
+    std::sort(fingerprints.begin(), fingerprints.end());
+
+    // Copies are grown in parallel over ranges of the fingerprints, split between hashes
+    size_t rangeCount = getWorkerPool().threadCount() * 4;
+    std::vector<std::future<std::vector<Duplicate>>> ranges;
+    for (size_t rangeStart = 0; rangeStart < fingerprints.size();)
+    {
+        size_t rangeEnd = std::min(fingerprints.size(), rangeStart + fingerprints.size() / rangeCount + 1);
+        while (rangeEnd < fingerprints.size() && fingerprints[rangeEnd].hash == fingerprints[rangeEnd - 1].hash)
+            rangeEnd++;
+        ranges.push_back(getWorkerPool().submit([&streams, &fingerprints, rangeStart, rangeEnd] {
+            return findDuplicates(streams, fingerprints, rangeStart, rangeEnd);
+        }));
+        rangeStart = rangeEnd;
+    }
+
+    std::vector<Duplicate> duplicates;
+    for (auto& range : ranges)
+    {
+        std::vector<Duplicate> rangeDuplicates = range.get();
+        duplicates.insert(duplicates.end(), rangeDuplicates.begin(), rangeDuplicates.end());
+    }
+    std::sort(duplicates.begin(), duplicates.end());
+    duplicates.erase(std::unique(duplicates.begin(), duplicates.end()), duplicates.end());
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - analysisStart);
+
+    std::wstring status = std::to_wstring(duplicates.size()) + L" copies of at least " + std::to_wstring(MIN_DUPLICATE_TOKENS)
+        + L" tokens in " + std::to_wstring(analyzedCount) + L" objects, " + std::to_wstring(elapsed.count()) + L" ms";
+    if (analyzedCount < sources.size())
+        status += L", " + std::to_wstring(sources.size() - analyzedCount) + L" objects left out to save memory";
+    if (duplicates.empty())
+    {
+        IDE_SetStatusMessage(toAnsiString(status).c_str());
+        MessageBeep(MB_OK);
+        return;
+    }
+    if (duplicates.size() > MAX_LISTED_DUPLICATES)
+    {
+        duplicates.resize(MAX_LISTED_DUPLICATES);
+        status += L", the longest " + std::to_wstring(MAX_LISTED_DUPLICATES) + L" are listed";
+    }
+
+    auto lineAt = [&](uint32_t source, uint32_t token) {
+        std::string_view text = sources[source].text;
+        return static_cast<size_t>(std::count(text.begin(), text.begin() + streams[source].offsets[token], '\n'));
+    };
+    auto describe = [&](uint32_t source, uint32_t token, uint32_t length) {
+        size_t firstLine = lineAt(source, token);
+        duplicateLocations.push_back({ std::string(sources[source].type), std::string(sources[source].name), firstLine });
+        return std::string(sources[source].type) + " " + std::string(sources[source].name) + "(" + std::to_string(firstLine + 1) + "-"
+            + std::to_string(lineAt(source, token + length - 1) + 1) + ")";
+    };
+
+    duplicateLocations.clear();
+    std::string report;
+    for (auto& duplicate : duplicates)
+    {
+        report += describe(duplicate.firstSource, duplicate.firstToken, duplicate.length) + ": " + std::to_string(duplicate.length)
+            + " tokens also in\n";
+        report += "    " + describe(duplicate.secondSource, duplicate.secondToken, duplicate.length) + "\n";
+    }
+
+    static LogWindow resultsWindow(L"Duplicate code", MAX_LISTED_DUPLICATES * 2, DUPLICATES_LOG_MAX_BYTES);
+    resultsWindow.setLineActivated(goToDuplicate);
+    resultsWindow.show();
+    resultsWindow.append(report);
+    resultsWindow.setStatus(status);
+}
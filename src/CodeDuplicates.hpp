@@ -0,0 +1,11 @@
+#pragma once
+
+// Finds code duplicated within and between the connected schema's PL/SQL objects and lists
+// the copies. Sources are compared as token streams, so layout, comments, letter case and the
+// values of literals don't matter.
+//
+// Every object's tokens are fingerprinted by winnowing: of each window of consecutive k-token
+// hashes, the smallest is kept. Copies long enough to be reported are sure to share a window
+// and thus a fingerprint, so only objects with equal fingerprints are compared, starting from
+// the fingerprint and growing the copy both ways while the tokens are the same.
+void findDuplicateCode();
@@ -0,0 +1,537 @@
+#include "pch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "CodeModel.hpp"
+#include "CodeSymbols.hpp"
+#include "Hash.hpp"
+#include "LogWindow.hpp"
+#include "WorkerPool.hpp"
+#include "CodeLint.hpp"
+
+constexpr UINT LINT_DELAY_MS = 400;
+constexpr UINT LINT_POLL_MS = 50;
+constexpr int PROCEDURE_WINDOW_TYPE = 3;
+constexpr size_t LINT_LOG_MAX_LINES = 10000;
+constexpr size_t LINT_LOG_MAX_BYTES = 1024 * 1024;
+
+const char* const NUMBER_TYPES[] = { "NUMBER", "INTEGER", "INT", "SMALLINT", "DECIMAL", "NUMERIC", "FLOAT", "REAL", "PLS_INTEGER",
+    "BINARY_INTEGER", "SIMPLE_INTEGER", "NATURAL", "NATURALN", "POSITIVE", "POSITIVEN", "SIGNTYPE", "BINARY_FLOAT", "BINARY_DOUBLE" };
+const char* const DATE_TYPES[] = { "DATE", "TIMESTAMP" };
+const char* const TEXT_TYPES[] = { "VARCHAR2", "VARCHAR", "CHAR", "NVARCHAR2", "NCHAR", "CLOB", "NCLOB", "STRING" };
+// Declarations starting with these aren't variables
+const char* const DECLARATION_KEYWORDS[] = { "PROCEDURE", "FUNCTION", "CURSOR", "TYPE", "SUBTYPE", "PRAGMA", "BEGIN", "END", "DECLARE" };
+
+enum class VariableType : uint8_t
+{
+    Other,
+    Number,
+    Date,
+    Text,
+};
+
+struct LintFinding
+{
+    // Relative to the first line of the subprogram while cached
+    uint32_t line;
+    uint32_t column;
+    std::string message;
+
+    bool operator==(const LintFinding& other) const
+    {
+        return line == other.line && column == other.column && message == other.message;
+    }
+};
+
+struct LintPass
+{
+    HWND editorWindow;
+    uint64_t generation;
+    std::future<std::vector<LintFinding>> findings;
+};
+
+// Bumped by every edit, which cancels the pass started before it
+std::atomic<uint64_t> lintGeneration(0);
+UINT_PTR lintTimer = 0;
+std::unique_ptr<LintPass> runningPass;
+// Findings of subprograms by hash of their text. Only the running pass uses them.
+std::unordered_map<uint64_t, std::vector<LintFinding>> lintCache;
+// Findings of the window shown as error positions or listed last
+HWND markedEditor = NULL;
+std::vector<LintFinding> markedFindings;
+
+// Checks the tokens [begin, end) of one subprogram, or of the whole text if it has none
+class UnitLinter
+{
+public:
+    UnitLinter(const CodeModel& model, size_t begin, size_t end, std::vector<LintFinding>& findings)
+        : model(model), text(model.text()), tokens(model.tokens()), blocks(model.blockMatches()), findings(findings)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            if (tokens[i].type != TokenType::Comment)
+                significant.push_back(i);
+        }
+        if (begin < end)
+            firstLine = model.lineFromOffset(tokens[begin].offset);
+    }
+
+    void lint();
+
+private:
+    struct Variable
+    {
+        size_t token;
+        VariableType type;
+    };
+
+    struct OpenSubprogram
+    {
+        size_t nameToken;
+        // Subprograms are closed by the END of a BEGIN opened outside any block
+        bool begun;
+    };
+
+    const Token& tokenAt(size_t k) const { return tokens[significant[k]]; }
+
+    bool isWord(size_t k, const char* keyword) const
+    {
+        return k < significant.size() && tokenAt(k).type == TokenType::Word && tokenEquals(text.data(), tokenAt(k), keyword);
+    }
+
+    bool isSymbol(size_t k, const char* symbol) const
+    {
+        return k < significant.size() && tokenAt(k).type == TokenType::Symbol && text.compare(tokenAt(k).offset, tokenAt(k).length, symbol) == 0;
+    }
+
+    bool isAnyWord(size_t k, const char* const* keywords, size_t count) const
+    {
+        return std::any_of(keywords, keywords + count, [this, k](const char* keyword) { return isWord(k, keyword); });
+    }
+
+    std::string upperText(size_t k) const
+    {
+        std::string word = text.substr(tokenAt(k).offset, tokenAt(k).length);
+        std::transform(word.begin(), word.end(), word.begin(), [](char c) {
+            return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+        });
+        return word;
+    }
+
+    void report(size_t k, std::string message)
+    {
+        size_t offset = tokenAt(k).offset;
+        size_t line = model.lineFromOffset(offset);
+        findings.push_back({ static_cast<uint32_t>(line - firstLine), static_cast<uint32_t>(offset - model.lineStart(line)), std::move(message) });
+    }
+
+    VariableType variableType(size_t k) const;
+    void scanDeclarations();
+    void checkEndLabel(size_t end, size_t nameToken);
+    void checkWhenOthers();
+    void checkConversions();
+    void checkUnused();
+
+    const CodeModel& model;
+    const std::string& text;
+    const std::vector<Token>& tokens;
+    const BlockMatches& blocks;
+    std::vector<LintFinding>& findings;
+    // Indexes of the tokens other than comments
+    std::vector<size_t> significant;
+    size_t firstLine = 0;
+    // Declared variables by uppercase name
+    std::unordered_map<std::string, Variable> variables;
+};
+
+void UnitLinter::lint()
+{
+    scanDeclarations();
+    checkUnused();
+    checkWhenOthers();
+    checkConversions();
+    std::sort(findings.begin(), findings.end(), [](const LintFinding& a, const LintFinding& b) {
+        return a.line != b.line ? a.line < b.line : a.column < b.column;
+    });
+}
+
+VariableType UnitLinter::variableType(size_t k) const
+{
+    if (isAnyWord(k, NUMBER_TYPES, std::size(NUMBER_TYPES)))
+        return VariableType::Number;
+    if (isAnyWord(k, DATE_TYPES, std::size(DATE_TYPES)))
+        return VariableType::Date;
+    if (isAnyWord(k, TEXT_TYPES, std::size(TEXT_TYPES)))
+        return VariableType::Text;
+    return VariableType::Other;
+}
+
+// Collects the variables of declaration sections and checks the END of every subprogram
+void UnitLinter::scanDeclarations()
+{
+    bool inDeclarations = false;
+    bool atStatementStart = true;
+    // PROCEDURE or FUNCTION seen in the statement, so its IS or AS starts a body
+    bool inHeader = false;
+    size_t headerName = 0;
+    std::vector<OpenSubprogram> subprograms;
+    for (size_t k = 0; k < significant.size(); k++)
+    {
+        bool statementStart = atStatementStart;
+        atStatementStart = false;
+        if (statementStart)
+            inHeader = false;
+
+        if (statementStart && inDeclarations && tokenAt(k).type == TokenType::Word
+            && !isAnyWord(k, DECLARATION_KEYWORDS, std::size(DECLARATION_KEYWORDS)) && k + 1 < significant.size()
+            && (tokenAt(k + 1).type == TokenType::Word || tokenAt(k + 1).type == TokenType::QuotedIdentifier))
+        {
+            size_t typeToken = isWord(k + 1, "CONSTANT") ? k + 2 : k + 1;
+            variables.emplace(upperText(k), Variable{ k, variableType(typeToken) });
+        }
+
+        if (isSymbol(k, ";"))
+        {
+            atStatementStart = true;
+        }
+        else if (isWord(k, "PROCEDURE") || isWord(k, "FUNCTION"))
+        {
+            inHeader = true;
+            headerName = k + 1;
+            // Of schema-qualified names the last part is the label
+            while (isSymbol(headerName + 1, ".") && headerName + 2 < significant.size())
+                headerName += 2;
+        }
+        else if ((isWord(k, "IS") || isWord(k, "AS")) && inHeader && blocks.enclosingParen(significant[k]) == BlockMatches::NONE
+            && !isWord(k + 1, "LANGUAGE") && !isWord(k + 1, "EXTERNAL"))
+        {
+            subprograms.push_back({ headerName, false });
+            inDeclarations = true;
+            atStatementStart = true;
+            inHeader = false;
+        }
+        else if (isWord(k, "DECLARE"))
+        {
+            inDeclarations = true;
+            atStatementStart = true;
+        }
+        else if (isWord(k, "BEGIN"))
+        {
+            if (blocks.enclosingBlock(significant[k]) == BlockMatches::NONE && !subprograms.empty() && !subprograms.back().begun)
+                subprograms.back().begun = true;
+            inDeclarations = false;
+            atStatementStart = true;
+        }
+        else if (isWord(k, "END"))
+        {
+            uint32_t opener = blocks.partner(significant[k]);
+            if (opener != BlockMatches::NONE && tokenEquals(text.data(), tokens[opener], "BEGIN")
+                && blocks.enclosingBlock(opener) == BlockMatches::NONE)
+            {
+                if (!subprograms.empty() && subprograms.back().begun)
+                {
+                    checkEndLabel(k, subprograms.back().nameToken);
+                    subprograms.pop_back();
+                }
+                // Back in the declaration section of the enclosing subprogram
+                inDeclarations = !subprograms.empty();
+            }
+        }
+    }
+}
+
+void UnitLinter::checkEndLabel(size_t end, size_t nameToken)
+{
+    if (nameToken >= significant.size() || tokenAt(nameToken).type != TokenType::Word)
+        return;
+
+    std::string name = text.substr(tokenAt(nameToken).offset, tokenAt(nameToken).length);
+    if (isSymbol(end + 1, ";") || end + 1 == significant.size())
+        report(end, "END of " + name + " has no label");
+    else if (tokenAt(end + 1).type == TokenType::Word && upperText(end + 1) != upperText(nameToken))
+        report(end + 1, "END label " + text.substr(tokenAt(end + 1).offset, tokenAt(end + 1).length) + " isn't " + name);
+}
+
+void UnitLinter::checkUnused()
+{
+    std::unordered_map<std::string, size_t> uses;
+    for (size_t k = 0; k < significant.size(); k++)
+    {
+        if (tokenAt(k).type == TokenType::Word)
+        {
+            auto variable = variables.find(upperText(k));
+            if (variable != variables.end() && variable->second.token != k)
+                uses[variable->first]++;
+        }
+    }
+
+    for (auto& [name, variable] : variables)
+    {
+        if (uses.find(name) == uses.end())
+            report(variable.token, text.substr(tokenAt(variable.token).offset, tokenAt(variable.token).length) + " is never used");
+    }
+}
+
+// Handlers run to the next WHEN of their block or its END
+void UnitLinter::checkWhenOthers()
+{
+    for (size_t k = 0; k + 2 < significant.size(); k++)
+    {
+        if (!isWord(k, "WHEN") || !isWord(k + 1, "OTHERS") || !isWord(k + 2, "THEN"))
+            continue;
+
+        uint32_t block = blocks.enclosingBlock(significant[k]);
+        uint32_t blockEnd = block != BlockMatches::NONE ? blocks.partner(block) : BlockMatches::NONE;
+        bool raises = false;
+        for (size_t j = k + 3; j < significant.size() && !raises; j++)
+        {
+            if (significant[j] == blockEnd || (isWord(j, "WHEN") && blocks.enclosingBlock(significant[j]) == block))
+                break;
+            raises = isWord(j, "RAISE") || isWord(j, "RAISE_APPLICATION_ERROR");
+        }
+        if (!raises)
+            report(k, "WHEN OTHERS doesn't raise the exception again");
+    }
+}
+
+// A variable and a literal of another type on both sides of an assignment or comparison
+void UnitLinter::checkConversions()
+{
+    const char* const operators[] = { ":=", "=", "<>", "!=", "^=", "~=", "<", ">", "<=", ">=" };
+    for (size_t k = 1; k + 1 < significant.size(); k++)
+    {
+        if (!std::any_of(std::begin(operators), std::end(operators), [this, k](const char* op) { return isSymbol(k, op); }))
+            continue;
+
+        for (size_t side = 0; side < 2; side++)
+        {
+            size_t name = side == 0 ? k - 1 : k + 1;
+            size_t literal = side == 0 ? k + 1 : k - 1;
+            if (tokenAt(name).type != TokenType::Word || (name > 0 && isSymbol(name - 1, ".")))
+                continue;
+            auto variable = variables.find(upperText(name));
+            if (variable == variables.end())
+                continue;
+
+            TokenType literalType = tokenAt(literal).type;
+            std::string variableName = text.substr(tokenAt(name).offset, tokenAt(name).length);
+            if (literalType == TokenType::String && variable->second.type == VariableType::Number)
+                report(literal, "String implicitly converted to a number for " + variableName);
+            else if (literalType == TokenType::String && variable->second.type == VariableType::Date)
+                report(literal, "String implicitly converted to a date for " + variableName);
+            else if (literalType == TokenType::Number && variable->second.type == VariableType::Text)
+                report(literal, "Number implicitly converted for text " + variableName);
+        }
+    }
+}
+
+// Subprograms that aren't nested in another one, as ranges of tokens
+void findLintUnits(const CodeModel& model, std::vector<std::pair<size_t, size_t>>& units)
+{
+    std::vector<CodeSymbol> symbols;
+    findCodeSymbols(model, symbols);
+
+    const std::vector<Token>& tokens = model.tokens();
+    auto firstTokenAt = [&tokens](size_t offset) {
+        return static_cast<size_t>(std::lower_bound(tokens.begin(), tokens.end(), offset, [](const Token& token, size_t offset) {
+            return token.offset < offset;
+        }) - tokens.begin());
+    };
+
+    size_t unitEnd = 0;
+    for (auto& symbol : symbols)
+    {
+        if ((symbol.kind != CodeSymbolKind::Procedure && symbol.kind != CodeSymbolKind::Function) || symbol.declaration)
+            continue;
+
+        size_t begin = std::max(unitEnd, firstTokenAt(model.lineStart(symbol.startLine)));
+        size_t end = symbol.endLine + 1 < model.lineCount() ? firstTokenAt(model.lineStart(symbol.endLine + 1)) : tokens.size();
+        if (begin >= end)
+            continue;
+        units.emplace_back(begin, end);
+        unitEnd = end;
+    }
+
+    if (units.empty() && !tokens.empty())
+        units.emplace_back(0, tokens.size());
+}
+
+// Runs on a worker thread. Returns nothing once cancelled.
+std::vector<LintFinding> lintCode(const CodeModel& model, uint64_t generation)
+{
+    std::vector<std::pair<size_t, size_t>> units;
+    findLintUnits(model, units);
+
+    const std::vector<Token>& tokens = model.tokens();
+    std::vector<LintFinding> findings;
+    std::unordered_map<uint64_t, std::vector<LintFinding>> unitFindings;
+    for (auto [begin, end] : units)
+    {
+        if (lintGeneration != generation)
+            return {};
+
+        // Hashed from the start of its first line, as the columns on that line count from there
+        uint32_t firstLine = static_cast<uint32_t>(model.lineFromOffset(tokens[begin].offset));
+        size_t textStart = model.lineStart(firstLine);
+        size_t textEnd = tokens[end - 1].offset + tokens[end - 1].length;
+        uint64_t hash = hashBytes(model.text().data() + textStart, textEnd - textStart);
+        auto cached = lintCache.find(hash);
+        std::vector<LintFinding> checked;
+        if (cached != lintCache.end())
+            checked = cached->second;
+        else
+            UnitLinter(model, begin, end, checked).lint();
+
+        for (auto& finding : checked)
+            findings.push_back({ finding.line + firstLine, finding.column, finding.message });
+        unitFindings.emplace(hash, std::move(checked));
+    }
+
+    // Only subprograms still in the text are worth keeping
+    lintCache.swap(unitFindings);
+    return findings;
+}
+
+// IDE_SetErrorPosition moves the caret too, so the selection and scroll position are put back
+void markFindings(HWND editorWindow, std::vector<LintFinding> findings)
+{
+    if (editorWindow == markedEditor && findings == markedFindings)
+        return;
+
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+    int firstVisibleLine = SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0);
+
+    SendMessage(editorWindow, WM_SETREDRAW, FALSE, 0);
+    IDE_ClearErrorPositions();
+    for (auto& finding : findings)
+        IDE_SetErrorPosition(finding.line + 1, finding.column + 1);
+    SendMessage(editorWindow, EM_SETSEL, selectionStart, selectionEnd);
+    SendMessage(editorWindow, EM_LINESCROLL, 0, firstVisibleLine - SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0));
+    SendMessage(editorWindow, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(editorWindow, NULL, TRUE);
+
+    markedEditor = editorWindow;
+    markedFindings = std::move(findings);
+}
+
+void scheduleLint(UINT delay);
+
+void CALLBACK lintTimerProc(HWND, UINT, UINT_PTR, DWORD)
+{
+    if (runningPass != nullptr)
+    {
+        if (runningPass->findings.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+
+        std::vector<LintFinding> findings = runningPass->findings.get();
+        bool current = runningPass->generation == lintGeneration && IDE_WindowHasEditor(false)
+            && IDE_GetEditorHandle() == runningPass->editorWindow;
+        HWND editorWindow = runningPass->editorWindow;
+        runningPass.reset();
+        if (current)
+        {
+            KillTimer(NULL, lintTimer);
+            lintTimer = 0;
+            markFindings(editorWindow, std::move(findings));
+            return;
+        }
+    }
+
+    // Only procedure windows show error positions
+    CodeModel* model = IDE_GetWindowType() == PROCEDURE_WINDOW_TYPE ? getEditorCodeModel() : nullptr;
+    if (model == nullptr)
+    {
+        KillTimer(NULL, lintTimer);
+        lintTimer = 0;
+        return;
+    }
+
+    auto snapshot = std::make_shared<const CodeModel>(*model);
+    uint64_t generation = lintGeneration;
+    runningPass = std::make_unique<LintPass>();
+    runningPass->editorWindow = IDE_GetEditorHandle();
+    runningPass->generation = generation;
+    runningPass->findings = getWorkerPool().submit([snapshot, generation] { return lintCode(*snapshot, generation); });
+    scheduleLint(LINT_POLL_MS);
+}
+
+void scheduleLint(UINT delay)
+{
+    if (lintTimer != 0)
+        KillTimer(NULL, lintTimer);
+    lintTimer = SetTimer(NULL, 0, delay, lintTimerProc);
+}
+
+void noteLintEdit()
+{
+    lintGeneration++;
+    scheduleLint(LINT_DELAY_MS);
+}
+
+void goToLintFinding(size_t line)
+{
+    if (line >= markedFindings.size() || !IDE_WindowHasEditor(false) || IDE_GetEditorHandle() != markedEditor)
+        return;
+
+    IDE_SetCursor(markedFindings[line].column + 1, markedFindings[line].line + 1);
+    SendMessage(markedEditor, EM_SCROLLCARET, 0, 0);
+}
+
+void showLintFindings()
+{
+    CodeModel* model = getEditorCodeModel();
+    if (model == nullptr)
+        return;
+
+    // The cache is the running pass's until it's done
+    stopLint();
+    std::vector<LintFinding> findings = lintCode(*model, lintGeneration);
+    if (findings.empty())
+    {
+        IDE_SetStatusMessage("No lint findings");
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    std::string report;
+    for (auto& finding : findings)
+        report += std::to_string(finding.line + 1) + ":" + std::to_string(finding.column + 1) + " " + finding.message + "\n";
+    if (IDE_GetWindowType() == PROCEDURE_WINDOW_TYPE)
+    {
+        markFindings(IDE_GetEditorHandle(), std::move(findings));
+    }
+    else
+    {
+        markedEditor = IDE_GetEditorHandle();
+        markedFindings = std::move(findings);
+    }
+
+    static LogWindow findingsWindow(L"Lint findings", LINT_LOG_MAX_LINES, LINT_LOG_MAX_BYTES);
+    findingsWindow.setLineActivated(goToLintFinding);
+    findingsWindow.show();
+    findingsWindow.append(report);
+    findingsWindow.setStatus(std::to_wstring(markedFindings.size()) + L" findings");
+}
+
+void stopLint()
+{
+    if (lintTimer != 0)
+    {
+        KillTimer(NULL, lintTimer);
+        lintTimer = 0;
+    }
+    if (runningPass != nullptr)
+    {
+        lintGeneration++;
+        runningPass->findings.wait();
+        runningPass.reset();
+    }
+}
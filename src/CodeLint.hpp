@@ -0,0 +1,20 @@
+#pragma once
+
+#include "pch.h"
+
+// Checks the PL/SQL of procedure windows in the background and highlights the lines with
+// findings as error positions: variables never used, subprograms whose END lacks their name,
+// WHEN OTHERS handlers that don't raise, and variables compared with or assigned literals of
+// another type.
+//
+// A pass starts once typing pauses and runs on a worker thread over a copy of the window's
+// code model. Findings are kept per subprogram under a hash of its text, so only subprograms
+// changed since the last pass are checked again. A new edit cancels the running pass between
+// subprograms.
+
+// Called on change notifications of editor windows and when windows are created.
+void noteLintEdit();
+// Lists the findings of the current window.
+void showLintFindings();
+// Cancels and waits for a running pass. Called before the worker pool shuts down.
+void stopLint();
@@ -0,0 +1,169 @@
+#include "pch.h"
+#include <algorithm>
+#include <memory>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "CodeModel.hpp"
+
+struct EditorCodeModel
+{
+    HWND editorWindow;
+    bool changed;
+    CodeModel model;
+};
+
+std::vector<std::unique_ptr<EditorCodeModel>> editorCodeModels;
+uint64_t lastCodeModelVersion = 0;
+
+size_t CodeModel::lineFromOffset(size_t offset) const
+{
+    return std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin() - 1;
+}
+
+void CodeModel::update(std::string_view newText)
+{
+    size_t oldSize = content.size();
+    size_t newSize = newText.size();
+    size_t commonSize = std::min(oldSize, newSize);
+
+    size_t prefix = std::mismatch(content.begin(), content.begin() + commonSize, newText.begin()).first - content.begin();
+    if (prefix == commonSize && oldSize == newSize)
+        return;
+    size_t suffix = 0;
+    while (suffix < commonSize - prefix && content[oldSize - suffix - 1] == newText[newSize - suffix - 1])
+        suffix++;
+
+    ptrdiff_t delta = static_cast<ptrdiff_t>(newSize) - static_cast<ptrdiff_t>(oldSize);
+    size_t firstLine = lineFromOffset(prefix);
+    content.replace(prefix, oldSize - suffix - prefix, newText.substr(prefix, newSize - suffix - prefix));
+
+    std::vector<Token> newTokens;
+    std::vector<uint32_t> newLineStarts;
+    std::vector<LexerState> newLineStates;
+    size_t matchingOldLine;
+    lexLines(lineStarts[firstLine], lineStates[firstLine], newSize - suffix, delta, newTokens, newLineStarts, newLineStates, matchingOldLine);
+
+    // Replace the tokens of the lexed lines and shift the ones after them
+    auto tokenOffsetLess = [](const Token& token, size_t offset) { return token.offset < offset; };
+    size_t firstToken = std::lower_bound(tokenList.begin(), tokenList.end(), lineStarts[firstLine], tokenOffsetLess) - tokenList.begin();
+    size_t endToken = matchingOldLine < lineStarts.size()
+        ? std::lower_bound(tokenList.begin() + firstToken, tokenList.end(), lineStarts[matchingOldLine], tokenOffsetLess) - tokenList.begin()
+        : tokenList.size();
+    tokenList.erase(tokenList.begin() + firstToken, tokenList.begin() + endToken);
+    tokenList.insert(tokenList.begin() + firstToken, newTokens.begin(), newTokens.end());
+    for (size_t i = firstToken + newTokens.size(); i < tokenList.size(); i++)
+        tokenList[i].offset = static_cast<uint32_t>(tokenList[i].offset + delta);
+    blocks.repair(content, tokenList, firstToken, endToken - firstToken, newTokens.size());
+
+    lineStarts.erase(lineStarts.begin() + firstLine + 1, lineStarts.begin() + matchingOldLine);
+    lineStarts.insert(lineStarts.begin() + firstLine + 1, newLineStarts.begin(), newLineStarts.end());
+    for (size_t i = firstLine + 1 + newLineStarts.size(); i < lineStarts.size(); i++)
+        lineStarts[i] = static_cast<uint32_t>(lineStarts[i] + delta);
+
+    lineStates.erase(lineStates.begin() + firstLine + 1, lineStates.begin() + matchingOldLine);
+    lineStates.insert(lineStates.begin() + firstLine + 1, newLineStates.begin(), newLineStates.end());
+
+    currentVersion = ++lastCodeModelVersion;
+}
+
+void CodeModel::lexLines(size_t offset, LexerState state, size_t stableFrom, ptrdiff_t delta, std::vector<Token>& newTokens,
+    std::vector<uint32_t>& newLineStarts, std::vector<LexerState>& newLineStates, size_t& matchingOldLine) const
+{
+    while (true)
+    {
+        size_t lineEnd = content.find('\n', offset);
+        lineEnd = lineEnd == std::string::npos ? content.size() : lineEnd + 1;
+
+        BasicPlSqlLexer<char> lexer(content.data(), lineEnd, offset, state);
+        Token token;
+        while (lexer.next(token))
+            newTokens.push_back(token);
+        state = lexer.state();
+
+        if (lineEnd == content.size())
+        {
+            matchingOldLine = lineStarts.size();
+            return;
+        }
+
+        offset = lineEnd;
+        // Past the edit, text of a line starting where an old line did and in the same state
+        // lexes the same as before
+        if (offset >= stableFrom)
+        {
+            size_t oldOffset = static_cast<size_t>(static_cast<ptrdiff_t>(offset) - delta);
+            auto oldLine = std::lower_bound(lineStarts.begin(), lineStarts.end(), oldOffset);
+            if (oldLine != lineStarts.end() && *oldLine == oldOffset && lineStates[oldLine - lineStarts.begin()] == state)
+            {
+                matchingOldLine = oldLine - lineStarts.begin();
+                return;
+            }
+        }
+
+        newLineStarts.push_back(static_cast<uint32_t>(offset));
+        newLineStates.push_back(state);
+    }
+}
+
+CodeModel* getEditorCodeModel()
+{
+    if (!IDE_WindowHasEditor(false))
+        return nullptr;
+
+    // Models of closed windows aren't needed anymore
+    editorCodeModels.erase(std::remove_if(editorCodeModels.begin(), editorCodeModels.end(), [](const auto& editorModel) {
+        return !IsWindow(editorModel->editorWindow);
+    }), editorCodeModels.end());
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    auto editorModel = std::find_if(editorCodeModels.begin(), editorCodeModels.end(), [editorWindow](const auto& editorModel) {
+        return editorModel->editorWindow == editorWindow;
+    });
+    if (editorModel == editorCodeModels.end())
+    {
+        editorCodeModels.push_back(std::make_unique<EditorCodeModel>());
+        editorModel = editorCodeModels.end() - 1;
+        (*editorModel)->editorWindow = editorWindow;
+        (*editorModel)->changed = true;
+    }
+
+    if ((*editorModel)->changed)
+    {
+        const char* text = IDE_GetText();
+        (*editorModel)->model.update(text != NULL ? text : "");
+        (*editorModel)->changed = false;
+    }
+
+    return &(*editorModel)->model;
+}
+
+size_t toEditorPosition(HWND editorWindow, const CodeModel& model, size_t offset)
+{
+    size_t line = model.lineFromOffset(offset);
+    size_t lineStart = model.lineStart(line);
+    size_t column = toEditorString(std::string_view(model.text()).substr(lineStart, offset - lineStart)).size();
+    return SendMessage(editorWindow, EM_LINEINDEX, line, 0) + column;
+}
+
+size_t toModelOffset(HWND editorWindow, const CodeModel& model, size_t charIndex)
+{
+    size_t line = SendMessage(editorWindow, EM_LINEFROMCHAR, charIndex, 0);
+    if (line >= model.lineCount())
+        return model.text().size();
+
+    // Characters and ANSI bytes differ only in multibyte code pages, within the line
+    size_t column = charIndex - SendMessage(editorWindow, EM_LINEINDEX, line, 0);
+    size_t lineStart = model.lineStart(line);
+    size_t lineEnd = line + 1 < model.lineCount() ? model.lineStart(line + 1) : model.text().size();
+    EditorString lineText = toEditorString(std::string_view(model.text()).substr(lineStart, lineEnd - lineStart));
+    return lineStart + toAnsiString(EditorStringView(lineText).substr(0, std::min(column, lineText.size()))).size();
+}
+
+void noteEditorChanged(HWND editorWindow)
+{
+    for (auto& editorModel : editorCodeModels)
+    {
+        if (editorModel->editorWindow == editorWindow)
+            editorModel->changed = true;
+    }
+}
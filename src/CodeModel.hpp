@@ -0,0 +1,59 @@
+#pragma once
+
+#include "pch.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BlockMatches.hpp"
+#include "PlSqlLexer.hpp"
+
+// Tokens of an editor's text kept up to date incrementally.
+//
+// The text is lexed line by line and the lexer state at the start of every line is remembered,
+// so after an edit only the lines from the first changed one are lexed again, until a line
+// starts in the same state as before the edit; tokens and lines past it are only shifted.
+// Literals and comments spanning several lines are split into a token per line. The matching of
+// blocks is repaired along with the tokens.
+class CodeModel
+{
+public:
+    // Brings the model up to date with the new text of the editor.
+    void update(std::string_view newText);
+
+    const std::string& text() const { return content; }
+    const std::vector<Token>& tokens() const { return tokenList; }
+    size_t lineCount() const { return lineStarts.size(); }
+    size_t lineStart(size_t line) const { return lineStarts[line]; }
+    size_t lineFromOffset(size_t offset) const;
+    const BlockMatches& blockMatches() const { return blocks; }
+    // Changes with every update that changed the text. Versions are unique across models, so
+    // they can key caches of what's derived from a model.
+    uint64_t version() const { return currentVersion; }
+
+private:
+    // Lexes the lines of content starting at offset, appending their tokens and the states at
+    // the start of every line after the first. Stops at the first line starting at or after
+    // stableFrom whose state and offset match an old line, whose index is returned in
+    // matchingOldLine, or lineStarts.size() if the text ended first.
+    void lexLines(size_t offset, LexerState state, size_t stableFrom, ptrdiff_t delta, std::vector<Token>& newTokens,
+        std::vector<uint32_t>& newLineStarts, std::vector<LexerState>& newLineStates, size_t& matchingOldLine) const;
+
+    std::string content;
+    std::vector<uint32_t> lineStarts = { 0 };
+    std::vector<LexerState> lineStates = { LexerState() };
+    std::vector<Token> tokenList;
+    BlockMatches blocks;
+    uint64_t currentVersion = 0;
+};
+
+// Model of the current window's editor, updated if its text changed. Returns null if the window
+// has no editor.
+CodeModel* getEditorCodeModel();
+
+// Converts between offsets in the model's text and character indexes of the EM_ messages.
+size_t toEditorPosition(HWND editorWindow, const CodeModel& model, size_t offset);
+size_t toModelOffset(HWND editorWindow, const CodeModel& model, size_t charIndex);
+
+// Called on change notifications of editor windows.
+void noteEditorChanged(HWND editorWindow);
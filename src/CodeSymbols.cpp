@@ -0,0 +1,369 @@
+#include "pch.h"
+#include <algorithm>
+#include "PlSqlDevFunctions.hpp"
+#include "Autocomplete.hpp"
+#include "CodeModel.hpp"
+#include "EditorUtils.hpp"
+#include "Ui.hpp"
+#include "CodeSymbols.hpp"
+
+constexpr size_t MAX_SYMBOL_RESULTS = 100;
+constexpr size_t NO_TOKEN = SIZE_MAX;
+
+std::vector<CodeSymbol> codeSymbols;
+uint64_t codeSymbolsVersion = 0;
+
+const char* codeSymbolKindName(CodeSymbolKind kind)
+{
+    switch (kind)
+    {
+    case CodeSymbolKind::Package:
+        return "package";
+    case CodeSymbolKind::PackageBody:
+        return "package body";
+    case CodeSymbolKind::Type:
+        return "type";
+    case CodeSymbolKind::TypeBody:
+        return "type body";
+    case CodeSymbolKind::Procedure:
+        return "procedure";
+    case CodeSymbolKind::Function:
+        return "function";
+    case CodeSymbolKind::Cursor:
+        return "cursor";
+    }
+    return "";
+}
+
+// Walks the tokens once keeping a stack of open blocks and of symbols whose header was seen but
+// not yet what follows it: IS/AS opening the body, or the end of a declaration.
+class SymbolScanner
+{
+public:
+    SymbolScanner(const CodeModel& model, std::vector<CodeSymbol>& symbols)
+        : model(model), text(model.text().data()), tokens(model.tokens()), symbols(symbols)
+    {
+    }
+
+    void scan();
+
+private:
+    struct OpenBlock
+    {
+        // Index of the symbol whose body the block is, or -1
+        ptrdiff_t symbol;
+        // Blocks with a declaration section have their BEGIN still to come
+        bool awaitingBegin;
+    };
+
+    struct PendingSymbol
+    {
+        size_t symbol;
+        int parenDepth;
+        bool hasBody;
+    };
+
+    size_t nextSignificant(size_t index) const
+    {
+        while (index < tokens.size() && tokens[index].type == TokenType::Comment)
+            index++;
+        return index;
+    }
+
+    bool isWord(size_t index, const char* keyword) const
+    {
+        return index < tokens.size() && tokens[index].type == TokenType::Word && tokenEquals(text, tokens[index], keyword);
+    }
+
+    bool isSymbol(size_t index, char symbol) const
+    {
+        return index < tokens.size() && tokens[index].type == TokenType::Symbol && tokens[index].length == 1 && text[tokens[index].offset] == symbol;
+    }
+
+    uint32_t lineOf(size_t index) const
+    {
+        return static_cast<uint32_t>(model.lineFromOffset(tokens[index].offset));
+    }
+
+    bool isDeclarationStart(size_t previous) const;
+    bool isAloneOnLine(size_t index) const;
+    // Returns the index of the last token of the header, the name
+    size_t startSymbol(size_t keyword, size_t nameStart, CodeSymbolKind kind, bool hasBody);
+    void finishPending(uint32_t line);
+    void closeAll(uint32_t line);
+
+    const CodeModel& model;
+    const char* text;
+    const std::vector<Token>& tokens;
+    std::vector<CodeSymbol>& symbols;
+    std::vector<OpenBlock> blocks;
+    std::vector<PendingSymbol> pending;
+    int parenDepth = 0;
+    uint16_t symbolDepth = 0;
+};
+
+bool SymbolScanner::isDeclarationStart(size_t previous) const
+{
+    return previous == NO_TOKEN || isSymbol(previous, ';') || isSymbol(previous, '/') || isWord(previous, "IS") || isWord(previous, "AS")
+        || isWord(previous, "DECLARE") || isWord(previous, "CREATE") || isWord(previous, "REPLACE") || isWord(previous, "EDITIONABLE")
+        || isWord(previous, "NONEDITIONABLE");
+}
+
+// A slash alone on its line ends a PL/SQL unit in scripts
+bool SymbolScanner::isAloneOnLine(size_t index) const
+{
+    const std::string& content = model.text();
+    size_t line = lineOf(index);
+    size_t lineStart = model.lineStart(line);
+    size_t lineEnd = line + 1 < model.lineCount() ? model.lineStart(line + 1) : content.size();
+    for (size_t i = lineStart; i < lineEnd; i++)
+    {
+        if (i != tokens[index].offset && !BasicPlSqlLexer<char>::isWhitespace(content[i]))
+            return false;
+    }
+    return true;
+}
+
+size_t SymbolScanner::startSymbol(size_t keyword, size_t nameStart, CodeSymbolKind kind, bool hasBody)
+{
+    size_t name = nextSignificant(nameStart);
+    if (name >= tokens.size() || (tokens[name].type != TokenType::Word && tokens[name].type != TokenType::QuotedIdentifier))
+        return keyword;
+
+    // Of schema-qualified names only the object name is kept
+    while (isSymbol(nextSignificant(name + 1), '.'))
+    {
+        size_t part = nextSignificant(nextSignificant(name + 1) + 1);
+        if (part >= tokens.size() || (tokens[part].type != TokenType::Word && tokens[part].type != TokenType::QuotedIdentifier))
+            break;
+        name = part;
+    }
+
+    const Token& nameToken = tokens[name];
+    CodeSymbol symbol;
+    if (nameToken.type == TokenType::QuotedIdentifier)
+        symbol.name.assign(text + nameToken.offset + 1, nameToken.length > 1 ? nameToken.length - 1 - (text[nameToken.offset + nameToken.length - 1] == '"') : 0);
+    else
+        symbol.name.assign(text + nameToken.offset, nameToken.length);
+    symbol.kind = kind;
+    symbol.declaration = false;
+    symbol.depth = static_cast<uint16_t>(symbolDepth + pending.size());
+    symbol.nameOffset = nameToken.offset;
+    symbol.startLine = lineOf(keyword);
+    symbol.endLine = symbol.startLine;
+
+    pending.push_back({ symbols.size(), parenDepth, hasBody });
+    symbols.push_back(std::move(symbol));
+    return name;
+}
+
+// Headers still pending at the end of a declaration are declarations only
+void SymbolScanner::finishPending(uint32_t line)
+{
+    auto& finished = symbols[pending.back().symbol];
+    finished.endLine = line;
+    finished.declaration = pending.back().hasBody;
+    pending.pop_back();
+}
+
+void SymbolScanner::closeAll(uint32_t line)
+{
+    while (!pending.empty())
+        finishPending(line);
+    for (auto& block : blocks)
+    {
+        if (block.symbol >= 0)
+            symbols[block.symbol].endLine = line;
+    }
+    blocks.clear();
+    symbolDepth = 0;
+    parenDepth = 0;
+}
+
+void SymbolScanner::scan()
+{
+    size_t previous = NO_TOKEN;
+    for (size_t i = nextSignificant(0); i < tokens.size(); previous = i, i = nextSignificant(i + 1))
+    {
+        const Token& token = tokens[i];
+        if (token.type == TokenType::Symbol)
+        {
+            if (isSymbol(i, '('))
+            {
+                parenDepth++;
+            }
+            else if (isSymbol(i, ')') || isSymbol(i, ','))
+            {
+                // Ends subprogram declarations in the attribute list of object types
+                while (!pending.empty() && pending.back().hasBody && pending.back().parenDepth == parenDepth)
+                    finishPending(lineOf(i));
+                if (isSymbol(i, ')') && parenDepth > 0)
+                    parenDepth--;
+            }
+            else if (isSymbol(i, ';'))
+            {
+                while (!pending.empty())
+                    finishPending(lineOf(i));
+                parenDepth = 0;
+            }
+            else if (isSymbol(i, '/') && isAloneOnLine(i))
+            {
+                closeAll(lineOf(i));
+            }
+            continue;
+        }
+
+        if (token.type != TokenType::Word)
+            continue;
+        // %TYPE, record.type and similar aren't declarations
+        if (isSymbol(previous, '%') || isSymbol(previous, '.'))
+            continue;
+
+        if (isWord(i, "PROCEDURE") || isWord(i, "FUNCTION"))
+        {
+            if (!isWord(previous, "DROP"))
+                i = startSymbol(i, i + 1, isWord(i, "PROCEDURE") ? CodeSymbolKind::Procedure : CodeSymbolKind::Function, true);
+        }
+        else if (isWord(i, "PACKAGE") || isWord(i, "TYPE"))
+        {
+            if (isDeclarationStart(previous))
+            {
+                size_t next = nextSignificant(i + 1);
+                bool isBody = isWord(next, "BODY");
+                if (isWord(i, "PACKAGE"))
+                    i = startSymbol(i, isBody ? next + 1 : next, isBody ? CodeSymbolKind::PackageBody : CodeSymbolKind::Package, true);
+                else
+                    i = startSymbol(i, isBody ? next + 1 : next, isBody ? CodeSymbolKind::TypeBody : CodeSymbolKind::Type, isBody);
+            }
+        }
+        else if (isWord(i, "CURSOR"))
+        {
+            if (isDeclarationStart(previous))
+                i = startSymbol(i, i + 1, CodeSymbolKind::Cursor, false);
+        }
+        else if (isWord(i, "IS") || isWord(i, "AS"))
+        {
+            if (!pending.empty() && pending.back().hasBody && pending.back().parenDepth == parenDepth)
+            {
+                // External subprograms have no body
+                size_t next = nextSignificant(i + 1);
+                if (!isWord(next, "LANGUAGE") && !isWord(next, "EXTERNAL"))
+                {
+                    blocks.push_back({ static_cast<ptrdiff_t>(pending.back().symbol), true });
+                    pending.pop_back();
+                    symbolDepth++;
+                }
+            }
+        }
+        else if (isWord(i, "DECLARE"))
+        {
+            blocks.push_back({ -1, true });
+        }
+        else if (isWord(i, "BEGIN"))
+        {
+            if (!blocks.empty() && blocks.back().awaitingBegin)
+                blocks.back().awaitingBegin = false;
+            else
+                blocks.push_back({ -1, false });
+        }
+        else if (isWord(i, "CASE") || isWord(i, "IF") || isWord(i, "LOOP"))
+        {
+            // END IF, END LOOP and END CASE were handled by their END
+            if (!isWord(previous, "END"))
+                blocks.push_back({ -1, false });
+        }
+        else if (isWord(i, "END"))
+        {
+            if (!blocks.empty())
+            {
+                if (blocks.back().symbol >= 0)
+                {
+                    symbols[blocks.back().symbol].endLine = lineOf(i);
+                    symbolDepth--;
+                }
+                blocks.pop_back();
+            }
+        }
+    }
+
+    if (!tokens.empty())
+        closeAll(lineOf(tokens.size() - 1));
+}
+
+void findCodeSymbols(const CodeModel& model, std::vector<CodeSymbol>& symbols)
+{
+    SymbolScanner(model, symbols).scan();
+}
+
+void goToSymbol()
+{
+    CodeModel* model = getEditorCodeModel();
+    if (model == nullptr)
+        return;
+
+    if (codeSymbolsVersion != model->version() || model->version() == 0)
+    {
+        codeSymbols.clear();
+        findCodeSymbols(*model, codeSymbols);
+        codeSymbolsVersion = model->version();
+    }
+    if (codeSymbols.empty())
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    std::wstring query;
+    if (!showInputBox(L"Go to symbol", L"Name or some of its letters in order:", query))
+        return;
+
+    std::string ansiQuery = toAnsiString(query);
+    std::vector<std::pair<int, size_t>> matches;
+    for (size_t i = 0; i < codeSymbols.size(); i++)
+    {
+        int score = ansiQuery.empty() ? 0 : fuzzyMatchScore(ansiQuery, codeSymbols[i].name);
+        if (score >= 0)
+            matches.emplace_back(score, i);
+    }
+    if (matches.empty())
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    // Best matches first, in document order among equally good ones
+    std::stable_sort(matches.begin(), matches.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    if (matches.size() > MAX_SYMBOL_RESULTS)
+        matches.resize(MAX_SYMBOL_RESULTS);
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    size_t picked = 0;
+    if (matches.size() > 1)
+    {
+        std::vector<std::wstring> items;
+        items.reserve(matches.size());
+        for (auto& match : matches)
+        {
+            const CodeSymbol& symbol = codeSymbols[match.second];
+            std::string description = codeSymbolKindName(symbol.kind);
+            if (symbol.declaration)
+                description += " declaration";
+            items.push_back(std::wstring(symbol.depth * 2, L' ') + toEditorString(symbol.name) + EDT_TX('\t')
+                + toEditorString(description) + L", line " + std::to_wstring(symbol.startLine + 1));
+        }
+
+        int selectionStart, selectionEnd;
+        SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+        int pickedItem = showPopupList(editorWindow, getCharScreenPosition(editorWindow, selectionEnd), items);
+        if (pickedItem < 0)
+            return;
+        picked = pickedItem;
+    }
+
+    const CodeSymbol& symbol = codeSymbols[matches[picked].second];
+    size_t nameLine = model->lineFromOffset(symbol.nameOffset);
+    size_t nameLineStart = model->lineStart(nameLine);
+    auto column = toEditorString(std::string_view(model->text()).substr(nameLineStart, symbol.nameOffset - nameLineStart)).size();
+    IDE_SetCursor(static_cast<int>(column) + 1, static_cast<int>(nameLine) + 1);
+    SendMessage(editorWindow, EM_SCROLLCARET, 0, 0);
+}
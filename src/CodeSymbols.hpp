@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CodeModel;
+
+enum class CodeSymbolKind : uint8_t
+{
+    Package,
+    PackageBody,
+    Type,
+    TypeBody,
+    Procedure,
+    Function,
+    Cursor,
+};
+
+const char* codeSymbolKindName(CodeSymbolKind kind);
+
+struct CodeSymbol
+{
+    std::string name;
+    CodeSymbolKind kind;
+    // Forward declarations and subprograms of specifications, which have no body
+    bool declaration;
+    // Number of symbols the symbol is nested in
+    uint16_t depth;
+    uint32_t nameOffset;
+    uint32_t startLine;
+    uint32_t endLine;
+};
+
+// Outline of the model's text in document order. Spans of units with a body are found by
+// matching their BEGIN, CASE, IF and LOOP blocks with END.
+void findCodeSymbols(const CodeModel& model, std::vector<CodeSymbol>& symbols);
+
+void goToSymbol();
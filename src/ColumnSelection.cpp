@@ -0,0 +1,434 @@
+#include "pch.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "ColumnSelection.hpp"
+
+struct ColumnBlock
+{
+    // NULL when there's no block
+    HWND editorWindow;
+    // The anchor corner stays where the block was started, the caret corner moves when it's extended
+    int anchorLine;
+    int anchorColumn;
+    int caretLine;
+    int caretColumn;
+
+    int topLine() const { return std::min(anchorLine, caretLine); }
+    int bottomLine() const { return std::max(anchorLine, caretLine); }
+    int leftColumn() const { return std::min(anchorColumn, caretColumn); }
+    int rightColumn() const { return std::max(anchorColumn, caretColumn); }
+};
+
+// The lines covered by the block, read at once from the whole text
+struct BlockLines
+{
+    // Character indexes of the start of the first line and the end of the last one
+    int start;
+    int end;
+    EditorString text;
+    std::vector<EditorStringView> lines;
+};
+
+ColumnBlock columnBlock = {};
+std::vector<HWND> columnSelectionEditors;
+// Releasing Alt after extending the block would otherwise activate the menu bar
+bool swallowAltRelease = false;
+
+int columnOfChar(EditorStringView line, size_t index)
+{
+    int column = 0;
+    for (size_t i = 0; i < index && i < line.size(); i++)
+        column += line[i] == EDT_TX('\t') ? EDITOR_TAB_WIDTH : 1;
+    return column;
+}
+
+// Index of the first character starting at or after the column, or the length of shorter lines
+size_t charAtColumn(EditorStringView line, int column)
+{
+    int lineColumn = 0;
+    size_t i = 0;
+    for (; i < line.size() && lineColumn < column; i++)
+        lineColumn += line[i] == EDT_TX('\t') ? EDITOR_TAB_WIDTH : 1;
+    return i;
+}
+
+EditorString getLineText(HWND editorWindow, int line)
+{
+    int lineStart = SendMessage(editorWindow, EM_LINEINDEX, line, 0);
+    int lineLength = lineStart < 0 ? 0 : SendMessage(editorWindow, EM_LINELENGTH, lineStart, 0);
+    if (lineLength == 0)
+        return EditorString();
+
+    EditorString text(lineLength, EDT_TX('\0'));
+    text[0] = lineLength;
+    text.resize(std::clamp(static_cast<int>(SendMessage(editorWindow, EM_GETLINE, line, reinterpret_cast<LPARAM>(text.data()))), 0, lineLength));
+    return text;
+}
+
+void getCharLineColumn(HWND editorWindow, int charIndex, int& line, int& column)
+{
+    line = SendMessage(editorWindow, EM_LINEFROMCHAR, charIndex, 0);
+    int lineStart = SendMessage(editorWindow, EM_LINEINDEX, line, 0);
+    column = columnOfChar(getLineText(editorWindow, line), charIndex - lineStart);
+}
+
+// Moves the editor's caret to the caret corner, so the editor scrolls along with the block
+void placeCaret()
+{
+    HWND editorWindow = columnBlock.editorWindow;
+    int lineStart = SendMessage(editorWindow, EM_LINEINDEX, columnBlock.caretLine, 0);
+    int caret = lineStart + static_cast<int>(charAtColumn(getLineText(editorWindow, columnBlock.caretLine), columnBlock.caretColumn));
+    SendMessage(editorWindow, EM_SETSEL, caret, caret);
+    SendMessage(editorWindow, EM_SCROLLCARET, 0, 0);
+}
+
+// Frames the block over what the editor painted, or draws a bar where it has no width
+void paintColumnBlock(HWND editorWindow)
+{
+    TEXTMETRIC textMetric = {};
+    HDC dc = GetDC(editorWindow);
+    HGDIOBJ previousFont = SelectObject(dc, reinterpret_cast<HGDIOBJ>(SendMessage(editorWindow, WM_GETFONT, 0, 0)));
+    GetTextMetrics(dc, &textMetric);
+    SelectObject(dc, previousFont);
+    int lineHeight = std::max(1, static_cast<int>(textMetric.tmHeight));
+    int charWidth = std::max(1, static_cast<int>(textMetric.tmAveCharWidth));
+
+    // Lines start at the same x, wherever they are scrolled to
+    POINTL top = {};
+    POINTL bottom = {};
+    SendMessage(editorWindow, EM_POSFROMCHAR, reinterpret_cast<WPARAM>(&top), SendMessage(editorWindow, EM_LINEINDEX, columnBlock.topLine(), 0));
+    SendMessage(editorWindow, EM_POSFROMCHAR, reinterpret_cast<WPARAM>(&bottom), SendMessage(editorWindow, EM_LINEINDEX, columnBlock.bottomLine(), 0));
+    RECT block = { top.x + columnBlock.leftColumn() * charWidth, top.y, top.x + columnBlock.rightColumn() * charWidth, bottom.y + lineHeight };
+
+    HBRUSH brush = GetSysColorBrush(COLOR_HIGHLIGHT);
+    if (block.right == block.left)
+    {
+        block.right = block.left + 2;
+        FillRect(dc, &block, brush);
+    }
+    else
+        FrameRect(dc, &block, brush);
+    ReleaseDC(editorWindow, dc);
+}
+
+// Subclassed with SetWindowSubclass, so that it can be removed in any order with other subclasses
+LRESULT CALLBACK columnSelectionEditorProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam, UINT_PTR subclassId, DWORD_PTR)
+{
+    if (message == WM_NCDESTROY)
+    {
+        RemoveWindowSubclass(window, columnSelectionEditorProc, subclassId);
+        columnSelectionEditors.erase(std::remove(columnSelectionEditors.begin(), columnSelectionEditors.end(), window), columnSelectionEditors.end());
+        if (columnBlock.editorWindow == window)
+            columnBlock.editorWindow = NULL;
+        return DefSubclassProc(window, message, wParam, lParam);
+    }
+
+    LRESULT result = DefSubclassProc(window, message, wParam, lParam);
+    if (message == WM_PAINT && columnBlock.editorWindow == window)
+        paintColumnBlock(window);
+    return result;
+}
+
+void activateColumnBlock(HWND editorWindow)
+{
+    if (std::find(columnSelectionEditors.begin(), columnSelectionEditors.end(), editorWindow) == columnSelectionEditors.end())
+    {
+        SetWindowSubclass(editorWindow, columnSelectionEditorProc, 0, 0);
+        columnSelectionEditors.push_back(editorWindow);
+    }
+    columnBlock.editorWindow = editorWindow;
+    placeCaret();
+    InvalidateRect(editorWindow, NULL, FALSE);
+}
+
+void endColumnSelection()
+{
+    if (columnBlock.editorWindow == NULL)
+        return;
+
+    InvalidateRect(columnBlock.editorWindow, NULL, FALSE);
+    columnBlock.editorWindow = NULL;
+}
+
+bool getBlockLines(BlockLines& block)
+{
+    HWND editorWindow = columnBlock.editorWindow;
+    block.start = SendMessage(editorWindow, EM_LINEINDEX, columnBlock.topLine(), 0);
+    int lastLineStart = SendMessage(editorWindow, EM_LINEINDEX, columnBlock.bottomLine(), 0);
+    if (block.start < 0 || lastLineStart < 0)
+        return false;
+    block.end = lastLineStart + SendMessage(editorWindow, EM_LINELENGTH, lastLineStart, 0);
+
+    block.text = getEditorText(editorWindow);
+    block.end = std::min(block.end, static_cast<int>(block.text.size()));
+    block.start = std::min(block.start, block.end);
+    block.lines = splitLines(EditorStringView(block.text).substr(block.start, block.end - block.start));
+    return true;
+}
+
+// Rewrites the covered lines with a single replacement and collapses the block to the column
+template<typename LineEdit>
+void editBlockLines(LineEdit editLine, int column)
+{
+    BlockLines block;
+    if (IDE_GetReadOnly() || !getBlockLines(block))
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    EditorString replacement;
+    replacement.reserve(block.end - block.start + block.lines.size() * 2);
+    EditorString line;
+    for (size_t row = 0; row < block.lines.size(); row++)
+    {
+        line.assign(block.lines[row]);
+        editLine(line, row);
+        if (row > 0)
+            replacement += EDT_TX("\r\n");
+        replacement += line;
+    }
+
+    columnBlock.anchorColumn = column;
+    columnBlock.caretColumn = column;
+    HWND editorWindow = columnBlock.editorWindow;
+    if (EditorStringView(replacement) != EditorStringView(block.text).substr(block.start, block.end - block.start))
+    {
+        int firstVisibleLine = SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0);
+        SendMessage(editorWindow, WM_SETREDRAW, FALSE, 0);
+        SendMessage(editorWindow, EM_SETSEL, block.start, block.end);
+        SendMessage(editorWindow, EM_REPLACESEL, TRUE, reinterpret_cast<LPARAM>(replacement.c_str()));
+        SendMessage(editorWindow, EM_LINESCROLL, 0, firstVisibleLine - SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0));
+        SendMessage(editorWindow, WM_SETREDRAW, TRUE, 0);
+    }
+    placeCaret();
+    InvalidateRect(editorWindow, NULL, TRUE);
+}
+
+// Lines shorter than the left column are padded with spaces before the insertion
+void replaceColumns(EditorString& line, int left, int right, EditorStringView insertion)
+{
+    size_t from = charAtColumn(line, left);
+    size_t to = charAtColumn(line, right);
+    if (from == line.size())
+    {
+        if (insertion.empty())
+            return;
+        line.append(std::max(0, left - columnOfChar(line, line.size())), EDT_TX(' '));
+        from = to = line.size();
+    }
+    line.replace(from, to - from, insertion);
+}
+
+void typeInBlock(EDITOR_CHAR c)
+{
+    int left = columnBlock.leftColumn();
+    int right = columnBlock.rightColumn();
+    editBlockLines([&](EditorString& line, size_t) {
+        replaceColumns(line, left, right, EditorStringView(&c, 1));
+    }, left + (c == EDT_TX('\t') ? EDITOR_TAB_WIDTH : 1));
+}
+
+// Without width, deletes the character before or after the column on each line reaching it
+void deleteInBlock(bool backward)
+{
+    int left = columnBlock.leftColumn();
+    int right = columnBlock.rightColumn();
+    if (left < right)
+    {
+        editBlockLines([&](EditorString& line, size_t) { replaceColumns(line, left, right, EditorStringView()); }, left);
+        return;
+    }
+    if (backward && left == 0)
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    editBlockLines([&](EditorString& line, size_t) {
+        size_t at = charAtColumn(line, left);
+        if (columnOfChar(line, at) < left)
+            return;
+        if (backward)
+            line.erase(at - 1, 1);
+        else if (at < line.size())
+            line.erase(at, 1);
+    }, backward ? left - 1 : left);
+}
+
+bool copyBlock()
+{
+    BlockLines block;
+    if (!getBlockLines(block))
+        return false;
+
+    int left = columnBlock.leftColumn();
+    int right = columnBlock.rightColumn();
+    EditorString copied;
+    for (size_t row = 0; row < block.lines.size(); row++)
+    {
+        EditorStringView line = block.lines[row];
+        size_t from = charAtColumn(line, left);
+        if (row > 0)
+            copied += EDT_TX("\r\n");
+        copied += line.substr(from, charAtColumn(line, right) - from);
+    }
+    if (!setClipboardText(columnBlock.editorWindow, copied))
+        return false;
+
+    IDE_SetStatusMessage((std::to_string(block.lines.size()) + " lines copied").c_str());
+    return true;
+}
+
+// A single line goes to every line of the block, several go one per line
+void pasteIntoBlock()
+{
+    EditorString pasted = getClipboardText(columnBlock.editorWindow);
+    std::vector<EditorStringView> pastedLines = splitLines(pasted);
+    if (pastedLines.size() > 1 && pastedLines.back().empty())
+        pastedLines.pop_back();
+
+    int left = columnBlock.leftColumn();
+    int right = columnBlock.rightColumn();
+    editBlockLines([&](EditorString& line, size_t row) {
+        EditorStringView insertion = pastedLines.size() == 1 ? pastedLines[0] : row < pastedLines.size() ? pastedLines[row] : EditorStringView();
+        replaceColumns(line, left, right, insertion);
+    }, left + columnOfChar(pastedLines[0], pastedLines[0].size()));
+}
+
+void extendColumnSelection(WPARAM key)
+{
+    HWND editorWindow = IDE_GetEditorHandle();
+    if (columnBlock.editorWindow != editorWindow)
+    {
+        endColumnSelection();
+        int selectionStart, selectionEnd;
+        SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+        getCharLineColumn(editorWindow, selectionEnd, columnBlock.caretLine, columnBlock.caretColumn);
+        columnBlock.anchorLine = columnBlock.caretLine;
+        columnBlock.anchorColumn = columnBlock.caretColumn;
+    }
+
+    int lastLine = SendMessage(editorWindow, EM_GETLINECOUNT, 0, 0) - 1;
+    switch (key)
+    {
+    case VK_LEFT:
+        columnBlock.caretColumn = std::max(0, columnBlock.caretColumn - 1);
+        break;
+    case VK_RIGHT:
+        columnBlock.caretColumn++;
+        break;
+    case VK_UP:
+        columnBlock.caretLine = std::max(0, columnBlock.caretLine - 1);
+        break;
+    case VK_DOWN:
+        columnBlock.caretLine = std::min(lastLine, columnBlock.caretLine + 1);
+        break;
+    }
+    activateColumnBlock(editorWindow);
+}
+
+void startColumnSelection()
+{
+    if (!IDE_WindowHasEditor(false))
+        return;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    endColumnSelection();
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+    getCharLineColumn(editorWindow, selectionStart, columnBlock.anchorLine, columnBlock.anchorColumn);
+    getCharLineColumn(editorWindow, selectionEnd, columnBlock.caretLine, columnBlock.caretColumn);
+    activateColumnBlock(editorWindow);
+}
+
+bool handleColumnSelectionMessage(const MSG& msg)
+{
+    bool control = GetKeyState(VK_CONTROL) & 0x8000;
+    bool shift = GetKeyState(VK_SHIFT) & 0x8000;
+    bool alt = GetKeyState(VK_MENU) & 0x8000;
+    bool arrowKey = msg.wParam == VK_LEFT || msg.wParam == VK_RIGHT || msg.wParam == VK_UP || msg.wParam == VK_DOWN;
+
+    switch (msg.message)
+    {
+    case WM_SYSKEYDOWN:
+        if (alt && shift && !control && arrowKey && IDE_WindowHasEditor(false) && msg.hwnd == IDE_GetEditorHandle())
+        {
+            extendColumnSelection(msg.wParam);
+            swallowAltRelease = true;
+            return true;
+        }
+        if (msg.hwnd == columnBlock.editorWindow && msg.wParam != VK_SHIFT && msg.wParam != VK_MENU)
+            endColumnSelection();
+        return false;
+    case WM_SYSKEYUP:
+    case WM_KEYUP:
+        if (msg.wParam != VK_MENU || !swallowAltRelease)
+            return false;
+        swallowAltRelease = false;
+        return true;
+    case WM_KEYDOWN:
+        if (msg.hwnd != columnBlock.editorWindow || msg.wParam == VK_SHIFT || msg.wParam == VK_CONTROL || msg.wParam == VK_MENU)
+            return false;
+        if (control && !alt)
+        {
+            switch (msg.wParam)
+            {
+            case 'C':
+                if (!copyBlock())
+                    MessageBeep(MB_OK);
+                return true;
+            case 'X':
+                // Deleting in a zero-width block would take the character after it, which wasn't cut
+                if (!copyBlock())
+                    MessageBeep(MB_OK);
+                else if (columnBlock.leftColumn() < columnBlock.rightColumn())
+                    deleteInBlock(false);
+                return true;
+            case 'V':
+                pasteIntoBlock();
+                return true;
+            }
+        }
+        if (!control && !alt)
+        {
+            switch (msg.wParam)
+            {
+            case VK_BACK:
+                deleteInBlock(true);
+                return true;
+            case VK_DELETE:
+                deleteInBlock(false);
+                return true;
+            case VK_TAB:
+                typeInBlock(EDT_TX('\t'));
+                return true;
+            }
+        }
+        // Printable keys come back as WM_CHAR, anything else leaves column mode
+        if (control || alt || arrowKey || msg.wParam == VK_ESCAPE || msg.wParam == VK_RETURN
+            || msg.wParam == VK_HOME || msg.wParam == VK_END || msg.wParam == VK_PRIOR || msg.wParam == VK_NEXT)
+            endColumnSelection();
+        return false;
+    case WM_CHAR:
+        if (msg.hwnd != columnBlock.editorWindow || msg.wParam < 0x20 || msg.wParam == 0x7F)
+            return false;
+        typeInBlock(static_cast<EDITOR_CHAR>(msg.wParam));
+        return true;
+    case WM_LBUTTONDOWN:
+        endColumnSelection();
+        return false;
+    }
+    return false;
+}
+
+void removeColumnSelection()
+{
+    endColumnSelection();
+    for (HWND editorWindow : columnSelectionEditors)
+        RemoveWindowSubclass(editorWindow, columnSelectionEditorProc, 0);
+    columnSelectionEditors.clear();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "pch.h"
+
+// Rectangular selections: a range of lines times a range of visual columns, tabs counting as
+// EDITOR_TAB_WIDTH columns. Typing, Backspace, Delete, cut and paste apply to every line of the
+// block as one replacement of the lines it covers, so they're undone in one step however many
+// lines there are. Lines shorter than the block are padded with spaces when text is inserted.
+//
+// Alt+Shift+arrows start a block at the caret or extend it. Escape, Enter, navigation keys,
+// other shortcuts and clicks end it.
+
+// Turns the current selection into a block with the same corners.
+void startColumnSelection();
+// Called for the messages of the editor windows. Returns true if the message was handled and
+// mustn't reach the editor.
+bool handleColumnSelectionMessage(const MSG& msg);
+void removeColumnSelection();
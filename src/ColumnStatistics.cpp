@@ -0,0 +1,305 @@
+#include "pch.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include "PlSqlDevFunctions.hpp"
+#include "BitUtils.hpp"
+#include "EditorUtils.hpp"
+#include "Hash.hpp"
+#include "Ui.hpp"
+#include "ColumnStatistics.hpp"
+
+constexpr int DISTINCT_COUNTER_PRECISION = 14;
+constexpr size_t DISTINCT_COUNTER_REGISTERS = size_t(1) << DISTINCT_COUNTER_PRECISION;
+constexpr size_t MAX_SAMPLE_LENGTH = 30;
+// Doubles hold 17 significant digits at most, further ones only move the exponent
+constexpr int MAX_MANTISSA_DIGITS = 18;
+
+DistinctCounter::DistinctCounter()
+    : registers(DISTINCT_COUNTER_REGISTERS, 0)
+{
+}
+
+void DistinctCounter::add(uint64_t hash)
+{
+    size_t index = static_cast<size_t>(hash >> (64 - DISTINCT_COUNTER_PRECISION));
+    // The guard bit caps the rank when the remaining bits are all zero
+    uint64_t remaining = (hash << DISTINCT_COUNTER_PRECISION) | (uint64_t(1) << (DISTINCT_COUNTER_PRECISION - 1));
+    uint8_t rank = static_cast<uint8_t>(64 - highestSetBit(remaining));
+
+    if (registers[index] < rank)
+        registers[index] = rank;
+}
+
+size_t DistinctCounter::estimate() const
+{
+    double registerCount = static_cast<double>(registers.size());
+    double inverseSum = 0;
+    size_t zeroRegisters = 0;
+    for (uint8_t rank : registers)
+    {
+        inverseSum += std::ldexp(1.0, -rank);
+        zeroRegisters += rank == 0;
+    }
+
+    double alpha = 0.7213 / (1 + 1.079 / registerCount);
+    double estimate = alpha * registerCount * registerCount / inverseSum;
+    // Small cardinalities are counted far more precisely by the share of untouched registers
+    if (estimate <= 2.5 * registerCount && zeroRegisters > 0)
+        estimate = registerCount * std::log(registerCount / zeroRegisters);
+
+    return static_cast<size_t>(estimate + 0.5);
+}
+
+NumberSummary summarizeNumbers(const double* values, size_t count)
+{
+    // Two independent accumulators per operation keep the additions from waiting on each other
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    __m128d min0 = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    __m128d min1 = min0;
+    __m128d max0 = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+    __m128d max1 = max0;
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128d first = _mm_loadu_pd(values + i);
+        __m128d second = _mm_loadu_pd(values + i + 2);
+        sum0 = _mm_add_pd(sum0, first);
+        sum1 = _mm_add_pd(sum1, second);
+        min0 = _mm_min_pd(min0, first);
+        min1 = _mm_min_pd(min1, second);
+        max0 = _mm_max_pd(max0, first);
+        max1 = _mm_max_pd(max1, second);
+    }
+
+    double lanes[2];
+    NumberSummary summary;
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    summary.sum = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, _mm_min_pd(min0, min1));
+    summary.min = std::min(lanes[0], lanes[1]);
+    _mm_storeu_pd(lanes, _mm_max_pd(max0, max1));
+    summary.max = std::max(lanes[0], lanes[1]);
+
+    for (; i < count; i++)
+    {
+        summary.sum += values[i];
+        summary.min = std::min(summary.min, values[i]);
+        summary.max = std::max(summary.max, values[i]);
+    }
+
+    return summary;
+}
+
+// Parses numbers as the grid shows them, with '.' or ',' as the decimal separator depending on
+// NLS settings. Values with group separators or other text are not numbers.
+bool parseGridNumber(std::string_view text, double& value)
+{
+    static const double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    size_t i = 0;
+    while (i < text.size() && text[i] == ' ')
+        i++;
+
+    bool negative = i < text.size() && text[i] == '-';
+    if (i < text.size() && (text[i] == '-' || text[i] == '+'))
+        i++;
+
+    uint64_t mantissa = 0;
+    int mantissaDigits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    bool inFraction = false;
+    for (; i < text.size(); i++)
+    {
+        char c = text[i];
+        if (c >= '0' && c <= '9')
+        {
+            hasDigits = true;
+            if (mantissaDigits < MAX_MANTISSA_DIGITS)
+            {
+                if (mantissa != 0 || c != '0')
+                    mantissaDigits++;
+                mantissa = mantissa * 10 + (c - '0');
+                exponent -= inFraction;
+            }
+            else
+            {
+                exponent += !inFraction;
+            }
+        }
+        else if ((c == '.' || c == ',') && !inFraction)
+        {
+            inFraction = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (!hasDigits)
+        return false;
+
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E'))
+    {
+        i++;
+        bool negativeExponent = i < text.size() && text[i] == '-';
+        if (i < text.size() && (text[i] == '-' || text[i] == '+'))
+            i++;
+        int explicitExponent = 0;
+        bool hasExponentDigits = false;
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++)
+        {
+            hasExponentDigits = true;
+            explicitExponent = std::min(explicitExponent * 10 + (text[i] - '0'), 10000);
+        }
+        if (!hasExponentDigits)
+            return false;
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    while (i < text.size() && text[i] == ' ')
+        i++;
+    if (i != text.size())
+        return false;
+
+    value = static_cast<double>(mantissa);
+    if (exponent != 0)
+    {
+        if (exponent > 0 && exponent <= 22)
+            value *= POWERS_OF_TEN[exponent];
+        else if (exponent < 0 && exponent >= -22)
+            value /= POWERS_OF_TEN[-exponent];
+        else
+            value *= std::pow(10.0, exponent);
+    }
+    if (negative)
+        value = -value;
+
+    return true;
+}
+
+std::wstring formatNumber(double value)
+{
+    std::wostringstream text;
+    text.precision(15);
+    text << value;
+    return text.str();
+}
+
+bool pickResultGridColumn(int columnCount, int& column)
+{
+    std::vector<std::wstring> items;
+    for (int i = 0; i < columnCount; i++)
+    {
+        // The grid doesn't expose column names, so the first value helps telling columns apart
+        const char* sample = IDE_ResultGridCell(i, 0);
+        std::string sampleText = sample != NULL ? sample : "";
+        if (sampleText.size() > MAX_SAMPLE_LENGTH)
+            sampleText = sampleText.substr(0, MAX_SAMPLE_LENGTH) + "...";
+        items.push_back(L"Column " + std::to_wstring(i + 1) + L"\t" + toEditorString(sampleText));
+    }
+
+    POINT cursorPosition;
+    GetCursorPos(&cursorPosition);
+    column = showPopupList(IDE_GetWindowHandle(), cursorPosition, items);
+    return column >= 0;
+}
+
+void showResultGridColumnStatistics()
+{
+    int columnCount = IDE_ResultGridColCount();
+    int rowCount = IDE_ResultGridRowCount();
+    if (columnCount <= 0 || rowCount <= 0)
+    {
+        showMessage(L"The current window has no result grid rows.", MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    int column;
+    if (!pickResultGridColumn(columnCount, column))
+        return;
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Each cell is fetched and parsed once into a packed array the reductions then run over
+    std::vector<double> numbers;
+    numbers.reserve(rowCount);
+    DistinctCounter distinctCounter;
+    size_t nullCount = 0;
+    size_t textCount = 0;
+    std::string minText;
+    std::string maxText;
+    for (int row = 0; row < rowCount; row++)
+    {
+        const char* cell = IDE_ResultGridCell(column, row);
+        std::string_view cellText = cell != NULL ? cell : "";
+        if (cellText.empty())
+        {
+            nullCount++;
+            continue;
+        }
+
+        double number;
+        if (parseGridNumber(cellText, number))
+        {
+            numbers.push_back(number);
+            continue;
+        }
+
+        distinctCounter.add(hashBytes(cellText.data(), cellText.size()));
+        if (textCount == 0 || cellText < minText)
+            minText = cellText;
+        if (textCount == 0 || cellText > maxText)
+            maxText = cellText;
+        textCount++;
+    }
+
+    auto readTime = std::chrono::steady_clock::now();
+
+    // Numbers are counted by value, so 1 and 1.0 are the same
+    for (double number : numbers)
+    {
+        uint64_t bits;
+        double normalized = number + 0.0;
+        std::memcpy(&bits, &normalized, sizeof(bits));
+        distinctCounter.add(mixHash(bits));
+    }
+
+    std::wostringstream report;
+    report << L"Column " << column + 1 << L" of " << rowCount << L" rows\n\n";
+    report << L"Count:\t" << rowCount - nullCount << L"\n";
+    report << L"Nulls:\t" << nullCount << L"\n";
+    report << L"Distinct:\t~" << distinctCounter.estimate() << L"\n";
+    if (!numbers.empty())
+    {
+        NumberSummary summary = summarizeNumbers(numbers.data(), numbers.size());
+        report << L"Min:\t" << formatNumber(summary.min) << L"\n";
+        report << L"Max:\t" << formatNumber(summary.max) << L"\n";
+        report << L"Sum:\t" << formatNumber(summary.sum) << L"\n";
+        report << L"Average:\t" << formatNumber(summary.sum / numbers.size()) << L"\n";
+    }
+    if (textCount > 0)
+    {
+        if (!numbers.empty())
+            report << L"\nNon-numeric values:\t" << textCount << L"\n";
+        report << L"Min text:\t" << toEditorString(minText) << L"\n";
+        report << L"Max text:\t" << toEditorString(maxText) << L"\n";
+    }
+
+    auto endTime = std::chrono::steady_clock::now();
+    report << L"\nRead in " << std::chrono::duration_cast<std::chrono::milliseconds>(readTime - startTime).count() << L" ms, computed in "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(endTime - readTime).count() << L" ms";
+
+    showMessage(report.str());
+}
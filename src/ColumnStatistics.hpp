@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// HyperLogLog sketch estimating the number of distinct values from their hashes in fixed memory
+// (16 KB, about 1% standard error).
+class DistinctCounter
+{
+public:
+    DistinctCounter();
+
+    void add(uint64_t hash);
+    size_t estimate() const;
+
+private:
+    std::vector<uint8_t> registers;
+};
+
+struct NumberSummary
+{
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+};
+
+// Sum, minimum and maximum of a non-empty array, using SSE2 over two lanes at a time.
+NumberSummary summarizeNumbers(const double* values, size_t count);
+
+// Picks a column of the current result grid and shows its statistics.
+void showResultGridColumnStatistics();
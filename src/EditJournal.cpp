@@ -0,0 +1,233 @@
+#include "pch.h"
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "EditJournal.hpp"
+
+constexpr size_t EDIT_JOURNAL_MAX_BYTES = 4 << 20;
+
+struct LineMove
+{
+    // Where the block's first line was before the move
+    int firstLine;
+    int lineCount;
+    // Lines the block went down, negative if it went up
+    int offset;
+    std::vector<EditorString> indentsBefore;
+    std::vector<EditorString> indentsAfter;
+};
+
+struct EditJournal
+{
+    HWND editorWindow = NULL;
+    // Set by any change of the editor's text other than the journal's own
+    bool changed = false;
+    // Length of the text the last step left, in case a change went unnoticed
+    int textLength = 0;
+    std::deque<LineMove> undoSteps;
+    std::vector<LineMove> redoSteps;
+    size_t bytes = 0;
+};
+
+EditJournal editJournal;
+// While moveLines or a replay replaces the text
+bool journalEditing = false;
+
+size_t getStepBytes(const LineMove& move)
+{
+    size_t bytes = sizeof(LineMove);
+    for (auto& indent : move.indentsBefore)
+        bytes += sizeof(EditorString) + indent.size() * sizeof(EDITOR_CHAR);
+    for (auto& indent : move.indentsAfter)
+        bytes += sizeof(EditorString) + indent.size() * sizeof(EDITOR_CHAR);
+    return bytes;
+}
+
+void resetEditJournal(HWND editorWindow)
+{
+    editJournal = EditJournal();
+    editJournal.editorWindow = editorWindow;
+}
+
+bool isEditJournalCurrent(HWND editorWindow)
+{
+    return editJournal.editorWindow == editorWindow && !editJournal.changed
+        && GetWindowTextLength(editorWindow) == editJournal.textLength;
+}
+
+void clearRedoSteps()
+{
+    for (auto& move : editJournal.redoSteps)
+        editJournal.bytes -= getStepBytes(move);
+    editJournal.redoSteps.clear();
+}
+
+void replaceChangedLines(HWND editorWindow, int firstLine, const std::vector<EditorStringView>& oldLines,
+    const std::vector<EditorStringView>& newLines)
+{
+    size_t first = 0;
+    size_t last = std::min(oldLines.size(), newLines.size());
+    while (first < last && oldLines[first] == newLines[first])
+        first++;
+    while (last > first && oldLines[last - 1] == newLines[last - 1])
+        last--;
+    if (first == last)
+        return;
+
+    EditorString replacement;
+    for (size_t i = first; i < last; i++)
+    {
+        if (i > first)
+            replacement += EDT_TX("\r\n");
+        replacement += newLines[i];
+    }
+    int start = SendMessage(editorWindow, EM_LINEINDEX, firstLine + static_cast<int>(first), 0);
+    int lastLineStart = SendMessage(editorWindow, EM_LINEINDEX, firstLine + static_cast<int>(last) - 1, 0);
+    int end = lastLineStart + SendMessage(editorWindow, EM_LINELENGTH, lastLineStart, 0);
+    SendMessage(editorWindow, EM_SETSEL, start, end);
+    SendMessage(editorWindow, EM_REPLACESEL, TRUE, reinterpret_cast<LPARAM>(replacement.c_str()));
+}
+
+// Rewrites the lines the move spans from one arrangement to the other
+bool replayLineMove(HWND editorWindow, const EditorString& text, const LineMove& move, bool undo)
+{
+    int spanFirst = std::min(move.firstLine, move.firstLine + move.offset);
+    int spanLast = std::max(move.firstLine, move.firstLine + move.offset) + move.lineCount - 1;
+    int start = SendMessage(editorWindow, EM_LINEINDEX, spanFirst, 0);
+    int lastLineStart = SendMessage(editorWindow, EM_LINEINDEX, spanLast, 0);
+    if (start < 0 || lastLineStart < 0)
+        return false;
+    int end = std::min(lastLineStart + static_cast<int>(SendMessage(editorWindow, EM_LINELENGTH, lastLineStart, 0)), static_cast<int>(text.size()));
+    std::vector<EditorStringView> lines = splitLines(EditorStringView(text).substr(start, end - start));
+    if (static_cast<int>(lines.size()) != spanLast - spanFirst + 1)
+        return false;
+
+    int fromBlock = (undo ? move.firstLine + move.offset : move.firstLine) - spanFirst;
+    int toBlock = (undo ? move.firstLine : move.firstLine + move.offset) - spanFirst;
+    const std::vector<EditorString>& fromIndents = undo ? move.indentsAfter : move.indentsBefore;
+    const std::vector<EditorString>& toIndents = undo ? move.indentsBefore : move.indentsAfter;
+
+    // The lines the block passed keep their order
+    std::vector<EditorStringView> passedLines;
+    for (int i = 0; i < static_cast<int>(lines.size()); i++)
+    {
+        if (i < fromBlock || i >= fromBlock + move.lineCount)
+            passedLines.push_back(lines[i]);
+    }
+
+    std::vector<EditorString> blockLines;
+    for (int i = 0; i < move.lineCount; i++)
+        blockLines.push_back(toIndents[i] + EditorString(lines[fromBlock + i].substr(fromIndents[i].size())));
+    std::vector<EditorStringView> newLines;
+    size_t passedLine = 0;
+    for (int i = 0; i < static_cast<int>(lines.size()); i++)
+    {
+        if (i >= toBlock && i < toBlock + move.lineCount)
+            newLines.push_back(blockLines[i - toBlock]);
+        else
+            newLines.push_back(passedLines[passedLine++]);
+    }
+
+    int firstVisibleLine = SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0);
+    SendMessage(editorWindow, WM_SETREDRAW, FALSE, 0);
+    journalEditing = true;
+    replaceChangedLines(editorWindow, spanFirst, lines, newLines);
+    journalEditing = false;
+    int caret = SendMessage(editorWindow, EM_LINEINDEX, spanFirst + toBlock, 0);
+    SendMessage(editorWindow, EM_SETSEL, caret, caret);
+    SendMessage(editorWindow, EM_LINESCROLL, 0, firstVisibleLine - SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0));
+    SendMessage(editorWindow, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(editorWindow, NULL, TRUE);
+    SendMessage(editorWindow, EM_SCROLLCARET, 0, 0);
+    return true;
+}
+
+void replayJournal(bool undo)
+{
+    if (!IDE_WindowHasEditor(false) || IDE_GetReadOnly())
+        return;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    if (!isEditJournalCurrent(editorWindow))
+        resetEditJournal(editorWindow);
+    if (undo ? editJournal.undoSteps.empty() : editJournal.redoSteps.empty())
+    {
+        IDE_SetStatusMessage(undo ? "No line move to undo" : "No line move to redo");
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    LineMove move = std::move(undo ? editJournal.undoSteps.back() : editJournal.redoSteps.back());
+    if (undo)
+        editJournal.undoSteps.pop_back();
+    else
+        editJournal.redoSteps.pop_back();
+    if (!replayLineMove(editorWindow, getEditorText(editorWindow), move, undo))
+    {
+        resetEditJournal(editorWindow);
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    if (undo)
+        editJournal.redoSteps.push_back(std::move(move));
+    else
+        editJournal.undoSteps.push_back(std::move(move));
+    editJournal.textLength = GetWindowTextLength(editorWindow);
+    IDE_SetStatusMessage(undo ? "Line move undone" : "Line move redone");
+}
+
+void prepareEditJournal(HWND editorWindow)
+{
+    if (!isEditJournalCurrent(editorWindow))
+        resetEditJournal(editorWindow);
+    journalEditing = true;
+}
+
+void journalLineMove(HWND editorWindow, int firstLine, int lineCount, int offset,
+    std::vector<EditorString>&& indentsBefore, std::vector<EditorString>&& indentsAfter)
+{
+    journalEditing = false;
+    clearRedoSteps();
+    auto& steps = editJournal.undoSteps;
+    if (!steps.empty() && steps.back().firstLine + steps.back().offset == firstLine && steps.back().lineCount == lineCount)
+    {
+        // Moving the same block again extends the last step
+        LineMove& last = steps.back();
+        editJournal.bytes -= getStepBytes(last);
+        last.offset += offset;
+        last.indentsAfter = std::move(indentsAfter);
+        editJournal.bytes += getStepBytes(last);
+    }
+    else
+    {
+        steps.push_back({ firstLine, lineCount, offset, std::move(indentsBefore), std::move(indentsAfter) });
+        editJournal.bytes += getStepBytes(steps.back());
+    }
+
+    while (editJournal.bytes > EDIT_JOURNAL_MAX_BYTES && !steps.empty())
+    {
+        editJournal.bytes -= getStepBytes(steps.front());
+        steps.pop_front();
+    }
+    editJournal.textLength = GetWindowTextLength(editorWindow);
+}
+
+void noteEditJournalEdit(HWND editorWindow)
+{
+    if (!journalEditing && editorWindow == editJournal.editorWindow)
+        editJournal.changed = true;
+}
+
+void undoLineMove()
+{
+    replayJournal(true);
+}
+
+void redoLineMove()
+{
+    replayJournal(false);
+}
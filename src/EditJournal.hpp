@@ -0,0 +1,28 @@
+#pragma once
+
+#include "pch.h"
+#include <vector>
+#include "EditorUtils.hpp"
+
+// Undo and redo of runs of line moves. Each move is an undoable edit of the editor of its own,
+// which the journal groups: a move is kept as the block of lines, how far it went and the
+// indentation of its lines before and after, and moves of the same block in a row make a single
+// step. The journal follows one editor and is replayed only while its text is the one the last
+// step left; any other edit, the editor's own undo included, discards it. The oldest steps are
+// dropped past a memory budget.
+
+// Replaces the lines starting at firstLine, whose text is oldLines, with as many newLines, as one
+// undoable edit that leaves out the unchanged lines at either end
+void replaceChangedLines(HWND editorWindow, int firstLine, const std::vector<EditorStringView>& oldLines,
+    const std::vector<EditorStringView>& newLines);
+// Called before moveLines replaces the text, to discard the journal if the text changed since
+void prepareEditJournal(HWND editorWindow);
+// Called after moveLines replaced the text; its change notifications are ignored until then. The
+// block of lineCount lines starting at firstLine moved by offset lines; the indents are the
+// leading whitespace of its lines before and after.
+void journalLineMove(HWND editorWindow, int firstLine, int lineCount, int offset,
+    std::vector<EditorString>&& indentsBefore, std::vector<EditorString>&& indentsAfter);
+// Called for the EN_CHANGE notifications; any edit but the journal's own discards it
+void noteEditJournalEdit(HWND editorWindow);
+void undoLineMove();
+void redoLineMove();
@@ -0,0 +1,509 @@
+#include "pch.h"
+#include <algorithm>
+#include <cwctype>
+#include <future>
+#include <string>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "LogWindow.hpp"
+#include "TextSearch.hpp"
+#include "Ui.hpp"
+#include "WorkerPool.hpp"
+#include "EditorSearch.hpp"
+
+constexpr auto REGEX_QUERY_PREFIX = L"re:";
+constexpr auto ANY_TERM_QUERY_PREFIX = L"any:";
+constexpr COLORREF HIGHLIGHT_COLOR = RGB(255, 140, 0);
+constexpr size_t MAX_WINDOW_MATCHES = 10000;
+constexpr size_t WINDOW_MATCHES_LOG_MAX_BYTES = 4 * 1024 * 1024;
+constexpr size_t MAX_SHOWN_LINE_LENGTH = 200;
+const wchar_t* const REPLACEMENT_PROMPT = L"Replace with ($& and $1 to $9 insert what a regular expression matched):";
+const wchar_t* const QUERY_PROMPT = L"Text, re:regular expression or any:words separated by spaces. Case matters if it has uppercase letters.";
+
+struct EditorHighlights
+{
+    HWND editorWindow;
+    // Sorted by offset
+    std::vector<SearchMatch> matches;
+};
+
+struct WindowText
+{
+    HWND editorWindow;
+    std::wstring title;
+    EditorString text;
+};
+
+struct WindowMatch
+{
+    HWND editorWindow;
+    SearchMatch match;
+};
+
+std::wstring lastQuery;
+std::wstring lastReplacement;
+TextSearch lastSearch;
+bool lastSearchCompiled = false;
+std::vector<EditorHighlights> editorHighlights;
+// Matches of the last Find in open windows by result line
+std::vector<WindowMatch> windowMatches;
+
+bool compileQuery(const std::wstring& query, TextSearch& search)
+{
+    SearchMode mode = SearchMode::Literal;
+    std::wstring pattern = query;
+    if (query.compare(0, wcslen(REGEX_QUERY_PREFIX), REGEX_QUERY_PREFIX) == 0)
+    {
+        mode = SearchMode::Regex;
+        pattern = query.substr(wcslen(REGEX_QUERY_PREFIX));
+    }
+    else if (query.compare(0, wcslen(ANY_TERM_QUERY_PREFIX), ANY_TERM_QUERY_PREFIX) == 0)
+    {
+        mode = SearchMode::AnyTerm;
+        pattern = query.substr(wcslen(ANY_TERM_QUERY_PREFIX));
+    }
+
+    std::vector<EditorString> terms;
+    if (mode == SearchMode::AnyTerm)
+    {
+        size_t termStart = 0;
+        while (termStart < pattern.size())
+        {
+            size_t termEnd = pattern.find(L' ', termStart);
+            if (termEnd == std::wstring::npos)
+                termEnd = pattern.size();
+            if (termEnd > termStart)
+                terms.push_back(pattern.substr(termStart, termEnd - termStart));
+            termStart = termEnd + 1;
+        }
+    }
+    else
+    {
+        terms.push_back(pattern);
+    }
+
+    // Escapes like \W and \S don't make a regular expression case-sensitive
+    bool matchCase = false;
+    for (size_t i = 0; i < pattern.size(); i++)
+    {
+        if (mode == SearchMode::Regex && pattern[i] == L'\\')
+            i++;
+        else if (std::iswupper(pattern[i]))
+            matchCase = true;
+    }
+
+    std::wstring error;
+    if (!search.compile(mode, terms, matchCase, error))
+    {
+        showMessage(error, MB_OK | MB_ICONWARNING);
+        return false;
+    }
+    return true;
+}
+
+// Asks for the query, the previous one being the default
+bool promptQuery(const wchar_t* title)
+{
+    std::wstring query = lastQuery;
+    if (!showInputBox(title, QUERY_PROMPT, query) || query.empty())
+        return false;
+
+    lastQuery = query;
+    lastSearchCompiled = compileQuery(query, lastSearch);
+    return lastSearchCompiled;
+}
+
+void setStatusMessage(const std::wstring& message)
+{
+    IDE_SetStatusMessage(toAnsiString(message).c_str());
+}
+
+std::vector<EditorHighlights>::iterator findEditorHighlights(HWND editorWindow)
+{
+    return std::find_if(editorHighlights.begin(), editorHighlights.end(), [editorWindow](const EditorHighlights& highlights) {
+        return highlights.editorWindow == editorWindow;
+    });
+}
+
+// Frames the visible matches over what the editor painted
+void paintHighlights(HWND editorWindow, const std::vector<SearchMatch>& matches)
+{
+    if (matches.empty())
+        return;
+
+    RECT clientRect;
+    GetClientRect(editorWindow, &clientRect);
+    TEXTMETRIC textMetric = {};
+    HDC dc = GetDC(editorWindow);
+    HGDIOBJ previousFont = SelectObject(dc, reinterpret_cast<HGDIOBJ>(SendMessage(editorWindow, WM_GETFONT, 0, 0)));
+    GetTextMetrics(dc, &textMetric);
+    SelectObject(dc, previousFont);
+    int lineHeight = std::max(1, static_cast<int>(textMetric.tmHeight));
+
+    int firstLine = SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0);
+    size_t firstChar = SendMessage(editorWindow, EM_LINEINDEX, firstLine, 0);
+    int afterLastChar = SendMessage(editorWindow, EM_LINEINDEX, firstLine + clientRect.bottom / lineHeight + 1, 0);
+    size_t lastChar = afterLastChar < 0 ? SIZE_MAX : afterLastChar;
+
+    HBRUSH brush = CreateSolidBrush(HIGHLIGHT_COLOR);
+    auto match = std::lower_bound(matches.begin(), matches.end(), firstChar, [](const SearchMatch& match, size_t offset) {
+        return match.offset + match.length <= offset;
+    });
+    for (; match != matches.end() && match->offset < lastChar; ++match)
+    {
+        POINTL start = {};
+        POINTL end = {};
+        SendMessage(editorWindow, EM_POSFROMCHAR, reinterpret_cast<WPARAM>(&start), match->offset);
+        SendMessage(editorWindow, EM_POSFROMCHAR, reinterpret_cast<WPARAM>(&end), match->offset + match->length);
+        // Matches continuing on the next line are framed up to the edge of the window
+        RECT frame = { start.x, start.y, end.y == start.y ? end.x : clientRect.right, start.y + lineHeight };
+        FrameRect(dc, &frame, brush);
+    }
+    DeleteObject(brush);
+    ReleaseDC(editorWindow, dc);
+}
+
+// Subclassed with SetWindowSubclass, so that it can be removed in any order with other subclasses
+LRESULT CALLBACK highlightingEditorProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam, UINT_PTR subclassId, DWORD_PTR)
+{
+    if (message == WM_NCDESTROY)
+    {
+        RemoveWindowSubclass(window, highlightingEditorProc, subclassId);
+        auto highlights = findEditorHighlights(window);
+        if (highlights != editorHighlights.end())
+            editorHighlights.erase(highlights);
+        return DefSubclassProc(window, message, wParam, lParam);
+    }
+
+    LRESULT result = DefSubclassProc(window, message, wParam, lParam);
+    if (message == WM_PAINT)
+    {
+        auto highlights = findEditorHighlights(window);
+        if (highlights != editorHighlights.end())
+            paintHighlights(window, highlights->matches);
+    }
+    return result;
+}
+
+void setSearchHighlights(HWND editorWindow, std::vector<SearchMatch>&& matches)
+{
+    auto highlights = findEditorHighlights(editorWindow);
+    if (highlights == editorHighlights.end())
+    {
+        SetWindowSubclass(editorWindow, highlightingEditorProc, 0, 0);
+        editorHighlights.push_back({ editorWindow, {} });
+        highlights = editorHighlights.end() - 1;
+    }
+    highlights->matches = std::move(matches);
+    InvalidateRect(editorWindow, NULL, FALSE);
+}
+
+void clearSearchHighlights(HWND editorWindow)
+{
+    auto highlights = findEditorHighlights(editorWindow);
+    if (highlights == editorHighlights.end() || highlights->matches.empty())
+        return;
+
+    highlights->matches.clear();
+    InvalidateRect(editorWindow, NULL, FALSE);
+}
+
+void removeSearchHighlights()
+{
+    for (auto& highlights : editorHighlights)
+    {
+        RemoveWindowSubclass(highlights.editorWindow, highlightingEditorProc, 0);
+        InvalidateRect(highlights.editorWindow, NULL, FALSE);
+    }
+    editorHighlights.clear();
+}
+
+const TextSearch* promptSearchQuery(const wchar_t* title)
+{
+    return promptQuery(title) ? &lastSearch : nullptr;
+}
+
+void findInEditor()
+{
+    if (!IDE_WindowHasEditor(false))
+        return;
+
+    if (promptQuery(L"Find"))
+        findNextInEditor();
+}
+
+void findNextInEditor()
+{
+    if (!IDE_WindowHasEditor(false))
+        return;
+
+    if (!lastSearchCompiled)
+    {
+        findInEditor();
+        return;
+    }
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    EditorString text = getEditorText(editorWindow);
+
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+
+    SearchMatch match;
+    if (lastSearch.findNext(text, selectionEnd, match))
+    {
+        setStatusMessage(L"");
+    }
+    else if (lastSearch.findNext(text, 0, match))
+    {
+        setStatusMessage(L"Search continued from the top");
+    }
+    else
+    {
+        setStatusMessage(L"Not found: " + lastQuery);
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    SendMessage(editorWindow, EM_SETSEL, match.offset, match.offset + match.length);
+    SendMessage(editorWindow, EM_SCROLLCARET, 0, 0);
+}
+
+void highlightAllInEditor()
+{
+    if (!IDE_WindowHasEditor(false) || !promptQuery(L"Highlight all matches"))
+        return;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    std::vector<SearchMatch> matches;
+    lastSearch.findAll(getEditorText(editorWindow), matches);
+    setStatusMessage(std::to_wstring(matches.size()) + L" matches highlighted, Esc clears them");
+    setSearchHighlights(editorWindow, std::move(matches));
+}
+
+void countMatchesInEditor()
+{
+    if (!IDE_WindowHasEditor(false) || !promptQuery(L"Count matches"))
+        return;
+
+    size_t count = lastSearch.countMatches(getEditorText(IDE_GetEditorHandle()));
+    showMessage(std::to_wstring(count) + (count == 1 ? L" match of " : L" matches of ") + lastQuery);
+}
+
+// Where an offset before the replacement is after it. Offsets within a match move to the start
+// of its replacement.
+size_t mapReplacedOffset(size_t offset, const std::vector<SearchMatch>& matches, const std::vector<size_t>& replacementLengths)
+{
+    ptrdiff_t shift = 0;
+    for (size_t i = 0; i < matches.size() && matches[i].offset < offset; i++)
+    {
+        if (offset < matches[i].offset + matches[i].length)
+            return matches[i].offset + shift;
+        shift += static_cast<ptrdiff_t>(replacementLengths[i]) - static_cast<ptrdiff_t>(matches[i].length);
+    }
+    return offset + shift;
+}
+
+void replaceAllInEditor()
+{
+    if (!IDE_WindowHasEditor(false) || IDE_GetReadOnly() || !promptQuery(L"Replace all"))
+        return;
+
+    std::wstring replacement = lastReplacement;
+    if (!showInputBox(L"Replace all", REPLACEMENT_PROMPT, replacement))
+        return;
+    lastReplacement = replacement;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    EditorString text = getEditorText(editorWindow);
+    std::vector<SearchMatch> matches;
+    lastSearch.findAll(text, matches);
+    if (matches.empty())
+    {
+        setStatusMessage(L"Not found: " + lastQuery);
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    // Only the text from the first to the last match is replaced, built in a buffer of its
+    // final size
+    std::vector<EditorString> formatted;
+    std::vector<size_t> replacementLengths;
+    formatted.reserve(matches.size());
+    replacementLengths.reserve(matches.size());
+    size_t replacedStart = matches.front().offset;
+    size_t replacedEnd = matches.back().offset + matches.back().length;
+    size_t resultLength = replacedEnd - replacedStart;
+    for (auto& match : matches)
+    {
+        formatted.push_back(lastSearch.formatReplacement(text, match, replacement));
+        replacementLengths.push_back(formatted.back().size());
+        resultLength = resultLength - match.length + formatted.back().size();
+    }
+
+    EditorString result;
+    result.reserve(resultLength);
+    size_t copiedUpTo = replacedStart;
+    for (size_t i = 0; i < matches.size(); i++)
+    {
+        result.append(text, copiedUpTo, matches[i].offset - copiedUpTo);
+        result.append(formatted[i]);
+        copiedUpTo = matches[i].offset + matches[i].length;
+    }
+
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+    int firstVisibleLine = SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0);
+    size_t firstVisibleChar = SendMessage(editorWindow, EM_LINEINDEX, firstVisibleLine, 0);
+
+    SendMessage(editorWindow, WM_SETREDRAW, FALSE, 0);
+    SendMessage(editorWindow, EM_SETSEL, replacedStart, replacedEnd);
+    SendMessage(editorWindow, EM_REPLACESEL, TRUE, reinterpret_cast<LPARAM>(result.c_str()));
+
+    // Put the caret and the view back where they were relative to the surrounding text
+    SendMessage(editorWindow, EM_SETSEL, mapReplacedOffset(selectionStart, matches, replacementLengths),
+        mapReplacedOffset(selectionEnd, matches, replacementLengths));
+    int wantedFirstLine = SendMessage(editorWindow, EM_LINEFROMCHAR, mapReplacedOffset(firstVisibleChar, matches, replacementLengths), 0);
+    SendMessage(editorWindow, EM_LINESCROLL, 0, wantedFirstLine - SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0));
+    SendMessage(editorWindow, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(editorWindow, NULL, TRUE);
+
+    setStatusMessage(std::to_wstring(matches.size()) + (matches.size() == 1 ? L" match replaced" : L" matches replaced"));
+}
+
+// Caption of the MDI child window the editor is in
+std::wstring getEditorWindowTitle(HWND editorWindow)
+{
+    HWND clientWindow = IDE_GetClientHandle();
+    HWND window = editorWindow;
+    while (GetParent(window) != NULL && GetParent(window) != clientWindow)
+        window = GetParent(window);
+
+    int length = GetWindowTextLength(window);
+    std::wstring title(length + 1, L'\0');
+    title.resize(GetWindowText(window, title.data(), length + 1));
+    return title;
+}
+
+void findListedMatches(const TextSearch& search, EditorStringView text, size_t maxMatches, std::vector<ListedMatch>& matches)
+{
+    SearchMatch match;
+    size_t from = 0;
+    size_t line = 0;
+    size_t lineStart = 0;
+    size_t counted = 0;
+    while (matches.size() < maxMatches && search.findNext(text, from, match))
+    {
+        // Lines are counted on from the previous match
+        for (; counted < match.offset; counted++)
+        {
+            if (text[counted] == EDT_TX('\n'))
+            {
+                line++;
+                lineStart = counted + 1;
+            }
+        }
+
+        size_t lineEnd = text.find(EDT_TX('\n'), match.offset);
+        if (lineEnd == EditorStringView::npos)
+            lineEnd = text.size();
+        size_t shownStart = lineStart;
+        while (shownStart < match.offset && std::iswspace(text[shownStart]))
+            shownStart++;
+        EditorStringView shown = text.substr(shownStart, std::min(lineEnd - shownStart, MAX_SHOWN_LINE_LENGTH));
+        if (!shown.empty() && shown.back() == EDT_TX('\r'))
+            shown.remove_suffix(1);
+
+        matches.push_back({ match, line, match.offset - lineStart, toAnsiString(shown) });
+        from = match.offset + match.length;
+    }
+}
+
+void goToWindowMatch(size_t line)
+{
+    if (line >= windowMatches.size())
+        return;
+
+    const WindowMatch& found = windowMatches[line];
+    bool activated = false;
+    int windowCount = IDE_GetWindowCount();
+    for (int i = 0; i < windowCount && !activated; i++)
+    {
+        if (IDE_SelectWindow(i) && IDE_WindowHasEditor(false) && IDE_GetEditorHandle() == found.editorWindow)
+            activated = IDE_ActivateWindow(i);
+    }
+    IDE_SelectWindow(0);
+
+    // The window may have been closed since
+    if (!activated)
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+    SendMessage(found.editorWindow, EM_SETSEL, found.match.offset, found.match.offset + found.match.length);
+    SendMessage(found.editorWindow, EM_SCROLLCARET, 0, 0);
+}
+
+void findInOpenWindows()
+{
+    if (!promptQuery(L"Find in open windows"))
+        return;
+
+    // The IDE can only be called on its thread, so every text is taken once before searching
+    std::vector<WindowText> windows;
+    int windowCount = IDE_GetWindowCount();
+    for (int i = 0; i < windowCount; i++)
+    {
+        if (!IDE_SelectWindow(i) || !IDE_WindowHasEditor(false))
+            continue;
+        HWND editorWindow = IDE_GetEditorHandle();
+        windows.push_back({ editorWindow, getEditorWindowTitle(editorWindow), getEditorText(editorWindow) });
+    }
+    IDE_SelectWindow(0);
+
+    std::vector<std::future<std::vector<ListedMatch>>> searches;
+    searches.reserve(windows.size());
+    for (auto& window : windows)
+    {
+        searches.push_back(getWorkerPool().submit([&window] {
+            std::vector<ListedMatch> matches;
+            findListedMatches(lastSearch, window.text, MAX_WINDOW_MATCHES, matches);
+            return matches;
+        }));
+    }
+
+    // Results are listed in window order, up to the limit
+    windowMatches.clear();
+    std::string report;
+    size_t matchedWindowCount = 0;
+    for (size_t i = 0; i < searches.size(); i++)
+    {
+        std::vector<ListedMatch> matches = searches[i].get();
+        if (!matches.empty())
+            matchedWindowCount++;
+        std::string title = toAnsiString(windows[i].title);
+        for (size_t j = 0; j < matches.size() && windowMatches.size() < MAX_WINDOW_MATCHES; j++)
+        {
+            windowMatches.push_back({ windows[i].editorWindow, matches[j].match });
+            report += title + "(" + std::to_string(matches[j].line + 1) + "): " + matches[j].lineText + "\n";
+        }
+    }
+
+    if (windowMatches.empty())
+    {
+        setStatusMessage(L"Not found in " + std::to_wstring(windows.size()) + L" windows: " + lastQuery);
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    static LogWindow resultsWindow(L"Find in open windows", MAX_WINDOW_MATCHES, WINDOW_MATCHES_LOG_MAX_BYTES);
+    resultsWindow.setLineActivated(goToWindowMatch);
+    resultsWindow.show();
+    resultsWindow.append(report);
+    std::wstring status = std::to_wstring(windowMatches.size()) + L" matches of " + lastQuery + L" in " + std::to_wstring(matchedWindowCount)
+        + L" of " + std::to_wstring(windows.size()) + L" windows";
+    if (windowMatches.size() == MAX_WINDOW_MATCHES)
+        status += L", only the first " + std::to_wstring(MAX_WINDOW_MATCHES) + L" are listed";
+    resultsWindow.setStatus(status);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "pch.h"
+#include <string>
+#include <vector>
+#include "TextSearch.hpp"
+
+// A match as listed in search results
+struct ListedMatch
+{
+    SearchMatch match;
+    size_t line;
+    // In characters from the start of the line
+    size_t column;
+    // The line without leading whitespace, shortened if long
+    std::string lineText;
+};
+
+// Asks for a query with the syntax of Find, the last one being the default. Returns the compiled
+// search, or null if cancelled or invalid.
+const TextSearch* promptSearchQuery(const wchar_t* title);
+
+// Finds up to maxMatches matches with their lines. Doesn't call the IDE, so it can run on
+// worker threads.
+void findListedMatches(const TextSearch& search, EditorStringView text, size_t maxMatches, std::vector<ListedMatch>& matches);
+
+void findInEditor();
+// Repeats the last search from the end of the selection, continuing from the top if needed
+void findNextInEditor();
+void highlightAllInEditor();
+void countMatchesInEditor();
+// Replaces all matches with one edit, so it's one undo step
+void replaceAllInEditor();
+// Searches the texts of all windows with an editor in parallel and lists the matches, which
+// double-clicking goes to
+void findInOpenWindows();
+
+// Highlights become invalid when the text changes
+void clearSearchHighlights(HWND editorWindow);
+// Restores the editors' window procedures, which must happen before the plug-in is unloaded
+void removeSearchHighlights();
@@ -0,0 +1,136 @@
+#include "pch.h"
+#include <algorithm>
+#include <cctype>
+#include "EditorUtils.hpp"
+
+bool isWordCharacter(EDITOR_CHAR c)
+{
+    return std::isalnum(c) || c == EDT_TX('_') || c == EDT_TX('$') || c == EDT_TX('#');
+}
+
+int findWordStart(const EDITOR_CHAR* line, int lineIndex)
+{
+    while (lineIndex > 0)
+    {
+        if (!isWordCharacter(line[lineIndex - 1]))
+            break;
+        lineIndex--;
+    }
+    return lineIndex;
+}
+
+int findWordEnd(const EDITOR_CHAR* line, int lineLength, int lineIndex)
+{
+    while (lineIndex < lineLength)
+    {
+        if (!isWordCharacter(line[lineIndex]))
+            break;
+        lineIndex++;
+    }
+    return lineIndex;
+}
+
+EditorString toEditorString(std::string_view text)
+{
+    if (text.empty())
+        return EditorString();
+
+    int length = MultiByteToWideChar(CP_ACP, 0, text.data(), static_cast<int>(text.size()), NULL, 0);
+    EditorString result(length, EDT_TX('\0'));
+    MultiByteToWideChar(CP_ACP, 0, text.data(), static_cast<int>(text.size()), result.data(), length);
+    return result;
+}
+
+std::string toAnsiString(EditorStringView text)
+{
+    if (text.empty())
+        return std::string();
+
+    int length = WideCharToMultiByte(CP_ACP, 0, text.data(), static_cast<int>(text.size()), NULL, 0, NULL, NULL);
+    std::string result(length, '\0');
+    WideCharToMultiByte(CP_ACP, 0, text.data(), static_cast<int>(text.size()), result.data(), length, NULL, NULL);
+    return result;
+}
+
+EditorString getEditorText(HWND editorWindow)
+{
+    int length = GetWindowTextLength(editorWindow);
+    EditorString text(length, EDT_TX('\0'));
+    text.resize(GetWindowText(editorWindow, text.data(), length + 1));
+    return text;
+}
+
+std::vector<EditorStringView> splitLines(EditorStringView text)
+{
+    std::vector<EditorStringView> lines;
+    size_t lineStart = 0;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] != EDT_TX('\r') && text[i] != EDT_TX('\n'))
+            continue;
+        lines.push_back(text.substr(lineStart, i - lineStart));
+        if (text[i] == EDT_TX('\r') && i + 1 < text.size() && text[i + 1] == EDT_TX('\n'))
+            i++;
+        lineStart = i + 1;
+    }
+    lines.push_back(text.substr(lineStart));
+    return lines;
+}
+
+EditorString getClipboardText(HWND ownerWindow)
+{
+    EditorString text;
+    if (!IsClipboardFormatAvailable(CF_UNICODETEXT) || !OpenClipboard(ownerWindow))
+        return text;
+
+    HANDLE data = GetClipboardData(CF_UNICODETEXT);
+    auto chars = data != NULL ? static_cast<const EDITOR_CHAR*>(GlobalLock(data)) : nullptr;
+    if (chars != nullptr)
+    {
+        text = chars;
+        GlobalUnlock(data);
+    }
+    CloseClipboard();
+    return text;
+}
+
+bool setClipboardText(HWND ownerWindow, EditorStringView text)
+{
+    HGLOBAL data = GlobalAlloc(GMEM_MOVEABLE, (text.size() + 1) * sizeof(EDITOR_CHAR));
+    if (data == NULL)
+        return false;
+    auto chars = static_cast<EDITOR_CHAR*>(GlobalLock(data));
+    std::copy(text.begin(), text.end(), chars);
+    chars[text.size()] = EDT_TX('\0');
+    GlobalUnlock(data);
+
+    if (!OpenClipboard(ownerWindow))
+    {
+        GlobalFree(data);
+        return false;
+    }
+    EmptyClipboard();
+    // The clipboard owns the memory once it's set
+    bool set = SetClipboardData(CF_UNICODETEXT, data) != NULL;
+    CloseClipboard();
+    if (!set)
+        GlobalFree(data);
+    return set;
+}
+
+POINT getCharScreenPosition(HWND editorWindow, int charIndex)
+{
+    POINTL charPosition = {};
+    SendMessage(editorWindow, EM_POSFROMCHAR, reinterpret_cast<WPARAM>(&charPosition), charIndex);
+
+    TEXTMETRIC textMetric = {};
+    HDC dc = GetDC(editorWindow);
+    HGDIOBJ previousFont = SelectObject(dc, reinterpret_cast<HGDIOBJ>(SendMessage(editorWindow, WM_GETFONT, 0, 0)));
+    GetTextMetrics(dc, &textMetric);
+    SelectObject(dc, previousFont);
+    ReleaseDC(editorWindow, dc);
+
+    POINT position = { charPosition.x, charPosition.y + textMetric.tmHeight };
+    ClientToScreen(editorWindow, &position);
+    return position;
+}
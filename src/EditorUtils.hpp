@@ -0,0 +1,40 @@
+#pragma once
+
+#include "pch.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+typedef WCHAR EDITOR_CHAR;
+#define EDT_TX(quote) L##quote
+
+typedef std::basic_string<EDITOR_CHAR> EditorString;
+typedef std::basic_string_view<EDITOR_CHAR> EditorStringView;
+
+// Columns a tab takes when indentation is measured
+constexpr int EDITOR_TAB_WIDTH = 3;
+
+bool isWordCharacter(EDITOR_CHAR c);
+
+// Returns the index of the first character of the word that ends at (or contains) lineIndex.
+int findWordStart(const EDITOR_CHAR* line, int lineIndex);
+
+// Returns the index just past the last character of the word that starts at (or contains) lineIndex.
+int findWordEnd(const EDITOR_CHAR* line, int lineLength, int lineIndex);
+
+// Converts text returned by the IDE callbacks (ANSI code page) to editor characters and back.
+EditorString toEditorString(std::string_view text);
+std::string toAnsiString(EditorStringView text);
+
+// Whole text of the editor, whose offsets are the character indexes of the EM_ messages.
+EditorString getEditorText(HWND editorWindow);
+
+// Splits at CR LF, CR or LF. The lines point into text.
+std::vector<EditorStringView> splitLines(EditorStringView text);
+
+// Plain text on the clipboard, empty if there is none.
+EditorString getClipboardText(HWND ownerWindow);
+bool setClipboardText(HWND ownerWindow, EditorStringView text);
+
+// Screen position just below the given character, suitable for placing popups at the caret.
+POINT getCharScreenPosition(HWND editorWindow, int charIndex);
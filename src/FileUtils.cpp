@@ -0,0 +1,222 @@
+#include "pch.h"
+#include <algorithm>
+#include <cstdint>
+#include "FileUtils.hpp"
+
+bool readFile(const std::wstring& fileName, std::string& contents)
+{
+    HANDLE file = CreateFile(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    bool success = GetFileSizeEx(file, &fileSize) != FALSE;
+    if (success)
+    {
+        contents.resize(static_cast<size_t>(fileSize.QuadPart));
+
+        size_t totalRead = 0;
+        while (success && totalRead < contents.size())
+        {
+            DWORD toRead = static_cast<DWORD>(std::min<size_t>(contents.size() - totalRead, 64 * 1024 * 1024));
+            DWORD read = 0;
+            success = ReadFile(file, contents.data() + totalRead, toRead, &read, NULL) && read > 0;
+            totalRead += read;
+        }
+    }
+
+    CloseHandle(file);
+    return success;
+}
+
+bool writeFile(const std::wstring& fileName, std::string_view contents)
+{
+    std::wstring temporaryFileName = fileName + L".tmp";
+    OutputFile file;
+    bool success = file.open(temporaryFileName) && file.write(contents);
+    success = file.close() && success;
+
+    if (success)
+        success = MoveFileEx(temporaryFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+    if (!success)
+        DeleteFile(temporaryFileName.c_str());
+
+    return success;
+}
+
+uint64_t getFileSize(const std::wstring& fileName)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesEx(fileName.c_str(), GetFileExInfoStandard, &attributes))
+        return 0;
+    return static_cast<uint64_t>(attributes.nFileSizeHigh) << 32 | attributes.nFileSizeLow;
+}
+
+std::wstring getPluginDataDirectory()
+{
+    wchar_t appData[MAX_PATH];
+    DWORD length = GetEnvironmentVariable(L"APPDATA", appData, MAX_PATH);
+    std::wstring directory = length > 0 && length < MAX_PATH ? std::wstring(appData, length) : L".";
+    directory += L"\\PsdEditorEnhancements";
+    CreateDirectory(directory.c_str(), NULL);
+    return directory + L"\\";
+}
+
+OutputFile::~OutputFile()
+{
+    close();
+}
+
+bool OutputFile::open(const std::wstring& fileName)
+{
+    close();
+    file = CreateFile(fileName.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    return file != INVALID_HANDLE_VALUE;
+}
+
+bool OutputFile::openAt(const std::wstring& fileName, uint64_t offset)
+{
+    close();
+    file = CreateFile(fileName.c_str(), GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(offset);
+    if (!SetFilePointerEx(file, position, NULL, FILE_BEGIN) || !SetEndOfFile(file))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool OutputFile::write(std::string_view data)
+{
+    while (!data.empty())
+    {
+        DWORD toWrite = static_cast<DWORD>(std::min<size_t>(data.size(), 64 * 1024 * 1024));
+        DWORD written = 0;
+        if (!WriteFile(file, data.data(), toWrite, &written, NULL) || written == 0)
+            return false;
+        data.remove_prefix(written);
+    }
+
+    return true;
+}
+
+bool OutputFile::close()
+{
+    if (file == INVALID_HANDLE_VALUE)
+        return true;
+
+    bool success = CloseHandle(file) != FALSE;
+    file = INVALID_HANDLE_VALUE;
+    return success;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::wstring& fileName)
+{
+    close();
+    file = CreateFile(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 && static_cast<uint64_t>(fileSize.QuadPart) <= SIZE_MAX)
+    {
+        mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL)
+            view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (view == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    size = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (view != nullptr)
+        UnmapViewOfFile(view);
+    if (mapping != NULL)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    view = nullptr;
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+    size = 0;
+}
+
+SlidingFileView::~SlidingFileView()
+{
+    close();
+}
+
+bool SlidingFileView::open(const std::wstring& fileName)
+{
+    close();
+    file = CreateFile(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+        mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        close();
+        return false;
+    }
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    granularity = systemInfo.dwAllocationGranularity;
+    size = static_cast<uint64_t>(fileSize.QuadPart);
+    return true;
+}
+
+void SlidingFileView::unmap()
+{
+    if (view != nullptr)
+        UnmapViewOfFile(view);
+    view = nullptr;
+}
+
+void SlidingFileView::close()
+{
+    unmap();
+    if (mapping != NULL)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+    size = 0;
+}
+
+std::string_view SlidingFileView::map(uint64_t offset, size_t length)
+{
+    unmap();
+    if (mapping == NULL || offset >= size || length == 0)
+        return std::string_view();
+
+    length = static_cast<size_t>(std::min<uint64_t>(length, size - offset));
+    uint64_t viewOffset = offset - offset % granularity;
+    size_t viewLength = static_cast<size_t>(offset - viewOffset) + length;
+    view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(viewOffset >> 32),
+        static_cast<DWORD>(viewOffset), viewLength));
+    if (view == nullptr)
+        return std::string_view();
+    return std::string_view(view + (offset - viewOffset), length);
+}
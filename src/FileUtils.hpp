@@ -0,0 +1,99 @@
+#pragma once
+
+#include "pch.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Reads a whole file into memory. Returns false if it can't be opened or read.
+bool readFile(const std::wstring& fileName, std::string& contents);
+
+// Replaces the file's contents. The data goes to a temporary file first, so the old contents
+// survive a failed write.
+bool writeFile(const std::wstring& fileName, std::string_view contents);
+
+// 0 if the file doesn't exist
+uint64_t getFileSize(const std::wstring& fileName);
+
+// %APPDATA%\PsdEditorEnhancements, created if missing. Ends with a backslash.
+std::wstring getPluginDataDirectory();
+
+// Sequential writer for large outputs. Callers are expected to write in big chunks, so there's
+// no buffering on top of the system cache.
+class OutputFile
+{
+public:
+    OutputFile() = default;
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    // Creates or truncates the file
+    bool open(const std::wstring& fileName);
+    // Opens or creates the file to write from offset on, cutting off whatever follows it. Used by
+    // append-only files to drop a record a crash left half-written.
+    bool openAt(const std::wstring& fileName, uint64_t offset);
+    bool write(std::string_view data);
+    bool close();
+    bool isOpen() const { return file != INVALID_HANDLE_VALUE; }
+
+private:
+    HANDLE file = INVALID_HANDLE_VALUE;
+};
+
+// Read-only view of a whole file. Pages are read when first touched, so opening even a huge file
+// costs next to nothing.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Fails for empty files, which can't be mapped
+    bool open(const std::wstring& fileName);
+    void close();
+    bool isOpen() const { return view != nullptr; }
+    std::string_view data() const { return std::string_view(view, size); }
+
+private:
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+    const char* view = nullptr;
+    size_t size = 0;
+};
+
+// Read-only file mapped one range at a time, for files that may not fit the address space of a
+// 32-bit process in a single view
+class SlidingFileView
+{
+public:
+    SlidingFileView() = default;
+    ~SlidingFileView();
+
+    SlidingFileView(const SlidingFileView&) = delete;
+    SlidingFileView& operator=(const SlidingFileView&) = delete;
+
+    // Fails for empty files, which can't be mapped
+    bool open(const std::wstring& fileName);
+    void close();
+    bool isOpen() const { return mapping != NULL; }
+    uint64_t fileSize() const { return size; }
+    // Maps the range, cut at the end of the file, in place of the previous one. Empty if it
+    // couldn't be mapped or starts past the end.
+    std::string_view map(uint64_t offset, size_t length);
+    // Releases the range until the next map
+    void unmap();
+
+private:
+
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+    const char* view = nullptr;
+    uint64_t size = 0;
+    // Views start at multiples of it
+    uint64_t granularity = 0;
+};
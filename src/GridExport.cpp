@@ -0,0 +1,465 @@
+#include "pch.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "BinaryIo.hpp"
+#include "FileUtils.hpp"
+#include "Plugin.hpp"
+#include "Ui.hpp"
+#include "WorkerPool.hpp"
+#include "GridExport.hpp"
+
+constexpr auto EXPORT_FORMAT_PREFERENCE = "ExportFormat";
+constexpr auto EXPORT_FILE_FILTER = L"CSV (*.csv)\0*.csv\0JSON lines (*.jsonl)\0*.jsonl\0Columnar (*.pcol)\0*.pcol\0";
+// A batch is handed to the pool when either limit is reached
+constexpr size_t EXPORT_BATCH_ROWS = 50000;
+constexpr size_t EXPORT_BATCH_BYTES = 8 * 1024 * 1024;
+constexpr char COLUMNAR_MAGIC[8] = { 'P', 'S', 'D', 'E', 'C', 'O', 'L', '1' };
+constexpr auto UTF8_BOM = "\xEF\xBB\xBF";
+
+enum class ExportFormat
+{
+    Csv,
+    JsonLines,
+    Columnar,
+};
+
+struct ColumnBatch
+{
+    // Per column: the cell texts back to back and the end offset of each cell
+    std::vector<std::string> data;
+    std::vector<std::vector<uint32_t>> ends;
+    size_t rowCount = 0;
+    size_t byteCount = 0;
+
+    explicit ColumnBatch(size_t columnCount)
+        : data(columnCount), ends(columnCount)
+    {
+    }
+
+    std::string_view cell(size_t column, size_t row) const
+    {
+        uint32_t start = row > 0 ? ends[column][row - 1] : 0;
+        return std::string_view(data[column]).substr(start, ends[column][row] - start);
+    }
+};
+
+// What the formatters need besides the batch, shared read-only by all of them
+struct ExportLayout
+{
+    ExportFormat format;
+    // "NAME": prefixes of the JSON objects' members
+    std::vector<std::string> jsonKeys;
+};
+
+struct GridExport
+{
+    ExportFormat format;
+    OutputFile file;
+    std::wstring fileName;
+    std::vector<std::string> columnNames;
+    std::shared_ptr<const ExportLayout> layout;
+    std::unique_ptr<ColumnBatch> batch;
+    size_t currentColumn = 0;
+    // Formatted chunks in file order, some still being formatted
+    std::deque<std::future<std::string>> pendingChunks;
+    bool dataStarted = false;
+    bool failed = false;
+};
+
+std::unique_ptr<GridExport> gridExport;
+
+bool isAscii(std::string_view text)
+{
+    for (char c : text)
+    {
+        if (static_cast<unsigned char>(c) >= 0x80)
+            return false;
+    }
+    return true;
+}
+
+void appendUtf8(std::string& output, std::string_view ansiText)
+{
+    if (isAscii(ansiText))
+    {
+        output.append(ansiText);
+        return;
+    }
+
+    int wideLength = MultiByteToWideChar(CP_ACP, 0, ansiText.data(), static_cast<int>(ansiText.size()), NULL, 0);
+    std::wstring wideText(wideLength, L'\0');
+    MultiByteToWideChar(CP_ACP, 0, ansiText.data(), static_cast<int>(ansiText.size()), wideText.data(), wideLength);
+
+    int utf8Length = WideCharToMultiByte(CP_UTF8, 0, wideText.data(), wideLength, NULL, 0, NULL, NULL);
+    size_t outputLength = output.size();
+    output.resize(outputLength + utf8Length);
+    WideCharToMultiByte(CP_UTF8, 0, wideText.data(), wideLength, output.data() + outputLength, utf8Length, NULL, NULL);
+}
+
+std::string toUtf8(std::string_view ansiText)
+{
+    std::string utf8Text;
+    appendUtf8(utf8Text, ansiText);
+    return utf8Text;
+}
+
+// The IDE hands over ANSI text, all formats are UTF-8. Columns without non-ASCII characters,
+// which is most of them, are left as they are.
+void convertColumnsToUtf8(ColumnBatch& batch)
+{
+    if (GetACP() == CP_UTF8)
+        return;
+
+    for (size_t column = 0; column < batch.data.size(); column++)
+    {
+        if (isAscii(batch.data[column]))
+            continue;
+
+        std::string_view data = batch.data[column];
+        auto& ends = batch.ends[column];
+        std::string converted;
+        converted.reserve(data.size() + data.size() / 4);
+        uint32_t start = 0;
+        for (size_t row = 0; row < batch.rowCount; row++)
+        {
+            appendUtf8(converted, data.substr(start, ends[row] - start));
+            start = ends[row];
+            ends[row] = static_cast<uint32_t>(converted.size());
+        }
+        batch.data[column] = std::move(converted);
+    }
+}
+
+void appendCsvValue(std::string& output, std::string_view value)
+{
+    bool needsQuotes = value.find_first_of(",\"\r\n") != std::string_view::npos;
+    if (!needsQuotes)
+    {
+        output.append(value);
+        return;
+    }
+
+    output += '"';
+    size_t quote;
+    while ((quote = value.find('"')) != std::string_view::npos)
+    {
+        output.append(value.substr(0, quote + 1));
+        output += '"';
+        value.remove_prefix(quote + 1);
+    }
+    output.append(value);
+    output += '"';
+}
+
+void appendJsonString(std::string& output, std::string_view value)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    output += '"';
+    size_t runStart = 0;
+    for (size_t i = 0; i < value.size(); i++)
+    {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        // Characters that need no escaping are copied in runs
+        output.append(value.substr(runStart, i - runStart));
+        runStart = i + 1;
+        switch (c)
+        {
+        case '"':
+            output += "\\\"";
+            break;
+        case '\\':
+            output += "\\\\";
+            break;
+        case '\n':
+            output += "\\n";
+            break;
+        case '\r':
+            output += "\\r";
+            break;
+        case '\t':
+            output += "\\t";
+            break;
+        default:
+            output += "\\u00";
+            output += HEX_DIGITS[c >> 4];
+            output += HEX_DIGITS[c & 0xF];
+            break;
+        }
+    }
+    output.append(value.substr(runStart));
+    output += '"';
+}
+
+std::string formatCsvBatch(const ColumnBatch& batch)
+{
+    std::string output;
+    output.reserve(batch.byteCount + batch.byteCount / 8 + batch.rowCount * (batch.data.size() + 1));
+    for (size_t row = 0; row < batch.rowCount; row++)
+    {
+        for (size_t column = 0; column < batch.data.size(); column++)
+        {
+            if (column > 0)
+                output += ',';
+            appendCsvValue(output, batch.cell(column, row));
+        }
+        output += "\r\n";
+    }
+    return output;
+}
+
+std::string formatJsonLinesBatch(const ColumnBatch& batch, const ExportLayout& layout)
+{
+    size_t keysLength = 0;
+    for (auto& key : layout.jsonKeys)
+        keysLength += key.size() + 3;
+
+    std::string output;
+    output.reserve(batch.byteCount + batch.byteCount / 8 + batch.rowCount * (keysLength + 3));
+    for (size_t row = 0; row < batch.rowCount; row++)
+    {
+        output += '{';
+        for (size_t column = 0; column < batch.data.size(); column++)
+        {
+            if (column > 0)
+                output += ',';
+            output += layout.jsonKeys[column];
+
+            // Oracle doesn't tell empty strings from NULLs, so neither does the export
+            auto value = batch.cell(column, row);
+            if (value.empty())
+                output += "null";
+            else
+                appendJsonString(output, value);
+        }
+        output += "}\n";
+    }
+    return output;
+}
+
+// Columnar file layout, all integers little-endian uint32:
+//   header: "PSDECOL1", column count, then per column its name length and UTF-8 name
+//   blocks: row count, then per column the data length, the end offset of each value in the
+//           data and the data itself (UTF-8 values back to back; empty values are NULLs)
+//   end:    a block with row count 0
+std::string formatColumnarBatch(const ColumnBatch& batch)
+{
+    size_t length = 4;
+    for (size_t column = 0; column < batch.data.size(); column++)
+        length += 4 + batch.rowCount * 4 + batch.data[column].size();
+
+    std::string output;
+    output.reserve(length);
+    appendUint32(output, static_cast<uint32_t>(batch.rowCount));
+    for (size_t column = 0; column < batch.data.size(); column++)
+    {
+        appendUint32(output, static_cast<uint32_t>(batch.data[column].size()));
+        size_t endsOffset = output.size();
+        output.resize(endsOffset + batch.rowCount * 4);
+        // Both sides are little-endian
+        std::memcpy(output.data() + endsOffset, batch.ends[column].data(), batch.rowCount * 4);
+        output.append(batch.data[column]);
+    }
+    return output;
+}
+
+std::string formatBatch(ColumnBatch& batch, const ExportLayout& layout)
+{
+    convertColumnsToUtf8(batch);
+
+    switch (layout.format)
+    {
+    case ExportFormat::Csv:
+        return formatCsvBatch(batch);
+    case ExportFormat::JsonLines:
+        return formatJsonLinesBatch(batch, layout);
+    case ExportFormat::Columnar:
+        return formatColumnarBatch(batch);
+    }
+    return std::string();
+}
+
+std::string formatHeader(const GridExport& exportState)
+{
+    std::string header;
+    switch (exportState.format)
+    {
+    case ExportFormat::Csv:
+        header = UTF8_BOM;
+        for (size_t column = 0; column < exportState.columnNames.size(); column++)
+        {
+            if (column > 0)
+                header += ',';
+            appendCsvValue(header, toUtf8(exportState.columnNames[column]));
+        }
+        header += "\r\n";
+        break;
+
+    case ExportFormat::JsonLines:
+        break;
+
+    case ExportFormat::Columnar:
+        header.append(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+        appendUint32(header, static_cast<uint32_t>(exportState.columnNames.size()));
+        for (auto& columnName : exportState.columnNames)
+        {
+            std::string name = toUtf8(columnName);
+            appendUint32(header, static_cast<uint32_t>(name.size()));
+            header += name;
+        }
+        break;
+    }
+    return header;
+}
+
+void writeChunk(GridExport& exportState, std::string_view chunk)
+{
+    if (!exportState.failed && !exportState.file.write(chunk))
+        exportState.failed = true;
+}
+
+// Writes formatted chunks in order. Without waiting only the ones already done are written; the
+// number in flight is capped so a fast grid can't queue up unbounded memory behind a slow disk.
+void writeFormattedChunks(GridExport& exportState, bool waitForAll)
+{
+    size_t maxPendingChunks = getWorkerPool().threadCount() * 2;
+    while (!exportState.pendingChunks.empty())
+    {
+        auto& chunk = exportState.pendingChunks.front();
+        bool mustWait = waitForAll || exportState.pendingChunks.size() > maxPendingChunks;
+        if (!mustWait && chunk.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            break;
+
+        writeChunk(exportState, chunk.get());
+        exportState.pendingChunks.pop_front();
+    }
+}
+
+void submitBatch(GridExport& exportState)
+{
+    std::shared_ptr<ColumnBatch> batch = std::move(exportState.batch);
+    exportState.batch = std::make_unique<ColumnBatch>(exportState.columnNames.size());
+
+    auto layout = exportState.layout;
+    exportState.pendingChunks.push_back(getWorkerPool().submit([batch, layout] {
+        return formatBatch(*batch, *layout);
+    }));
+    writeFormattedChunks(exportState, false);
+}
+
+bool beginGridExport()
+{
+    gridExport.reset();
+
+    int formatIndex = getPluginPreference(EXPORT_FORMAT_PREFERENCE, 0);
+    std::wstring fileName;
+    if (!showSaveFileDialog(EXPORT_FILE_FILTER, fileName, formatIndex))
+        return false;
+    setPluginPreference(EXPORT_FORMAT_PREFERENCE, formatIndex);
+
+    auto exportState = std::make_unique<GridExport>();
+    exportState->format = formatIndex == 1 ? ExportFormat::JsonLines : formatIndex == 2 ? ExportFormat::Columnar : ExportFormat::Csv;
+    exportState->fileName = fileName;
+    if (!exportState->file.open(fileName))
+    {
+        showMessage(L"Can't create " + fileName, MB_OK | MB_ICONERROR);
+        return false;
+    }
+
+    gridExport = std::move(exportState);
+    return true;
+}
+
+bool prepareGridExport()
+{
+    if (!gridExport || gridExport->columnNames.empty())
+        return false;
+
+    auto layout = std::make_shared<ExportLayout>();
+    layout->format = gridExport->format;
+    if (layout->format == ExportFormat::JsonLines)
+    {
+        for (auto& columnName : gridExport->columnNames)
+        {
+            std::string key;
+            appendJsonString(key, toUtf8(columnName));
+            layout->jsonKeys.push_back(key + ':');
+        }
+    }
+
+    gridExport->layout = layout;
+    gridExport->batch = std::make_unique<ColumnBatch>(gridExport->columnNames.size());
+    gridExport->dataStarted = true;
+    writeChunk(*gridExport, formatHeader(*gridExport));
+    return !gridExport->failed;
+}
+
+bool addGridExportCell(const char* value)
+{
+    if (!gridExport || gridExport->failed)
+        return false;
+
+    auto& exportState = *gridExport;
+    if (!exportState.dataStarted)
+    {
+        exportState.columnNames.emplace_back(value);
+        return true;
+    }
+
+    auto& batch = *exportState.batch;
+    size_t length = std::strlen(value);
+    auto& columnData = batch.data[exportState.currentColumn];
+    columnData.append(value, length);
+    batch.ends[exportState.currentColumn].push_back(static_cast<uint32_t>(columnData.size()));
+    batch.byteCount += length;
+
+    if (++exportState.currentColumn == batch.data.size())
+    {
+        exportState.currentColumn = 0;
+        batch.rowCount++;
+        if (batch.rowCount >= EXPORT_BATCH_ROWS || batch.byteCount >= EXPORT_BATCH_BYTES)
+            submitBatch(exportState);
+    }
+
+    return !exportState.failed;
+}
+
+void finishGridExport()
+{
+    if (!gridExport)
+        return;
+
+    auto& exportState = *gridExport;
+    if (exportState.dataStarted)
+    {
+        if (exportState.batch->rowCount > 0)
+            submitBatch(exportState);
+        writeFormattedChunks(exportState, true);
+
+        if (exportState.format == ExportFormat::Columnar)
+        {
+            std::string end;
+            appendUint32(end, 0);
+            writeChunk(exportState, end);
+        }
+    }
+
+    if (!exportState.file.close())
+        exportState.failed = true;
+
+    if (exportState.failed)
+        showMessage(L"Writing " + exportState.fileName + L" failed, the file is incomplete.", MB_OK | MB_ICONERROR);
+
+    gridExport.reset();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Result grid export behind PL/SQL Developer's RegisterExport interface. The IDE hands over the
+// grid one cell at a time: column names first, then ExportPrepare, then the data row by row.
+// Cells are collected into columnar batches that are formatted on the worker pool while the
+// IDE keeps sending the next ones, and written out in order as large chunks.
+//
+// Formats, picked in the save dialog:
+// - CSV (RFC 4180, UTF-8 with BOM)
+// - JSON lines, one object per row with column names as keys and NULL for empty cells
+// - columnar binary, see formatColumnarBatch
+constexpr auto GRID_EXPORT_NAME = "Fast export (CSV, JSON lines, columnar)";
+
+bool beginGridExport();
+bool prepareGridExport();
+bool addGridExportCell(const char* value);
+void finishGridExport();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Fast non-cryptographic hashing for tables and sketches. There's no random seeding, so hashes
+// are the same in every run and may be stored.
+
+// Finalizer of splitmix64: spreads every input bit over the whole result
+inline uint64_t mixHash(uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ull;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBull;
+    value ^= value >> 31;
+    return value;
+}
+
+// Consumes 8 bytes per step
+inline uint64_t hashBytes(const void* data, size_t length, uint64_t seed = 0)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed ^ (length * 0x9E3779B97F4A7C15ull);
+
+    while (length >= 8)
+    {
+        uint64_t chunk;
+        std::memcpy(&chunk, bytes, 8);
+        hash = (hash ^ mixHash(chunk)) * 0x9E3779B97F4A7C15ull;
+        bytes += 8;
+        length -= 8;
+    }
+
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes, length);
+    hash ^= tail;
+
+    return mixHash(hash);
+}
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "PlSqlKeywords.hpp"
+#include "KeywordCase.hpp"
+
+typedef BasicPlSqlLexer<EDITOR_CHAR> EditorLexer;
+
+bool isSymbolToken(EditorStringView text, const Token& token, EditorStringView symbol)
+{
+    return token.type == TokenType::Symbol && text.substr(token.offset, token.length) == symbol;
+}
+
+// Named parameters are followed by =>
+bool isFollowedByArrow(EditorStringView text, size_t offset)
+{
+    while (offset < text.size() && EditorLexer::isWhitespace(text[offset]))
+        offset++;
+    return text.substr(offset, 2) == EDT_TX("=>");
+}
+
+void changeKeywordCase(bool upperCase)
+{
+    if (!IDE_WindowHasEditor(false) || IDE_GetReadOnly())
+        return;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+
+    auto changeStart = std::chrono::steady_clock::now();
+    EditorString text = getEditorText(editorWindow);
+    size_t rangeStart = 0;
+    size_t rangeEnd = text.size();
+    if (selectionStart != selectionEnd)
+    {
+        rangeStart = std::min(static_cast<size_t>(selectionStart), text.size());
+        rangeEnd = std::min(static_cast<size_t>(selectionEnd), text.size());
+    }
+
+    // Lexed from the start, so a selection starting inside a comment or literal is seen as one.
+    // Words only partly selected are left alone.
+    EditorLexer lexer(text.data(), text.size());
+    Token token;
+    Token previous = { TokenType::Comment, 0, 0 };
+    size_t changedStart = text.size();
+    size_t changedEnd = 0;
+    size_t changedCount = 0;
+    while (lexer.next(token) && token.offset < rangeEnd)
+    {
+        if (token.type == TokenType::Word && token.offset >= rangeStart && token.offset + token.length <= rangeEnd
+            && isPlSqlKeyword(text.data() + token.offset, token.length)
+            && !isSymbolToken(text, previous, EDT_TX(".")) && !isFollowedByArrow(text, token.offset + token.length))
+        {
+            bool changed = false;
+            for (size_t i = token.offset; i < token.offset + token.length; i++)
+            {
+                EDITOR_CHAR c = toUpperAsciiChar(text[i]);
+                if (!upperCase && c >= EDT_TX('A') && c <= EDT_TX('Z'))
+                    c = c - EDT_TX('A') + EDT_TX('a');
+                if (c == text[i])
+                    continue;
+                text[i] = c;
+                changed = true;
+            }
+            if (changed)
+            {
+                changedStart = std::min(changedStart, static_cast<size_t>(token.offset));
+                changedEnd = token.offset + token.length;
+                changedCount++;
+            }
+        }
+        if (token.type != TokenType::Comment)
+            previous = token;
+    }
+    if (changedCount == 0)
+    {
+        IDE_SetStatusMessage("No keywords to change");
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    // Only the span from the first to the last changed keyword is replaced. Its length doesn't
+    // change, so the selection stays where it was.
+    EditorString replacement = text.substr(changedStart, changedEnd - changedStart);
+    int firstVisibleLine = SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0);
+    SendMessage(editorWindow, WM_SETREDRAW, FALSE, 0);
+    SendMessage(editorWindow, EM_SETSEL, changedStart, changedEnd);
+    SendMessage(editorWindow, EM_REPLACESEL, TRUE, reinterpret_cast<LPARAM>(replacement.c_str()));
+    SendMessage(editorWindow, EM_SETSEL, selectionStart, selectionEnd);
+    SendMessage(editorWindow, EM_LINESCROLL, 0, firstVisibleLine - SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0));
+    SendMessage(editorWindow, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(editorWindow, NULL, TRUE);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - changeStart);
+
+    IDE_SetStatusMessage((std::to_string(changedCount) + " keywords changed in " + std::to_string(elapsed.count()) + " ms").c_str());
+}
+
+void upperCaseKeywords()
+{
+    changeKeywordCase(true);
+}
+
+void lowerCaseKeywords()
+{
+    changeKeywordCase(false);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// Changes the case of the keywords in the selection, or in the whole text without a selection,
+// leaving identifiers, literals, comments and quoted identifiers alone. Names after a dot and
+// named parameters aren't taken for keywords. The changed span is replaced at once, so it's
+// undone in one step.
+void upperCaseKeywords();
+void lowerCaseKeywords();
@@ -0,0 +1,284 @@
+#include "pch.h"
+#include <intrin.h>
+#include <emmintrin.h>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "FileUtils.hpp"
+#include "Ui.hpp"
+#include "LargeScript.hpp"
+
+// A part ends at the first statement end past this size
+constexpr size_t PART_TARGET_BYTES = 1024 * 1024;
+// or at the first line end past this one
+constexpr size_t PART_LINE_END_BYTES = 2 * PART_TARGET_BYTES;
+// or anywhere past this one, for lines longer than the editor would take
+constexpr size_t PART_MAX_BYTES = 8 * PART_TARGET_BYTES;
+// The index is built through views of this size, a multiple of the 16 bytes scanned at a time
+constexpr size_t INDEX_VIEW_BYTES = 64 * PART_TARGET_BYTES;
+
+struct ScriptPart
+{
+    uint64_t offset;
+    // Zero-based line of the part's first character
+    uint64_t firstLine;
+    // The part starts in the middle of firstLine
+    bool continuesLine;
+};
+
+struct LargeScript
+{
+    std::wstring fileName;
+    SlidingFileView file;
+    std::vector<ScriptPart> parts;
+    uint64_t lineCount = 0;
+    size_t currentPart = 0;
+    HWND editorWindow = NULL;
+};
+
+LargeScript largeScript;
+
+// A line ending in ';', or one with just '/', as SQL*Plus scripts end their statements with.
+// Neither is certain to end a statement, but a part ending elsewhere only looks less tidy. A line
+// starting in an earlier view is only seen from the view's start on.
+bool endsStatement(std::string_view line, bool wholeLine)
+{
+    size_t i = line.size();
+    while (i > 0 && (line[i - 1] == '\r' || line[i - 1] == ' ' || line[i - 1] == '\t'))
+        i--;
+    if (i == 0)
+        return false;
+    if (line[i - 1] == ';')
+        return true;
+    if (line[i - 1] != '/')
+        return false;
+    i--;
+    while (i > 0 && (line[i - 1] == ' ' || line[i - 1] == '\t'))
+        i--;
+    return i == 0 && wholeLine;
+}
+
+// The file is read through one view at a time. The newlines are found 16 bytes at a time, and only
+// the lines ending past the target size of a part are looked at any closer. Returns false if a
+// view couldn't be mapped.
+bool indexParts(SlidingFileView& file, std::vector<ScriptPart>& parts, uint64_t& lineCount)
+{
+    parts.clear();
+    parts.push_back({ 0, 0, false });
+    uint64_t fileSize = file.fileSize();
+    uint64_t line = 0;
+    uint64_t partStart = 0;
+    uint64_t lineStart = 0;
+
+    for (uint64_t viewStart = 0; viewStart < fileSize; viewStart += INDEX_VIEW_BYTES)
+    {
+        std::string_view data = file.map(viewStart, INDEX_VIEW_BYTES);
+        if (data.empty())
+            return false;
+
+        auto addLineEnd = [&](size_t newline) {
+            line++;
+            uint64_t next = viewStart + newline + 1;
+            uint64_t partSize = next - partStart;
+            size_t seenStart = static_cast<size_t>(std::max(lineStart, viewStart) - viewStart);
+            if (partSize >= PART_TARGET_BYTES && next < fileSize
+                && (partSize >= PART_LINE_END_BYTES || endsStatement(data.substr(seenStart, newline - seenStart), lineStart >= viewStart)))
+            {
+                parts.push_back({ next, line, false });
+                partStart = next;
+            }
+            lineStart = next;
+        };
+
+        const char* bytes = data.data();
+        const __m128i newlines = _mm_set1_epi8('\n');
+        size_t i = 0;
+        for (; i + sizeof(__m128i) <= data.size(); i += sizeof(__m128i))
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+            unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines)));
+            while (mask != 0)
+            {
+                unsigned long bit;
+                _BitScanForward(&bit, mask);
+                addLineEnd(i + bit);
+                mask &= mask - 1;
+            }
+
+            uint64_t blockEnd = viewStart + i + sizeof(__m128i);
+            if (blockEnd - partStart >= PART_MAX_BYTES && blockEnd < fileSize)
+            {
+                parts.push_back({ blockEnd, line, blockEnd != lineStart });
+                partStart = blockEnd;
+            }
+        }
+        for (; i < data.size(); i++)
+        {
+            if (bytes[i] == '\n')
+                addLineEnd(i);
+        }
+    }
+    file.unmap();
+
+    lineCount = line + (lineStart < fileSize ? 1 : 0);
+    return true;
+}
+
+uint64_t getPartEnd(size_t part)
+{
+    return part + 1 < largeScript.parts.size() ? largeScript.parts[part + 1].offset : largeScript.file.fileSize();
+}
+
+// The last line of a part is the first of the next one when the next one continues it
+uint64_t getPartLastLine(size_t part)
+{
+    if (part + 1 >= largeScript.parts.size())
+        return largeScript.lineCount > 0 ? largeScript.lineCount - 1 : 0;
+    const ScriptPart& next = largeScript.parts[part + 1];
+    return next.continuesLine ? next.firstLine : next.firstLine - 1;
+}
+
+bool isLargeScriptWindowActive()
+{
+    return largeScript.editorWindow != NULL && IsWindow(largeScript.editorWindow)
+        && IDE_GetEditorHandle() == largeScript.editorWindow;
+}
+
+void showLargeScriptStatus()
+{
+    size_t slash = largeScript.fileName.find_last_of(L"\\/");
+    std::wstring name = slash == std::wstring::npos ? largeScript.fileName : largeScript.fileName.substr(slash + 1);
+    const ScriptPart& part = largeScript.parts[largeScript.currentPart];
+    std::wstring status = name + L": part " + std::to_wstring(largeScript.currentPart + 1) + L" of "
+        + std::to_wstring(largeScript.parts.size()) + L", lines " + std::to_wstring(part.firstLine + 1) + L"-"
+        + std::to_wstring(getPartLastLine(largeScript.currentPart) + 1) + L" of " + std::to_wstring(largeScript.lineCount);
+    IDE_SetStatusMessage(toAnsiString(status).c_str());
+}
+
+// Replaces the window's text with the part and selects the line, counted from the part's start
+void showLargeScriptPart(size_t part, size_t partLine, bool atEnd)
+{
+    uint64_t offset = largeScript.parts[part].offset;
+    std::string_view view = largeScript.file.map(offset, static_cast<size_t>(getPartEnd(part) - offset));
+    if (view.empty())
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+    std::string text(view);
+    largeScript.file.unmap();
+    // The IDE takes the text up to the first null
+    std::replace(text.begin(), text.end(), '\0', ' ');
+
+    IDE_SetReadOnly(FALSE);
+    BOOL shown = IDE_SetText(text.c_str());
+    IDE_SetReadOnly(TRUE);
+    if (!shown)
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+    largeScript.currentPart = part;
+
+    HWND editorWindow = largeScript.editorWindow;
+    LRESULT lineStart = atEnd ? -1 : SendMessage(editorWindow, EM_LINEINDEX, partLine, 0);
+    if (lineStart < 0)
+        lineStart = GetWindowTextLength(editorWindow);
+    LRESULT lineLength = atEnd ? 0 : SendMessage(editorWindow, EM_LINELENGTH, lineStart, 0);
+    SendMessage(editorWindow, EM_SETSEL, lineStart + lineLength, lineStart);
+    SendMessage(editorWindow, EM_SCROLLCARET, 0, 0);
+    showLargeScriptStatus();
+}
+
+void openLargeScript()
+{
+    std::wstring fileName;
+    if (!showOpenFileDialog(L"SQL scripts (*.sql)\0*.sql\0All files (*.*)\0*.*\0", fileName))
+        return;
+
+    closeLargeScript();
+    if (!largeScript.file.open(fileName))
+    {
+        showMessage(L"Can't open " + fileName, MB_OK | MB_ICONERROR);
+        return;
+    }
+    largeScript.fileName = fileName;
+    if (!indexParts(largeScript.file, largeScript.parts, largeScript.lineCount))
+    {
+        showMessage(L"Can't read " + fileName, MB_OK | MB_ICONERROR);
+        closeLargeScript();
+        return;
+    }
+
+    // A window without a file name, so that it's never saved over the script
+    IDE_CreateWindow(PLSQL_WT_SQL, "", FALSE);
+    largeScript.editorWindow = IDE_GetEditorHandle();
+    showLargeScriptPart(0, 0, false);
+}
+
+// The other commands work in the window opened by the last openLargeScript
+bool checkLargeScriptWindow()
+{
+    if (isLargeScriptWindowActive())
+        return true;
+    MessageBeep(MB_OK);
+    return false;
+}
+
+void showNextLargeScriptPart()
+{
+    if (!checkLargeScriptWindow())
+        return;
+    if (largeScript.currentPart + 1 >= largeScript.parts.size())
+    {
+        IDE_SetStatusMessage("This is the last part of the script");
+        return;
+    }
+    showLargeScriptPart(largeScript.currentPart + 1, 0, false);
+}
+
+void showPreviousLargeScriptPart()
+{
+    if (!checkLargeScriptWindow())
+        return;
+    if (largeScript.currentPart == 0)
+    {
+        IDE_SetStatusMessage("This is the first part of the script");
+        return;
+    }
+    showLargeScriptPart(largeScript.currentPart - 1, 0, true);
+}
+
+void goToLargeScriptLine()
+{
+    if (!checkLargeScriptWindow())
+        return;
+
+    int lineNumber = static_cast<int>(largeScript.parts[largeScript.currentPart].firstLine + 1);
+    if (!showIntegerInputBox(L"Go to line", L"Line:", lineNumber))
+        return;
+    uint64_t line = std::min<uint64_t>(lineNumber, std::max<uint64_t>(largeScript.lineCount, 1)) - 1;
+
+    // The part where the line starts
+    auto found = std::upper_bound(largeScript.parts.begin(), largeScript.parts.end(), line, [](uint64_t line, const ScriptPart& part) {
+        return line < part.firstLine;
+    });
+    size_t part = found - largeScript.parts.begin() - 1;
+    while (part > 0 && largeScript.parts[part].continuesLine && largeScript.parts[part].firstLine == line)
+        part--;
+
+    showLargeScriptPart(part, static_cast<size_t>(line - largeScript.parts[part].firstLine), false);
+}
+
+void closeLargeScript()
+{
+    largeScript.file.close();
+    largeScript.fileName.clear();
+    largeScript.parts.clear();
+    largeScript.lineCount = 0;
+    largeScript.currentPart = 0;
+    largeScript.editorWindow = NULL;
+}
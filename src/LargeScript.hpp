@@ -0,0 +1,11 @@
+#pragma once
+
+// Views a script too large for the editor one part at a time. The file is mapped a view at a time
+// rather than read, and a single pass over it splits it into parts of about a megabyte, ending at
+// statement ends where it can. A read-only SQL window shows one part, which the other commands replace.
+void openLargeScript();
+void showNextLargeScriptPart();
+void showPreviousLargeScriptPart();
+// Shows the part with the line, the line selected
+void goToLargeScriptLine();
+void closeLargeScript();
@@ -0,0 +1,602 @@
+#include "pch.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <functional>
+#include <future>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "Plugin.hpp"
+#include "PlSqlLexer.hpp"
+#include "Ui.hpp"
+#include "WorkerPool.hpp"
+#include "LineTransforms.hpp"
+
+constexpr size_t SORT_KEY_BATCH_LINES = 16384;
+constexpr EditorStringView LINE_COMMENT = EDT_TX("-- ");
+constexpr EditorStringView BLOCK_COMMENT_START = EDT_TX("/*");
+constexpr EditorStringView BLOCK_COMMENT_END = EDT_TX("*/");
+constexpr EditorStringView CONTINUATION_INDENT = EDT_TX("   ");
+constexpr auto SPLIT_LIST_WIDTH_PREFERENCE = "SplitListWidth";
+constexpr auto SPLIT_LIST_ITEMS_PREFERENCE = "SplitListItems";
+constexpr int DEFAULT_SPLIT_LIST_WIDTH = 100;
+constexpr int DEFAULT_SPLIT_LIST_ITEMS = 10;
+
+enum class SortOrder
+{
+    Ordinal,
+    OrdinalIgnoringCase,
+    Locale,
+    LocaleIgnoringCase,
+};
+
+const std::vector<std::wstring> SORT_ORDER_NAMES = { L"Ordinal", L"Ordinal, ignoring case", L"Locale", L"Locale, ignoring case" };
+const std::vector<std::wstring> SPLIT_LIST_MODE_NAMES = { L"Wrap at width", L"Items per line" };
+
+typedef BasicPlSqlLexer<EDITOR_CHAR> EditorLexer;
+
+struct SelectedLines
+{
+    HWND editorWindow;
+    // Character indexes of the start of the first line and the end of the last one
+    int start;
+    int end;
+    int selectionStart;
+    int selectionEnd;
+    EditorString text;
+    std::vector<EditorStringView> lines;
+};
+
+struct KeyedLine
+{
+    std::string_view key;
+    EditorStringView line;
+};
+
+// Reads the whole text at once and splits the lines the selection touches, or all lines (or the
+// caret's line) if nothing is selected. A selection ending at the start of a line doesn't take
+// that line.
+bool getSelectedLines(SelectedLines& selected, bool allLinesWithoutSelection = true)
+{
+    if (!IDE_WindowHasEditor(false) || IDE_GetReadOnly())
+        return false;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    selected.editorWindow = editorWindow;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selected.selectionStart), reinterpret_cast<WPARAM>(&selected.selectionEnd));
+
+    int firstLine = 0;
+    int lastLine = SendMessage(editorWindow, EM_GETLINECOUNT, 0, 0) - 1;
+    if (selected.selectionStart != selected.selectionEnd || !allLinesWithoutSelection)
+    {
+        firstLine = SendMessage(editorWindow, EM_LINEFROMCHAR, selected.selectionStart, 0);
+        lastLine = SendMessage(editorWindow, EM_LINEFROMCHAR, selected.selectionEnd, 0);
+        if (lastLine > firstLine && SendMessage(editorWindow, EM_LINEINDEX, lastLine, 0) == selected.selectionEnd)
+            lastLine--;
+    }
+    selected.start = SendMessage(editorWindow, EM_LINEINDEX, firstLine, 0);
+    int lastLineStart = SendMessage(editorWindow, EM_LINEINDEX, lastLine, 0);
+    selected.end = lastLineStart + SendMessage(editorWindow, EM_LINELENGTH, lastLineStart, 0);
+
+    selected.text = getEditorText(editorWindow);
+    selected.end = std::min(selected.end, static_cast<int>(selected.text.size()));
+    selected.start = std::min(selected.start, selected.end);
+    selected.lines = splitLines(EditorStringView(selected.text).substr(selected.start, selected.end - selected.start));
+    return true;
+}
+
+EditorString joinLines(const std::vector<EditorStringView>& lines)
+{
+    size_t length = 0;
+    for (auto line : lines)
+        length += line.size() + 2;
+
+    EditorString joined;
+    joined.reserve(length);
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        if (i > 0)
+            joined += EDT_TX("\r\n");
+        joined += lines[i];
+    }
+    return joined;
+}
+
+// Leaves the rewritten lines selected, or the caret where it was if nothing was selected
+void replaceSelectedLines(const SelectedLines& selected, const EditorString& replacement, const std::string& status)
+{
+    HWND editorWindow = selected.editorWindow;
+    int firstVisibleLine = SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0);
+
+    SendMessage(editorWindow, WM_SETREDRAW, FALSE, 0);
+    SendMessage(editorWindow, EM_SETSEL, selected.start, selected.end);
+    SendMessage(editorWindow, EM_REPLACESEL, TRUE, reinterpret_cast<LPARAM>(replacement.c_str()));
+    if (selected.selectionStart != selected.selectionEnd)
+        SendMessage(editorWindow, EM_SETSEL, selected.start, selected.start + replacement.size());
+    else
+        SendMessage(editorWindow, EM_SETSEL, selected.selectionStart, selected.selectionStart);
+    SendMessage(editorWindow, EM_LINESCROLL, 0, firstVisibleLine - SendMessage(editorWindow, EM_GETFIRSTVISIBLELINE, 0, 0));
+    SendMessage(editorWindow, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(editorWindow, NULL, TRUE);
+
+    IDE_SetStatusMessage(status.c_str());
+}
+
+// Sort keys make every comparison a comparison of bytes. They're made in parallel in batches.
+void sortByLocale(std::vector<EditorStringView>& lines, bool ignoreCase)
+{
+    DWORD flags = LCMAP_SORTKEY | (ignoreCase ? LINGUISTIC_IGNORECASE : 0);
+    size_t batchCount = (lines.size() + SORT_KEY_BATCH_LINES - 1) / SORT_KEY_BATCH_LINES;
+    std::vector<std::string> keyBuffers(batchCount);
+    std::vector<KeyedLine> keyedLines(lines.size());
+    std::vector<std::future<void>> batches;
+    for (size_t batch = 0; batch < batchCount; batch++)
+    {
+        batches.push_back(getWorkerPool().submit([&, batch, flags] {
+            size_t begin = batch * SORT_KEY_BATCH_LINES;
+            size_t end = std::min(lines.size(), begin + SORT_KEY_BATCH_LINES);
+            std::string& keys = keyBuffers[batch];
+            std::vector<size_t> keyEnds;
+            for (size_t i = begin; i < end; i++)
+            {
+                EditorStringView line = lines[i];
+                int keyLength = line.empty() ? 0
+                    : LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, line.data(), static_cast<int>(line.size()), NULL, 0, NULL, NULL, 0);
+                size_t keyStart = keys.size();
+                keys.resize(keyStart + keyLength);
+                if (keyLength > 0)
+                {
+                    LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, line.data(), static_cast<int>(line.size()),
+                        reinterpret_cast<LPWSTR>(&keys[keyStart]), keyLength, NULL, NULL, 0);
+                }
+                keyEnds.push_back(keys.size());
+            }
+
+            // The buffer doesn't move anymore
+            size_t keyStart = 0;
+            for (size_t i = begin; i < end; i++)
+            {
+                size_t keyEnd = keyEnds[i - begin];
+                keyedLines[i] = { std::string_view(keys).substr(keyStart, keyEnd - keyStart), lines[i] };
+                keyStart = keyEnd;
+            }
+        }));
+    }
+    for (auto& batch : batches)
+        batch.get();
+
+    parallelSort(keyedLines.begin(), keyedLines.end(), [](const KeyedLine& a, const KeyedLine& b) { return a.key < b.key; });
+    for (size_t i = 0; i < lines.size(); i++)
+        lines[i] = keyedLines[i].line;
+}
+
+void sortLines()
+{
+    if (!IDE_WindowHasEditor(false) || IDE_GetReadOnly())
+        return;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+    int order = showPopupList(editorWindow, getCharScreenPosition(editorWindow, selectionEnd), SORT_ORDER_NAMES);
+    if (order < 0)
+        return;
+
+    SelectedLines selected;
+    if (!getSelectedLines(selected))
+        return;
+
+    auto sortStart = std::chrono::steady_clock::now();
+    switch (static_cast<SortOrder>(order))
+    {
+    case SortOrder::Ordinal:
+        parallelSort(selected.lines.begin(), selected.lines.end(), std::less<EditorStringView>());
+        break;
+    case SortOrder::OrdinalIgnoringCase:
+        parallelSort(selected.lines.begin(), selected.lines.end(), [](EditorStringView a, EditorStringView b) {
+            return CompareStringOrdinal(a.data(), static_cast<int>(a.size()), b.data(), static_cast<int>(b.size()), TRUE) == CSTR_LESS_THAN;
+        });
+        break;
+    case SortOrder::Locale:
+    case SortOrder::LocaleIgnoringCase:
+        sortByLocale(selected.lines, static_cast<SortOrder>(order) == SortOrder::LocaleIgnoringCase);
+        break;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - sortStart);
+
+    replaceSelectedLines(selected, joinLines(selected.lines),
+        std::to_string(selected.lines.size()) + " lines sorted in " + std::to_string(elapsed.count()) + " ms");
+}
+
+void removeDuplicateLines()
+{
+    SelectedLines selected;
+    if (!getSelectedLines(selected))
+        return;
+
+    size_t lineCount = selected.lines.size();
+    std::unordered_set<EditorStringView> seenLines;
+    seenLines.reserve(lineCount);
+    selected.lines.erase(std::remove_if(selected.lines.begin(), selected.lines.end(), [&seenLines](EditorStringView line) {
+        return !seenLines.insert(line).second;
+    }), selected.lines.end());
+    if (selected.lines.size() == lineCount)
+    {
+        IDE_SetStatusMessage("No duplicate lines");
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    replaceSelectedLines(selected, joinLines(selected.lines), std::to_string(lineCount - selected.lines.size()) + " duplicate lines removed");
+}
+
+void reverseLines()
+{
+    SelectedLines selected;
+    if (!getSelectedLines(selected))
+        return;
+
+    std::reverse(selected.lines.begin(), selected.lines.end());
+    replaceSelectedLines(selected, joinLines(selected.lines), std::to_string(selected.lines.size()) + " lines reversed");
+}
+
+void shuffleLines()
+{
+    SelectedLines selected;
+    if (!getSelectedLines(selected))
+        return;
+
+    std::mt19937_64 random(std::random_device{}());
+    std::shuffle(selected.lines.begin(), selected.lines.end(), random);
+    replaceSelectedLines(selected, joinLines(selected.lines), std::to_string(selected.lines.size()) + " lines shuffled");
+}
+
+void numberLines()
+{
+    SelectedLines selected;
+    if (!getSelectedLines(selected))
+        return;
+
+    size_t width = std::to_wstring(selected.lines.size()).size();
+    EditorString numbered;
+    numbered.reserve(selected.end - selected.start + selected.lines.size() * (width + 2));
+    for (size_t i = 0; i < selected.lines.size(); i++)
+    {
+        if (i > 0)
+            numbered += EDT_TX("\r\n");
+        std::wstring number = std::to_wstring(i + 1);
+        numbered.append(width - number.size(), EDT_TX(' '));
+        numbered += number;
+        numbered += EDT_TX(". ");
+        numbered += selected.lines[i];
+    }
+
+    replaceSelectedLines(selected, numbered, std::to_string(selected.lines.size()) + " lines numbered");
+}
+
+// Indentation in columns, tabs counting like in findFirstNonWhiteChar. Returns the index of the
+// first character past it.
+size_t skipIndentation(EditorStringView line, int& indent)
+{
+    indent = 0;
+    size_t i = 0;
+    for (; i < line.size(); i++)
+    {
+        if (line[i] == EDT_TX(' '))
+            indent++;
+        else if (line[i] == EDT_TX('\t'))
+            indent += EDITOR_TAB_WIDTH;
+        else
+            break;
+    }
+    return i;
+}
+
+void toggleLineComment()
+{
+    SelectedLines selected;
+    if (!getSelectedLines(selected, false))
+        return;
+
+    // Lines are uncommented if all of them are comments, blank ones aside
+    bool allCommented = true;
+    int minIndent = INT_MAX;
+    for (auto line : selected.lines)
+    {
+        int indent;
+        size_t textStart = skipIndentation(line, indent);
+        if (textStart == line.size())
+            continue;
+        minIndent = std::min(minIndent, indent);
+        if (line.substr(textStart, 2) != EDT_TX("--"))
+            allCommented = false;
+    }
+    if (minIndent == INT_MAX)
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    EditorString toggled;
+    toggled.reserve(selected.end - selected.start + selected.lines.size() * (LINE_COMMENT.size() + 2));
+    // Where the line changed and by how much, to keep the caret on its text without a selection
+    size_t changeOffset = 0;
+    int changeLength = 0;
+    for (size_t i = 0; i < selected.lines.size(); i++)
+    {
+        if (i > 0)
+            toggled += EDT_TX("\r\n");
+        EditorStringView line = selected.lines[i];
+        int indent;
+        size_t textStart = skipIndentation(line, indent);
+        if (textStart == line.size())
+        {
+            toggled += line;
+            continue;
+        }
+
+        if (allCommented)
+        {
+            size_t commentEnd = textStart + 2;
+            if (commentEnd < line.size() && line[commentEnd] == EDT_TX(' '))
+                commentEnd++;
+            toggled += line.substr(0, textStart);
+            toggled += line.substr(commentEnd);
+            changeOffset = textStart;
+            changeLength = static_cast<int>(textStart) - static_cast<int>(commentEnd);
+        }
+        else
+        {
+            // Comments go at the smallest indentation, so the lines stay aligned
+            size_t insertAt = 0;
+            for (int column = 0; column < minIndent; insertAt++)
+                column += line[insertAt] == EDT_TX('\t') ? EDITOR_TAB_WIDTH : 1;
+            toggled += line.substr(0, insertAt);
+            toggled += LINE_COMMENT;
+            toggled += line.substr(insertAt);
+            changeOffset = insertAt;
+            changeLength = static_cast<int>(LINE_COMMENT.size());
+        }
+    }
+
+    replaceSelectedLines(selected, toggled,
+        std::to_string(selected.lines.size()) + (allCommented ? " lines uncommented" : " lines commented"));
+    if (selected.selectionStart == selected.selectionEnd)
+    {
+        int caret = selected.selectionStart - selected.start;
+        if (caret >= static_cast<int>(changeOffset))
+            caret = std::max(static_cast<int>(changeOffset), caret + changeLength);
+        SendMessage(selected.editorWindow, EM_SETSEL, selected.start + caret, selected.start + caret);
+    }
+}
+
+void toggleBlockComment()
+{
+    if (!IDE_WindowHasEditor(false) || IDE_GetReadOnly())
+        return;
+
+    SelectedLines selected;
+    selected.editorWindow = IDE_GetEditorHandle();
+    SendMessage(selected.editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selected.selectionStart), reinterpret_cast<WPARAM>(&selected.selectionEnd));
+    selected.text = getEditorText(selected.editorWindow);
+    selected.end = std::min(selected.selectionEnd, static_cast<int>(selected.text.size()));
+    selected.start = std::min(selected.selectionStart, selected.end);
+    if (selected.start == selected.end)
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    // Whitespace around the selected code stays outside the comment
+    EditorStringView selection = EditorStringView(selected.text).substr(selected.start, selected.end - selected.start);
+    size_t codeStart = selection.find_first_not_of(EDT_TX(" \t\r\n"));
+    size_t codeEnd = selection.find_last_not_of(EDT_TX(" \t\r\n")) + 1;
+    if (codeStart == EditorStringView::npos)
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+    EditorStringView code = selection.substr(codeStart, codeEnd - codeStart);
+
+    EditorString replacement(selection.substr(0, codeStart));
+    // One comment, not code between two of them like /* a */ b /* c */
+    bool commented = code.size() >= BLOCK_COMMENT_START.size() + BLOCK_COMMENT_END.size()
+        && code.substr(0, BLOCK_COMMENT_START.size()) == BLOCK_COMMENT_START
+        && code.find(BLOCK_COMMENT_END, BLOCK_COMMENT_START.size()) == code.size() - BLOCK_COMMENT_END.size();
+    if (commented)
+    {
+        code = code.substr(BLOCK_COMMENT_START.size(), code.size() - BLOCK_COMMENT_START.size() - BLOCK_COMMENT_END.size());
+        if (!code.empty() && code.front() == EDT_TX(' '))
+            code.remove_prefix(1);
+        if (!code.empty() && code.back() == EDT_TX(' '))
+            code.remove_suffix(1);
+        replacement += code;
+    }
+    else
+    {
+        if (code.find(BLOCK_COMMENT_END) != EditorStringView::npos)
+        {
+            IDE_SetStatusMessage("The selection contains */, which would end the comment early");
+            MessageBeep(MB_OK);
+            return;
+        }
+        replacement += BLOCK_COMMENT_START;
+        replacement += EDT_TX(' ');
+        replacement += code;
+        replacement += EDT_TX(' ');
+        replacement += BLOCK_COMMENT_END;
+    }
+    replacement += selection.substr(codeEnd);
+
+    replaceSelectedLines(selected, replacement, commented ? "Comment removed" : "Selection commented");
+}
+
+std::vector<Token> lexText(EditorStringView text)
+{
+    std::vector<Token> tokens;
+    EditorLexer lexer(text.data(), text.size());
+    Token token;
+    while (lexer.next(token))
+        tokens.push_back(token);
+    return tokens;
+}
+
+bool isSymbol(EditorStringView text, const Token& token, EDITOR_CHAR symbol)
+{
+    return token.type == TokenType::Symbol && token.length == 1 && text[token.offset] == symbol;
+}
+
+// Column reached after the text, tabs counting like in findFirstNonWhiteChar
+int advanceColumn(int column, EditorStringView text)
+{
+    for (auto c : text)
+    {
+        if (c == EDT_TX('\r') || c == EDT_TX('\n'))
+            column = 0;
+        else
+            column += c == EDT_TX('\t') ? EDITOR_TAB_WIDTH : 1;
+    }
+    return column;
+}
+
+void splitList()
+{
+    if (!IDE_WindowHasEditor(false) || IDE_GetReadOnly())
+        return;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    int selectionStart, selectionEnd;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<WPARAM>(&selectionEnd));
+    int mode = showPopupList(editorWindow, getCharScreenPosition(editorWindow, selectionEnd), SPLIT_LIST_MODE_NAMES);
+    if (mode < 0)
+        return;
+
+    bool byWidth = mode == 0;
+    const char* preference = byWidth ? SPLIT_LIST_WIDTH_PREFERENCE : SPLIT_LIST_ITEMS_PREFERENCE;
+    int limit = getPluginPreference(preference, byWidth ? DEFAULT_SPLIT_LIST_WIDTH : DEFAULT_SPLIT_LIST_ITEMS);
+    if (!showIntegerInputBox(L"Split list", byWidth ? L"Line width:" : L"Items per line:", limit))
+        return;
+    setPluginPreference(preference, limit);
+
+    SelectedLines selected;
+    if (!getSelectedLines(selected, false))
+        return;
+
+    EditorStringView text = EditorStringView(selected.text).substr(selected.start, selected.end - selected.start);
+    std::vector<Token> tokens = lexText(text);
+
+    // Only the commas of the outermost list break lines, so VALUES tuples are kept whole
+    std::vector<int> depths(tokens.size());
+    int depth = 0;
+    int listDepth = INT_MAX;
+    for (size_t i = 0; i < tokens.size(); i++)
+    {
+        if (isSymbol(text, tokens[i], EDT_TX('(')))
+            depth++;
+        else if (isSymbol(text, tokens[i], EDT_TX(')')))
+            depth = std::max(0, depth - 1);
+        else if (isSymbol(text, tokens[i], EDT_TX(',')))
+            listDepth = std::min(listDepth, depth);
+        depths[i] = depth;
+    }
+    std::vector<size_t> listCommas;
+    for (size_t i = 0; i < tokens.size(); i++)
+    {
+        if (depths[i] == listDepth && isSymbol(text, tokens[i], EDT_TX(',')))
+            listCommas.push_back(i);
+    }
+    if (listCommas.empty())
+    {
+        IDE_SetStatusMessage("No list to split");
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    // Continuation lines are indented one level more than the first line
+    int firstLineIndent;
+    EditorString indent(selected.lines[0].substr(0, skipIndentation(selected.lines[0], firstLineIndent)));
+    indent += CONTINUATION_INDENT;
+    int indentColumns = advanceColumn(0, indent);
+
+    EditorString split;
+    split.reserve(text.size() + listCommas.size() * (indent.size() + 2));
+    size_t copied = 0;
+    int column = 0;
+    int itemsOnLine = 0;
+    size_t lineCount = 1;
+    for (size_t k = 0; k < listCommas.size(); k++)
+    {
+        size_t commaToken = listCommas[k];
+        size_t itemEnd = tokens[commaToken].offset + 1;
+        if (commaToken + 1 == tokens.size())
+            break;
+
+        split.append(text.substr(copied, itemEnd - copied));
+        column = advanceColumn(column, text.substr(copied, itemEnd - copied));
+        itemsOnLine++;
+
+        // The whitespace after the comma becomes a space or a line break
+        size_t nextItem = tokens[commaToken + 1].offset;
+        size_t nextItemEnd = k + 1 < listCommas.size() ? tokens[listCommas[k + 1]].offset + 1 : text.size();
+        bool lineBreak = byWidth ? column + 1 + advanceColumn(0, text.substr(nextItem, nextItemEnd - nextItem)) > limit : itemsOnLine >= limit;
+        if (lineBreak)
+        {
+            split += EDT_TX("\r\n");
+            split += indent;
+            column = indentColumns;
+            itemsOnLine = 0;
+            lineCount++;
+        }
+        else
+        {
+            split += EDT_TX(' ');
+            column++;
+        }
+        copied = nextItem;
+    }
+    split.append(text.substr(copied));
+
+    replaceSelectedLines(selected, split, "List split into " + std::to_string(lineCount) + " lines");
+}
+
+void joinSelectedLines()
+{
+    SelectedLines selected;
+    if (!getSelectedLines(selected, false))
+        return;
+    if (selected.lines.size() < 2)
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    EditorStringView text = EditorStringView(selected.text).substr(selected.start, selected.end - selected.start);
+    std::vector<Token> tokens = lexText(text);
+
+    // Line breaks between tokens become a space, or nothing inside parentheses and before a
+    // comma. Breaks inside literals and block comments stay, and so do the ones ending line
+    // comments.
+    EditorString joined;
+    joined.reserve(text.size());
+    size_t copied = 0;
+    for (size_t i = 0; i + 1 < tokens.size(); i++)
+    {
+        size_t gapStart = tokens[i].offset + tokens[i].length;
+        size_t gapEnd = tokens[i + 1].offset;
+        if (text.substr(gapStart, gapEnd - gapStart).find_first_of(EDT_TX("\r\n")) == EditorStringView::npos
+            || (tokens[i].type == TokenType::Comment && text[tokens[i].offset] == EDT_TX('-')))
+            continue;
+
+        joined.append(text.substr(copied, gapStart - copied));
+        if (!isSymbol(text, tokens[i], EDT_TX('(')) && !isSymbol(text, tokens[i + 1], EDT_TX(')')) && !isSymbol(text, tokens[i + 1], EDT_TX(',')))
+            joined += EDT_TX(' ');
+        copied = gapEnd;
+    }
+    joined.append(text.substr(copied));
+
+    replaceSelectedLines(selected, joined, std::to_string(selected.lines.size()) + " lines joined");
+}
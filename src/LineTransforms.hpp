@@ -0,0 +1,26 @@
+#pragma once
+
+// Commands rewriting the lines the selection touches, or all lines without a selection, with a
+// single replacement, so they're undone in one step.
+
+// Asks for ordinal or locale order, either one optionally ignoring case, and sorts. Equal lines
+// keep their order.
+void sortLines();
+// Keeps the first of equal lines.
+void removeDuplicateLines();
+void reverseLines();
+void shuffleLines();
+// Prefixes the lines with their numbers, aligned to the right.
+void numberLines();
+// Removes the -- starting every line that isn't blank, or if not all of them have one, adds one
+// at the smallest indentation. Without a selection it applies to the caret's line.
+void toggleLineComment();
+// Wraps the selection in /* */, or unwraps it if it's already a comment.
+void toggleBlockComment();
+// Asks for a line width or a number of items per line and breaks the comma-separated list on the
+// selected lines accordingly. Only commas outside literals and comments and at the outermost
+// parenthesis level of the list break lines; continuation lines get the first line's
+// indentation and one level more.
+void splitList();
+// Joins the selected lines into one, keeping what line comments and multi-line literals need.
+void joinSelectedLines();
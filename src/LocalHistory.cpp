@@ -0,0 +1,587 @@
+#include "pch.h"
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "BinaryIo.hpp"
+#include "BlobStore.hpp"
+#include "EditorUtils.hpp"
+#include "FileUtils.hpp"
+#include "Hash.hpp"
+#include "LogWindow.hpp"
+#include "Ui.hpp"
+#include "LocalHistory.hpp"
+
+constexpr auto CHUNKS_FILE_NAME = L"history-chunks.bin";
+constexpr auto SNAPSHOTS_FILE_NAME = L"history-snapshots.bin";
+constexpr char CHUNKS_MAGIC[8] = { 'P', 'S', 'D', 'E', 'C', 'H', 'K', '1' };
+constexpr char SNAPSHOTS_MAGIC[8] = { 'P', 'S', 'D', 'E', 'H', 'I', 'S', '1' };
+constexpr UINT SNAPSHOT_INTERVAL = 60 * 1000;
+// FastCDC sizes: a stricter boundary test before the average size and a looser one after it
+// keep most chunks close to the average
+constexpr size_t MIN_CHUNK_SIZE = 2 * 1024;
+constexpr size_t AVERAGE_CHUNK_SIZE = 8 * 1024;
+constexpr size_t MAX_CHUNK_SIZE = 64 * 1024;
+constexpr int STRICT_BOUNDARY_BITS = 15;
+constexpr int LOOSE_BOUNDARY_BITS = 11;
+// Past this many edits the rest of a diff is shown as a single change
+constexpr int MAX_DIFF_EDITS = 2000;
+constexpr size_t HISTORY_LOG_MAX_LINES = 10000;
+constexpr size_t HISTORY_LOG_MAX_BYTES = 1024 * 1024;
+constexpr size_t DIFF_LOG_MAX_LINES = 200000;
+constexpr size_t DIFF_LOG_MAX_BYTES = 32 * 1024 * 1024;
+
+const std::vector<std::wstring> SNAPSHOT_ACTION_NAMES = { L"Compare with current text", L"Restore" };
+
+struct Snapshot
+{
+    // FILETIME, in UTC
+    uint64_t time;
+    std::string key;
+    uint64_t textHash;
+    uint32_t textLength;
+    uint32_t lineCount;
+    // Offsets of the chunk records in the chunks file, in text order
+    std::vector<uint64_t> chunks;
+};
+
+struct HistoryStore
+{
+    bool loaded = false;
+    std::vector<Snapshot> snapshots;
+    // Index of the last snapshot of each key
+    std::unordered_map<std::string, size_t> lastSnapshots;
+    // End of the last whole record, where the next one is written
+    uint64_t snapshotsEnd = 0;
+    // File size when last read or written; another IDE instance adding snapshots changes it
+    uint64_t snapshotsFileSize = 0;
+};
+
+BlobStore historyChunks(CHUNKS_FILE_NAME, std::string_view(CHUNKS_MAGIC, sizeof(CHUNKS_MAGIC)));
+HistoryStore historyStore;
+UINT_PTR snapshotTimer = 0;
+
+// What the history and diff windows show
+HWND historyEditor = NULL;
+std::string historyKey;
+std::vector<Snapshot> listedSnapshots;
+std::vector<int> diffLineTargets;
+
+void appendSnapshot(std::string& output, const Snapshot& snapshot)
+{
+    appendUint64(output, snapshot.time);
+    appendBytes(output, snapshot.key);
+    appendUint64(output, snapshot.textHash);
+    appendUint32(output, snapshot.textLength);
+    appendUint32(output, snapshot.lineCount);
+    appendUint32(output, static_cast<uint32_t>(snapshot.chunks.size()));
+    for (uint64_t offset : snapshot.chunks)
+        appendUint64(output, offset);
+}
+
+void loadSnapshots()
+{
+    std::wstring fileName = getPluginDataDirectory() + SNAPSHOTS_FILE_NAME;
+    historyStore.snapshotsFileSize = getFileSize(fileName);
+
+    std::string contents;
+    if (!readFile(fileName, contents))
+        return;
+    ByteReader reader(contents);
+    if (reader.take(sizeof(SNAPSHOTS_MAGIC)) != std::string_view(SNAPSHOTS_MAGIC, sizeof(SNAPSHOTS_MAGIC)))
+        return;
+
+    historyStore.snapshotsEnd = sizeof(SNAPSHOTS_MAGIC);
+    while (!reader.atEnd())
+    {
+        Snapshot snapshot;
+        snapshot.time = reader.readUint64();
+        snapshot.key = reader.readBytes();
+        snapshot.textHash = reader.readUint64();
+        snapshot.textLength = reader.readUint32();
+        snapshot.lineCount = reader.readUint32();
+        uint32_t chunkCount = reader.readUint32();
+        if (reader.failed() || chunkCount > reader.remaining() / 8)
+            break;
+        snapshot.chunks.resize(chunkCount);
+        for (auto& offset : snapshot.chunks)
+            offset = reader.readUint64();
+
+        // Chunks are written before the snapshot using them, so they can only be missing if the
+        // chunks file was lost
+        if (std::any_of(snapshot.chunks.begin(), snapshot.chunks.end(), [](uint64_t offset) { return offset >= historyChunks.storedEnd(); }))
+            break;
+
+        historyStore.snapshotsEnd = contents.size() - reader.remaining();
+        historyStore.lastSnapshots[snapshot.key] = historyStore.snapshots.size();
+        historyStore.snapshots.push_back(std::move(snapshot));
+    }
+}
+
+void loadHistoryStore()
+{
+    historyStore = HistoryStore();
+    historyStore.loaded = true;
+    historyChunks.load();
+    loadSnapshots();
+}
+
+bool isHistoryStoreCurrent()
+{
+    return historyStore.loaded && getFileSize(getPluginDataDirectory() + SNAPSHOTS_FILE_NAME) == historyStore.snapshotsFileSize;
+}
+
+const std::array<uint64_t, 256>& getGearTable()
+{
+    static const std::array<uint64_t, 256> table = [] {
+        std::array<uint64_t, 256> values;
+        for (size_t i = 0; i < values.size(); i++)
+            values[i] = mixHash(i + 1);
+        return values;
+    }();
+    return table;
+}
+
+// FastCDC: a gear hash, which depends on the last 64 bytes only, ends the chunk where its top
+// bits are all zero. Boundaries therefore move along with the text around them, and an insertion
+// changes no more than the chunks it touches.
+size_t findChunkLength(std::string_view text)
+{
+    if (text.size() <= MIN_CHUNK_SIZE)
+        return text.size();
+
+    auto& gear = getGearTable();
+    size_t end = std::min(text.size(), MAX_CHUNK_SIZE);
+    size_t averageEnd = std::min(end, AVERAGE_CHUNK_SIZE);
+    uint64_t hash = 0;
+    size_t i = MIN_CHUNK_SIZE;
+    for (; i < averageEnd; i++)
+    {
+        hash = (hash << 1) + gear[static_cast<unsigned char>(text[i])];
+        if (hash >> (64 - STRICT_BOUNDARY_BITS) == 0)
+            return i + 1;
+    }
+    for (; i < end; i++)
+    {
+        hash = (hash << 1) + gear[static_cast<unsigned char>(text[i])];
+        if (hash >> (64 - LOOSE_BOUNDARY_BITS) == 0)
+            return i + 1;
+    }
+    return end;
+}
+
+bool loadSnapshotText(const Snapshot& snapshot, std::string& text)
+{
+    text.clear();
+    text.reserve(snapshot.textLength);
+    if (!historyChunks.read(snapshot.chunks, text))
+        return false;
+    return text.size() == snapshot.textLength && hashBytes(text.data(), text.size()) == snapshot.textHash;
+}
+
+void recordSnapshot(const std::string& key, std::string_view text)
+{
+    if (!isHistoryStoreCurrent())
+        loadHistoryStore();
+
+    uint64_t textHash = hashBytes(text.data(), text.size());
+    auto last = historyStore.lastSnapshots.find(key);
+    if (last != historyStore.lastSnapshots.end() && historyStore.snapshots[last->second].textHash == textHash)
+        return;
+
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    Snapshot snapshot;
+    snapshot.time = static_cast<uint64_t>(now.dwHighDateTime) << 32 | now.dwLowDateTime;
+    snapshot.key = key;
+    snapshot.textHash = textHash;
+    snapshot.textLength = static_cast<uint32_t>(text.size());
+    snapshot.lineCount = static_cast<uint32_t>(std::count(text.begin(), text.end(), '\n') + 1);
+
+    for (size_t position = 0; position < text.size();)
+    {
+        std::string_view chunk = text.substr(position, findChunkLength(text.substr(position)));
+        position += chunk.size();
+        snapshot.chunks.push_back(historyChunks.add(chunk));
+    }
+
+    std::string record;
+    if (historyStore.snapshotsEnd == 0)
+        record.assign(SNAPSHOTS_MAGIC, sizeof(SNAPSHOTS_MAGIC));
+    appendSnapshot(record, snapshot);
+
+    // The snapshot is written after its chunks, so a failure in between leaves only unused chunks
+    OutputFile file;
+    bool written = historyChunks.flush() && file.openAt(getPluginDataDirectory() + SNAPSHOTS_FILE_NAME, historyStore.snapshotsEnd)
+        && file.write(record);
+    written = file.close() && written;
+    if (!written)
+    {
+        historyStore.loaded = false;
+        return;
+    }
+
+    historyStore.snapshotsEnd += record.size();
+    historyStore.snapshotsFileSize = historyStore.snapshotsEnd;
+    historyStore.lastSnapshots[key] = historyStore.snapshots.size();
+    historyStore.snapshots.push_back(std::move(snapshot));
+}
+
+// History is kept under the file name, or the database object for windows not saved to a file.
+// Returns an empty key for windows that have neither.
+std::string getWindowKey()
+{
+    const char* fileName = IDE_Filename();
+    if (fileName != NULL && *fileName != '\0')
+        return std::string("File ") + fileName;
+
+    const char* objectType = NULL;
+    const char* objectOwner = NULL;
+    const char* objectName = NULL;
+    const char* subObject = NULL;
+    if (!IDE_GetWindowObject(&objectType, &objectOwner, &objectName, &subObject) || objectName == NULL || *objectName == '\0')
+        return "";
+    return std::string(objectType != NULL ? objectType : "") + " " + (objectOwner != NULL ? objectOwner : "") + "." + objectName;
+}
+
+void CALLBACK snapshotTimerProc(HWND, UINT, UINT_PTR, DWORD)
+{
+    int windowCount = IDE_GetWindowCount();
+    for (int i = 0; i < windowCount; i++)
+    {
+        if (!IDE_SelectWindow(i) || !IDE_WindowHasEditor(false) || !IDE_WindowIsModified())
+            continue;
+        std::string key = getWindowKey();
+        const char* text = IDE_GetText();
+        if (!key.empty() && text != NULL)
+            recordSnapshot(key, text);
+    }
+    IDE_SelectWindow(0);
+}
+
+void startLocalHistory()
+{
+    if (snapshotTimer == 0)
+        snapshotTimer = SetTimer(NULL, 0, SNAPSHOT_INTERVAL, snapshotTimerProc);
+}
+
+void stopLocalHistory()
+{
+    if (snapshotTimer != 0)
+    {
+        KillTimer(NULL, snapshotTimer);
+        snapshotTimer = 0;
+    }
+    historyChunks.close();
+}
+
+// The history window is modeless, so the editor it lists may have been closed since
+bool activateHistoryEditor()
+{
+    bool activated = false;
+    int windowCount = IDE_GetWindowCount();
+    for (int i = 0; i < windowCount && !activated; i++)
+    {
+        if (IDE_SelectWindow(i) && IDE_WindowHasEditor(false) && IDE_GetEditorHandle() == historyEditor)
+            activated = IDE_ActivateWindow(i);
+    }
+    IDE_SelectWindow(0);
+    return activated;
+}
+
+// Splits at CR LF, CR or LF like splitLines
+std::vector<std::string_view> splitTextLines(std::string_view text)
+{
+    std::vector<std::string_view> lines;
+    size_t lineStart = 0;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] != '\r' && text[i] != '\n')
+            continue;
+        lines.push_back(text.substr(lineStart, i - lineStart));
+        if (text[i] == '\r' && i + 1 < text.size() && text[i + 1] == '\n')
+            i++;
+        lineStart = i + 1;
+    }
+    lines.push_back(text.substr(lineStart));
+    return lines;
+}
+
+struct DiffHunk
+{
+    size_t oldStart;
+    size_t oldCount;
+    size_t newStart;
+    size_t newCount;
+};
+
+// Myers' O(ND) diff of the lines between the common prefix and suffix, comparing line hashes
+// first. Texts differing in more than MAX_DIFF_EDITS lines get the rest as a single change.
+std::vector<DiffHunk> diffLines(const std::vector<std::string_view>& oldLines, const std::vector<std::string_view>& newLines)
+{
+    size_t prefix = 0;
+    while (prefix < oldLines.size() && prefix < newLines.size() && oldLines[prefix] == newLines[prefix])
+        prefix++;
+    size_t suffix = 0;
+    while (suffix < oldLines.size() - prefix && suffix < newLines.size() - prefix
+        && oldLines[oldLines.size() - 1 - suffix] == newLines[newLines.size() - 1 - suffix])
+        suffix++;
+
+    int oldCount = static_cast<int>(oldLines.size() - prefix - suffix);
+    int newCount = static_cast<int>(newLines.size() - prefix - suffix);
+    std::vector<DiffHunk> hunks;
+    if (oldCount == 0 && newCount == 0)
+        return hunks;
+
+    std::vector<uint64_t> oldHashes(oldCount);
+    std::vector<uint64_t> newHashes(newCount);
+    for (int i = 0; i < oldCount; i++)
+        oldHashes[i] = hashBytes(oldLines[prefix + i].data(), oldLines[prefix + i].size());
+    for (int i = 0; i < newCount; i++)
+        newHashes[i] = hashBytes(newLines[prefix + i].data(), newLines[prefix + i].size());
+    auto linesEqual = [&](int x, int y) {
+        return oldHashes[x] == newHashes[y] && oldLines[prefix + x] == newLines[prefix + y];
+    };
+
+    // furthest[k] is the furthest old line reached on diagonal k = x - y; trace keeps it for
+    // every number of edits to walk the path back
+    int maxEdits = std::min(oldCount + newCount, MAX_DIFF_EDITS);
+    int diagonalOffset = maxEdits + 1;
+    std::vector<int> furthest(2 * maxEdits + 3, 0);
+    std::vector<std::vector<int>> trace;
+    bool found = false;
+    for (int edits = 0; edits <= maxEdits && !found; edits++)
+    {
+        for (int k = -edits; k <= edits; k += 2)
+        {
+            int x = k == -edits || (k != edits && furthest[diagonalOffset + k - 1] < furthest[diagonalOffset + k + 1])
+                ? furthest[diagonalOffset + k + 1] : furthest[diagonalOffset + k - 1] + 1;
+            int y = x - k;
+            while (x < oldCount && y < newCount && linesEqual(x, y))
+            {
+                x++;
+                y++;
+            }
+            furthest[diagonalOffset + k] = x;
+            if (x >= oldCount && y >= newCount)
+            {
+                found = true;
+                break;
+            }
+        }
+        trace.emplace_back(furthest.begin() + diagonalOffset - edits, furthest.begin() + diagonalOffset + edits + 1);
+    }
+    if (!found)
+    {
+        hunks.push_back({ prefix, static_cast<size_t>(oldCount), prefix, static_cast<size_t>(newCount) });
+        return hunks;
+    }
+
+    std::vector<bool> removed(oldCount);
+    std::vector<bool> added(newCount);
+    int x = oldCount;
+    int y = newCount;
+    for (int edits = static_cast<int>(trace.size()) - 1; edits > 0; edits--)
+    {
+        // The previous step's band holds diagonals -(edits - 1) to edits - 1
+        const std::vector<int>& previous = trace[edits - 1];
+        int k = x - y;
+        bool down = k == -edits || (k != edits && previous[k - 1 + edits - 1] < previous[k + 1 + edits - 1]);
+        int previousK = down ? k + 1 : k - 1;
+        int previousX = previous[previousK + edits - 1];
+        int previousY = previousX - previousK;
+        if (down)
+            added[previousY] = true;
+        else
+            removed[previousX] = true;
+        x = previousX;
+        y = previousY;
+    }
+
+    x = 0;
+    y = 0;
+    while (x < oldCount || y < newCount)
+    {
+        if (x < oldCount && y < newCount && !removed[x] && !added[y])
+        {
+            x++;
+            y++;
+            continue;
+        }
+
+        DiffHunk hunk = { prefix + x, 0, prefix + y, 0 };
+        for (; x < oldCount && removed[x]; x++)
+            hunk.oldCount++;
+        for (; y < newCount && added[y]; y++)
+            hunk.newCount++;
+        hunks.push_back(hunk);
+    }
+    return hunks;
+}
+
+void goToDiffLine(size_t line)
+{
+    if (line >= diffLineTargets.size() || !activateHistoryEditor())
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    int start = SendMessage(historyEditor, EM_LINEINDEX, diffLineTargets[line], 0);
+    if (start < 0)
+        start = SendMessage(historyEditor, WM_GETTEXTLENGTH, 0, 0);
+    SendMessage(historyEditor, EM_SETSEL, start, start);
+    SendMessage(historyEditor, EM_SCROLLCARET, 0, 0);
+}
+
+void showSnapshotDifferences(const std::string& snapshotText)
+{
+    std::string currentText = toAnsiString(getEditorText(historyEditor));
+    std::vector<std::string_view> oldLines = splitTextLines(snapshotText);
+    std::vector<std::string_view> newLines = splitTextLines(currentText);
+    std::vector<DiffHunk> hunks = diffLines(oldLines, newLines);
+
+    std::string output;
+    diffLineTargets.clear();
+    size_t removedCount = 0;
+    size_t addedCount = 0;
+    for (auto& hunk : hunks)
+    {
+        output += "@@ -" + std::to_string(hunk.oldStart + 1) + "," + std::to_string(hunk.oldCount)
+            + " +" + std::to_string(hunk.newStart + 1) + "," + std::to_string(hunk.newCount) + " @@\n";
+        diffLineTargets.push_back(static_cast<int>(hunk.newStart));
+        for (size_t i = 0; i < hunk.oldCount; i++)
+        {
+            output += "-";
+            output += oldLines[hunk.oldStart + i];
+            output += "\n";
+            diffLineTargets.push_back(static_cast<int>(hunk.newStart));
+        }
+        for (size_t i = 0; i < hunk.newCount; i++)
+        {
+            output += "+";
+            output += newLines[hunk.newStart + i];
+            output += "\n";
+            diffLineTargets.push_back(static_cast<int>(hunk.newStart + i));
+        }
+        removedCount += hunk.oldCount;
+        addedCount += hunk.newCount;
+    }
+
+    static LogWindow diffWindow(L"Local history differences", DIFF_LOG_MAX_LINES, DIFF_LOG_MAX_BYTES);
+    diffWindow.show();
+    diffWindow.setLineActivated(goToDiffLine);
+    diffWindow.append(output);
+    diffWindow.setStatus(hunks.empty() ? L"The snapshot is the same as the current text"
+        : std::to_wstring(hunks.size()) + L" changes since the snapshot, " + std::to_wstring(removedCount) + L" lines removed, "
+            + std::to_wstring(addedCount) + L" added");
+}
+
+void restoreSnapshot(const std::string& snapshotText)
+{
+    if (IDE_GetReadOnly())
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    // The text being replaced goes into the history too
+    recordSnapshot(historyKey, toAnsiString(getEditorText(historyEditor)));
+
+    EditorString replacement = toEditorString(snapshotText);
+    int firstVisibleLine = SendMessage(historyEditor, EM_GETFIRSTVISIBLELINE, 0, 0);
+    SendMessage(historyEditor, WM_SETREDRAW, FALSE, 0);
+    SendMessage(historyEditor, EM_SETSEL, 0, -1);
+    SendMessage(historyEditor, EM_REPLACESEL, TRUE, reinterpret_cast<LPARAM>(replacement.c_str()));
+    SendMessage(historyEditor, EM_SETSEL, 0, 0);
+    SendMessage(historyEditor, EM_LINESCROLL, 0, firstVisibleLine - SendMessage(historyEditor, EM_GETFIRSTVISIBLELINE, 0, 0));
+    SendMessage(historyEditor, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(historyEditor, NULL, TRUE);
+    IDE_SetStatusMessage("Snapshot restored");
+}
+
+void pickSnapshotAction(size_t line)
+{
+    if (line >= listedSnapshots.size())
+        return;
+
+    POINT cursorPosition;
+    GetCursorPos(&cursorPosition);
+    int action = showPopupList(IDE_GetWindowHandle(), cursorPosition, SNAPSHOT_ACTION_NAMES);
+    if (action < 0)
+        return;
+
+    std::string snapshotText;
+    if (!loadSnapshotText(listedSnapshots[line], snapshotText))
+    {
+        showMessage(L"The snapshot couldn't be read from the history files.", MB_OK | MB_ICONWARNING);
+        return;
+    }
+    if (!activateHistoryEditor())
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    if (action == 0)
+        showSnapshotDifferences(snapshotText);
+    else
+        restoreSnapshot(snapshotText);
+}
+
+std::string formatSnapshot(const Snapshot& snapshot)
+{
+    FILETIME time = { static_cast<DWORD>(snapshot.time), static_cast<DWORD>(snapshot.time >> 32) };
+    FILETIME localTime;
+    SYSTEMTIME fields = {};
+    FileTimeToLocalFileTime(&time, &localTime);
+    FileTimeToSystemTime(&localTime, &fields);
+
+    std::ostringstream text;
+    text << std::setfill('0') << std::setw(4) << fields.wYear << "-" << std::setw(2) << fields.wMonth << "-" << std::setw(2) << fields.wDay
+        << " " << std::setw(2) << fields.wHour << ":" << std::setw(2) << fields.wMinute << ":" << std::setw(2) << fields.wSecond
+        << std::setfill(' ') << std::setw(10) << snapshot.lineCount << " lines" << std::setw(12) << snapshot.textLength << " bytes";
+    return text.str();
+}
+
+void showLocalHistory()
+{
+    if (!IDE_WindowHasEditor(false))
+        return;
+
+    std::string key = getWindowKey();
+    if (key.empty())
+    {
+        showMessage(L"The window has neither a file nor a database object to keep its history under.", MB_OK | MB_ICONWARNING);
+        return;
+    }
+    const char* text = IDE_GetText();
+    if (text != NULL)
+        recordSnapshot(key, text);
+    if (!isHistoryStoreCurrent())
+        loadHistoryStore();
+
+    historyEditor = IDE_GetEditorHandle();
+    historyKey = key;
+    listedSnapshots.clear();
+    for (size_t i = historyStore.snapshots.size(); i-- > 0;)
+    {
+        if (historyStore.snapshots[i].key == key)
+            listedSnapshots.push_back(historyStore.snapshots[i]);
+    }
+
+    std::string lines;
+    for (auto& snapshot : listedSnapshots)
+        lines += formatSnapshot(snapshot) + "\n";
+
+    static LogWindow historyWindow(L"Local history", HISTORY_LOG_MAX_LINES, HISTORY_LOG_MAX_BYTES);
+    historyWindow.show();
+    historyWindow.setLineActivated(pickSnapshotAction);
+    historyWindow.append(lines);
+    historyWindow.setStatus(toEditorString(key) + L", " + std::to_wstring(listedSnapshots.size()) + L" snapshots, newest first");
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "pch.h"
+
+// Snapshots of the modified windows taken every minute, kept in the plug-in's data directory.
+// Texts are cut into chunks at content-defined boundaries, so an edit changes only the chunks
+// around it, and each distinct chunk is stored once, compressed. A snapshot is then a list of
+// chunk references, costing a few bytes per unchanged chunk. Windows are told apart by their
+// file name or, for database objects, by type, owner and name.
+
+void startLocalHistory();
+void stopLocalHistory();
+// Takes a snapshot of the current window and lists its history. A listed snapshot can be
+// compared with the current text or restored as an edit that can be undone.
+void showLocalHistory();
@@ -0,0 +1,262 @@
+#include "pch.h"
+#include <algorithm>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "LogWindow.hpp"
+
+constexpr auto LOG_WINDOW_CLASS = L"PsdEditorEnhancementsLog";
+constexpr auto LOG_FONT_NAME = L"Consolas";
+constexpr auto LOG_FONT_HEIGHT = -13;
+constexpr auto LOG_TEXT_MARGIN = 4;
+
+LogBuffer::LogBuffer(size_t maxLines, size_t maxBytes)
+    : lines(std::max<size_t>(maxLines, 1)), maxBytes(maxBytes)
+{
+}
+
+void LogBuffer::append(std::string_view text)
+{
+    while (!text.empty())
+    {
+        size_t lineEnd = text.find('\n');
+        std::string_view lineText = text.substr(0, lineEnd);
+        if (!lineText.empty() && lineText.back() == '\r')
+            lineText.remove_suffix(1);
+
+        if (!lastLineOpen)
+            startLine();
+        appendToLastLine(lineText);
+
+        if (lineEnd == std::string_view::npos)
+            break;
+        lastLineOpen = false;
+        text.remove_prefix(lineEnd + 1);
+    }
+}
+
+void LogBuffer::clear()
+{
+    while (count > 0)
+        dropFirstLine();
+    first = 0;
+    dropped = 0;
+    longestLine = 0;
+    lastLineOpen = false;
+}
+
+void LogBuffer::appendToLastLine(std::string_view text)
+{
+    auto& line = lines[(first + count - 1) % lines.size()];
+    // A single line longer than the whole budget keeps only its beginning
+    text = text.substr(0, maxBytes - std::min(maxBytes, line.size()));
+    line.append(text);
+    bytes += text.size();
+    longestLine = std::max(longestLine, line.size());
+
+    while (bytes > maxBytes && count > 1)
+    {
+        dropFirstLine();
+        dropped++;
+    }
+}
+
+void LogBuffer::startLine()
+{
+    if (count == lines.size())
+    {
+        dropFirstLine();
+        dropped++;
+    }
+
+    count++;
+    lastLineOpen = true;
+}
+
+void LogBuffer::dropFirstLine()
+{
+    bytes -= lines[first].size();
+    // Release the memory rather than keep the capacity of what might have been a huge line
+    std::string().swap(lines[first]);
+    first = (first + 1) % lines.size();
+    count--;
+}
+
+LogWindow::LogWindow(const wchar_t* title, size_t maxLines, size_t maxBytes)
+    : title(title), buffer(maxLines, maxBytes)
+{
+}
+
+LogWindow::~LogWindow()
+{
+    if (window != NULL)
+        DestroyWindow(window);
+    if (font != NULL)
+        DeleteObject(font);
+}
+
+void LogWindow::show()
+{
+    buffer.clear();
+    shownDroppedLineCount = 0;
+
+    if (window != NULL)
+    {
+        SetWindowText(window, title.c_str());
+        updateList();
+        ShowWindow(window, SW_SHOWNORMAL);
+        SetForegroundWindow(window);
+        return;
+    }
+
+    static bool classRegistered = false;
+    if (!classRegistered)
+    {
+        WNDCLASSEX windowClass = {};
+        windowClass.cbSize = sizeof(windowClass);
+        windowClass.lpfnWndProc = windowProc;
+        windowClass.hInstance = GetModuleHandle(NULL);
+        windowClass.hCursor = LoadCursor(NULL, IDC_ARROW);
+        windowClass.hbrBackground = reinterpret_cast<HBRUSH>(COLOR_WINDOW + 1);
+        windowClass.lpszClassName = LOG_WINDOW_CLASS;
+        classRegistered = RegisterClassEx(&windowClass) != 0;
+    }
+
+    if (font == NULL)
+    {
+        font = CreateFont(LOG_FONT_HEIGHT, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
+            CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, FIXED_PITCH | FF_MODERN, LOG_FONT_NAME);
+    }
+
+    CreateWindowEx(WS_EX_TOOLWINDOW, LOG_WINDOW_CLASS, title.c_str(), WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+        CW_USEDEFAULT, CW_USEDEFAULT, 800, 400, IDE_GetWindowHandle(), NULL, GetModuleHandle(NULL), this);
+}
+
+void LogWindow::append(std::string_view text)
+{
+    buffer.append(text);
+    if (window != NULL)
+        updateList();
+}
+
+void LogWindow::setStatus(const std::wstring& status)
+{
+    if (window != NULL)
+        SetWindowText(window, (title + L" - " + status).c_str());
+}
+
+LRESULT CALLBACK LogWindow::windowProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    if (message == WM_NCCREATE)
+    {
+        auto logWindow = static_cast<LogWindow*>(reinterpret_cast<CREATESTRUCT*>(lParam)->lpCreateParams);
+        logWindow->window = window;
+        SetWindowLongPtr(window, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(logWindow));
+    }
+
+    auto logWindow = reinterpret_cast<LogWindow*>(GetWindowLongPtr(window, GWLP_USERDATA));
+    if (logWindow == NULL)
+        return DefWindowProc(window, message, wParam, lParam);
+
+    return logWindow->handleMessage(message, wParam, lParam);
+}
+
+LRESULT LogWindow::handleMessage(UINT message, WPARAM wParam, LPARAM lParam)
+{
+    switch (message)
+    {
+    case WM_CREATE:
+    {
+        // Owner-data list: it only keeps a count and asks for each visible line when drawing
+        list = CreateWindowEx(0, L"LISTBOX", L"", WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_HSCROLL | LBS_NODATA
+            | LBS_OWNERDRAWFIXED | LBS_NOINTEGRALHEIGHT | LBS_NOTIFY | LBS_WANTKEYBOARDINPUT, 0, 0, 0, 0, window, NULL, GetModuleHandle(NULL), NULL);
+
+        HDC dc = GetDC(list);
+        HGDIOBJ previousFont = SelectObject(dc, font);
+        TEXTMETRIC metrics;
+        GetTextMetrics(dc, &metrics);
+        SelectObject(dc, previousFont);
+        ReleaseDC(list, dc);
+        SendMessage(list, LB_SETITEMHEIGHT, 0, metrics.tmHeight);
+        charWidth = metrics.tmAveCharWidth;
+
+        updateList();
+        return 0;
+    }
+    case WM_SIZE:
+        MoveWindow(list, 0, 0, LOWORD(lParam), HIWORD(lParam), TRUE);
+        return 0;
+    case WM_SETFOCUS:
+        SetFocus(list);
+        return 0;
+    case WM_DRAWITEM:
+        drawLine(*reinterpret_cast<const DRAWITEMSTRUCT*>(lParam));
+        return TRUE;
+    case WM_COMMAND:
+        if (HIWORD(wParam) == LBN_DBLCLK)
+            activateSelectedLine();
+        return 0;
+    case WM_VKEYTOITEM:
+        if (LOWORD(wParam) != VK_RETURN)
+            return -1;
+        activateSelectedLine();
+        return -2;
+    case WM_DESTROY:
+        SetWindowLongPtr(window, GWLP_USERDATA, 0);
+        window = NULL;
+        list = NULL;
+        return 0;
+    }
+
+    return DefWindowProc(window, message, wParam, lParam);
+}
+
+void LogWindow::drawLine(const DRAWITEMSTRUCT& item)
+{
+    if (item.itemID == static_cast<UINT>(-1) || item.itemID >= buffer.lineCount())
+        return;
+
+    bool selected = (item.itemState & ODS_SELECTED) != 0;
+    FillRect(item.hDC, &item.rcItem, GetSysColorBrush(selected ? COLOR_HIGHLIGHT : COLOR_WINDOW));
+
+    EditorString text = toEditorString(buffer.line(item.itemID));
+    HGDIOBJ previousFont = SelectObject(item.hDC, font);
+    SetBkMode(item.hDC, TRANSPARENT);
+    SetTextColor(item.hDC, GetSysColor(selected ? COLOR_HIGHLIGHTTEXT : COLOR_WINDOWTEXT));
+    TextOut(item.hDC, item.rcItem.left + LOG_TEXT_MARGIN, item.rcItem.top, text.c_str(), static_cast<int>(text.size()));
+    SelectObject(item.hDC, previousFont);
+}
+
+void LogWindow::updateList()
+{
+    if (list == NULL)
+        return;
+
+    int shownCount = static_cast<int>(SendMessage(list, LB_GETCOUNT, 0, 0));
+    int topIndex = static_cast<int>(SendMessage(list, LB_GETTOPINDEX, 0, 0));
+    RECT listRect;
+    GetClientRect(list, &listRect);
+    int itemHeight = std::max(1, static_cast<int>(SendMessage(list, LB_GETITEMHEIGHT, 0, 0)));
+    int visibleCount = (listRect.bottom - listRect.top) / itemHeight;
+    bool followsEnd = topIndex + visibleCount >= shownCount;
+
+    // Dropped lines shift every index, so a scrolled-back view is moved to keep showing the same lines
+    int shift = static_cast<int>(buffer.droppedLineCount() - shownDroppedLineCount);
+    shownDroppedLineCount = buffer.droppedLineCount();
+
+    int count = static_cast<int>(buffer.lineCount());
+    SendMessage(list, LB_SETCOUNT, count, 0);
+    SendMessage(list, LB_SETTOPINDEX, followsEnd ? std::max(0, count - visibleCount) : std::max(0, topIndex - shift), 0);
+
+    SendMessage(list, LB_SETHORIZONTALEXTENT, buffer.longestLineLength() * charWidth + 2 * LOG_TEXT_MARGIN, 0);
+
+    // Keep the window responsive while a long job keeps the message loop busy
+    UpdateWindow(list);
+}
+
+void LogWindow::activateSelectedLine()
+{
+    int selected = static_cast<int>(SendMessage(list, LB_GETCURSEL, 0, 0));
+    if (selected < 0 || !lineActivated)
+        return;
+    lineActivated(buffer.droppedLineCount() + selected);
+}
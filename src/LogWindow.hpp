@@ -0,0 +1,77 @@
+#pragma once
+
+#include "pch.h"
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Fixed-capacity ring of text lines. Once either limit is reached the oldest lines are dropped,
+// so output of a runaway loop costs bounded memory however long it runs.
+class LogBuffer
+{
+public:
+    LogBuffer(size_t maxLines, size_t maxBytes);
+
+    // Splits text on line breaks; a text not ending with one leaves its last line open for the
+    // next append to continue.
+    void append(std::string_view text);
+    void clear();
+
+    size_t lineCount() const { return count; }
+    const std::string& line(size_t index) const { return lines[(first + index) % lines.size()]; }
+    // Lines dropped to stay within the limits since the last clear
+    size_t droppedLineCount() const { return dropped; }
+    size_t longestLineLength() const { return longestLine; }
+
+private:
+    void appendToLastLine(std::string_view text);
+    void startLine();
+    void dropFirstLine();
+
+    std::vector<std::string> lines;
+    size_t first = 0;
+    size_t count = 0;
+    size_t bytes = 0;
+    size_t maxBytes;
+    size_t dropped = 0;
+    size_t longestLine = 0;
+    bool lastLineOpen = false;
+};
+
+// Modeless tool window listing the lines of a LogBuffer. The list is virtual, so showing a full
+// buffer costs no more than showing a screenful of it.
+class LogWindow
+{
+public:
+    LogWindow(const wchar_t* title, size_t maxLines, size_t maxBytes);
+    ~LogWindow();
+
+    LogWindow(const LogWindow&) = delete;
+    LogWindow& operator=(const LogWindow&) = delete;
+
+    // Creates the window, or brings it to front and clears it if it's already open
+    void show();
+    void append(std::string_view text);
+    void setStatus(const std::wstring& status);
+    // Called with the number of the line, counted from the first appended since show, when it's
+    // double-clicked or Enter is pressed on it
+    void setLineActivated(std::function<void(size_t line)> handler) { lineActivated = std::move(handler); }
+    bool isOpen() const { return window != NULL; }
+
+private:
+    static LRESULT CALLBACK windowProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam);
+    LRESULT handleMessage(UINT message, WPARAM wParam, LPARAM lParam);
+    void drawLine(const DRAWITEMSTRUCT& item);
+    void updateList();
+    void activateSelectedLine();
+
+    std::wstring title;
+    LogBuffer buffer;
+    HWND window = NULL;
+    HWND list = NULL;
+    HFONT font = NULL;
+    int charWidth = 0;
+    size_t shownDroppedLineCount = 0;
+    std::function<void(size_t line)> lineActivated;
+};
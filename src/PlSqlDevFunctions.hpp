@@ -26,10 +26,12 @@ extern "C"
 
     //__declspec(dllexport) void OnBrowserChange();
     //__declspec(dllexport) void OnWindowChange();
-    //__declspec(dllexport) void OnConnectionChange();
+    __declspec(dllexport) void OnConnectionChange();
     //__declspec(dllexport) int OnWindowClose(int WindowType, BOOL Changed);
     //__declspec(dllexport) void OnWindowCreate(int WindowType);
     __declspec(dllexport) void OnWindowCreated(int WindowType);
+    __declspec(dllexport) BOOL BeforeExecuteWindow(int WindowType);
+    __declspec(dllexport) void AfterExecuteWindow(int WindowType, int Result);
     //__declspec(dllexport) void Configure();
 
     //__declspec(dllexport) void OnPopup(char *ObjectType, char *ObjectName);
@@ -40,14 +42,14 @@ extern "C"
     //__declspec(dllexport) char *PlugInSubName();
     //__declspec(dllexport) char *PlugInShortName();
 
-    // __declspec(dllexport) char *RegisterFileSystem();
-    // __declspec(dllexport) char *DirectFileLoad(char *Tag, char *Filename, int WindowType);
-    // __declspec(dllexport) BOOL DirectFileSave(char *Tag, char *Filename, int WindowType);
-    // __declspec(dllexport) char *RegisterExport();
-    // __declspec(dllexport) void ExportInit();
-    // __declspec(dllexport) void ExportFinished();
-    // __declspec(dllexport) void ExportPrepare();
-    // __declspec(dllexport) void ExportData();
+    __declspec(dllexport) const char* RegisterFileSystem();
+    __declspec(dllexport) const char* DirectFileLoad(char* Tag, char* Filename, int WindowType);
+    __declspec(dllexport) BOOL DirectFileSave(char* Tag, char* Filename, int WindowType);
+    __declspec(dllexport) const char* RegisterExport();
+    __declspec(dllexport) BOOL ExportInit();
+    __declspec(dllexport) void ExportFinished();
+    __declspec(dllexport) BOOL ExportPrepare();
+    __declspec(dllexport) BOOL ExportData(char *Value);
 }
 
 // tab type returned by IDE_TabInfo()
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include "PlSqlLexer.hpp"
+
+// SQL and PL/SQL keywords, reserved or not, looked up through a perfect hash built at compile
+// time: every keyword has a slot of its own, so a lookup hashes the word once and compares it
+// with at most one keyword.
+
+constexpr std::string_view PLSQL_KEYWORDS[] = {
+    "ACCESS", "ADD", "ALL", "ALTER", "AND", "ANY", "AS", "ASC", "AT", "AUDIT", "AUTHID",
+    "AUTONOMOUS_TRANSACTION", "BEGIN", "BETWEEN", "BFILE", "BINARY_DOUBLE", "BINARY_FLOAT", "BINARY_INTEGER",
+    "BLOB", "BODY", "BOOLEAN", "BULK", "BY", "BYTE", "CASE", "CHAR", "CHECK", "CLOB", "CLOSE", "CLUSTER",
+    "COLLECT", "COLUMN", "COMMENT", "COMMIT", "COMPRESS", "CONNECT", "CONSTANT", "CONSTRAINT", "CONTINUE",
+    "CREATE", "CROSS", "CURRENT", "CURRENT_USER", "CURSOR", "DATE", "DAY", "DECIMAL", "DECLARE", "DEFAULT",
+    "DEFINER", "DELETE", "DESC", "DETERMINISTIC", "DISTINCT", "DROP", "EACH", "ELSE", "ELSIF", "END", "ESCAPE",
+    "EXCEPTION", "EXCEPTIONS", "EXCEPTION_INIT", "EXCLUSIVE", "EXECUTE", "EXISTS", "EXIT", "FALSE", "FETCH",
+    "FIRST", "FLOAT", "FOR", "FORALL", "FOREIGN", "FROM", "FULL", "FUNCTION", "GOTO", "GRANT", "GROUP",
+    "HAVING", "IDENTIFIED", "IF", "IMMEDIATE", "IN", "INDEX", "INDICES", "INNER", "INSERT", "INTEGER",
+    "INTERSECT", "INTERVAL", "INTO", "IS", "ISOLATION", "JOIN", "KEY", "LAST", "LEFT", "LEVEL", "LIKE",
+    "LIMIT", "LOCK", "LONG", "LOOP", "MATCHED", "MERGE", "MINUS", "MODE", "MODIFY", "MONTH", "NATURAL",
+    "NCHAR", "NCLOB", "NOCOPY", "NOT", "NOWAIT", "NULL", "NULLS", "NUMBER", "NUMERIC", "NVARCHAR2",
+    "OF", "ON", "OPEN", "OPTION", "OR", "ORDER", "OTHERS", "OUT", "OUTER", "OVER", "PACKAGE", "PARTITION",
+    "PIPE", "PIPELINED", "PLS_INTEGER", "PRAGMA", "PRIMARY", "PRIOR", "PROCEDURE", "PUBLIC", "RAISE", "RANGE",
+    "RAW", "READ", "RECORD", "REF", "REFERENCES", "REPLACE", "RESULT_CACHE", "RETURN", "RETURNING", "REVERSE",
+    "REVOKE", "RIGHT", "ROLLBACK", "ROW", "ROWID", "ROWNUM", "ROWS", "ROWTYPE", "SAVEPOINT", "SECOND",
+    "SELECT", "SEQUENCE", "SERIALLY_REUSABLE", "SET", "SHARE", "SIMPLE_INTEGER", "SIZE", "SMALLINT", "START",
+    "SUBTYPE", "SYNONYM", "SYSDATE", "SYSTIMESTAMP", "TABLE", "THEN", "TIME", "TIMESTAMP", "TO", "TRANSACTION",
+    "TRIGGER", "TRUE", "TRUNCATE", "TYPE", "UNION", "UNIQUE", "UPDATE", "USER", "USING", "VALUES", "VARCHAR",
+    "VARCHAR2", "VARRAY", "VIEW", "WHEN", "WHERE", "WHILE", "WITH", "WORK", "YEAR", "ZONE"
+};
+
+constexpr size_t KEYWORD_TABLE_BITS = 11;
+// Picked so that no two keywords share a slot. The static_assert below fails when a change of
+// the list needs another one.
+constexpr uint32_t KEYWORD_HASH_SEED = 0x2a13030a;
+
+constexpr uint32_t hashKeywordChar(uint32_t hash, uint32_t c)
+{
+    return (hash ^ c) * 16777619u;
+}
+
+struct KeywordTable
+{
+    // Index + 1 of the keyword in each slot, 0 for none
+    uint8_t slots[size_t(1) << KEYWORD_TABLE_BITS];
+    size_t maxLength;
+    bool collisionFree;
+};
+
+constexpr KeywordTable buildKeywordTable()
+{
+    KeywordTable table = {};
+    table.collisionFree = true;
+    for (size_t i = 0; i < std::size(PLSQL_KEYWORDS); i++)
+    {
+        uint32_t hash = KEYWORD_HASH_SEED;
+        for (char c : PLSQL_KEYWORDS[i])
+            hash = hashKeywordChar(hash, static_cast<uint32_t>(c));
+        uint8_t& slot = table.slots[hash >> (32 - KEYWORD_TABLE_BITS)];
+        if (slot != 0)
+            table.collisionFree = false;
+        slot = static_cast<uint8_t>(i + 1);
+        table.maxLength = std::max(table.maxLength, PLSQL_KEYWORDS[i].size());
+    }
+    return table;
+}
+
+static_assert(std::size(PLSQL_KEYWORDS) < 256, "Slots hold keyword indexes in a byte");
+constexpr KeywordTable KEYWORD_TABLE = buildKeywordTable();
+static_assert(KEYWORD_TABLE.collisionFree, "Keywords share a slot, KEYWORD_HASH_SEED needs changing");
+
+// Whether the word is a keyword, in any case. Words with other than ASCII characters never are.
+template<typename CharT>
+constexpr bool isPlSqlKeyword(const CharT* word, size_t length)
+{
+    if (length == 0 || length > KEYWORD_TABLE.maxLength)
+        return false;
+
+    uint32_t hash = KEYWORD_HASH_SEED;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (static_cast<uint32_t>(word[i]) >= 0x80)
+            return false;
+        hash = hashKeywordChar(hash, static_cast<uint32_t>(toUpperAsciiChar(word[i])));
+    }
+
+    uint8_t slot = KEYWORD_TABLE.slots[hash >> (32 - KEYWORD_TABLE_BITS)];
+    if (slot == 0 || PLSQL_KEYWORDS[slot - 1].size() != length)
+        return false;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (toUpperAsciiChar(word[i]) != static_cast<CharT>(PLSQL_KEYWORDS[slot - 1][i]))
+            return false;
+    }
+    return true;
+}
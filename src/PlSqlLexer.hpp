@@ -0,0 +1,341 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class TokenType : uint8_t
+{
+    Word,
+    QuotedIdentifier,
+    Number,
+    String,
+    Comment,
+    BindVariable,
+    Symbol,
+};
+
+struct Token
+{
+    TokenType type;
+    uint32_t offset;
+    uint32_t length;
+};
+
+// What the lexer was in the middle of when the text ended. Lets a text be lexed in pieces
+// (chunks of a file, regions of an edited buffer) and resumed exactly where it stopped.
+struct LexerState
+{
+    enum Mode : uint8_t
+    {
+        Code,
+        BlockComment,
+        String,
+        QuoteDelimitedString,
+        QuotedIdentifier,
+    };
+
+    Mode mode = Code;
+    uint32_t quoteDelimiter = 0;
+
+    bool operator==(const LexerState& other) const { return mode == other.mode && quoteDelimiter == other.quoteDelimiter; }
+    bool operator!=(const LexerState& other) const { return !(*this == other); }
+};
+
+// Comment- and string-aware PL/SQL tokenizer working on either the editor's UTF-16 text or
+// ANSI text from the IDE callbacks and files. Whitespace is skipped; comments are returned as
+// tokens so callers can decide whether they matter.
+template<typename CharT>
+class BasicPlSqlLexer
+{
+public:
+    BasicPlSqlLexer(const CharT* text, size_t length, size_t position = 0, LexerState state = LexerState())
+        : text(text), length(length), pos(position), currentState(state)
+    {
+    }
+
+    // Returns false when the end of text is reached. A token cut off by the end of text is
+    // returned up to the end, and state() then tells what it was.
+    bool next(Token& token)
+    {
+        if (currentState.mode != LexerState::Code)
+            return continueToken(token, pos);
+
+        while (pos < length && isWhitespace(text[pos]))
+            pos++;
+
+        if (pos >= length)
+            return false;
+
+        size_t start = pos;
+        CharT c = text[pos];
+
+        if (c == '-' && peek(1) == '-')
+        {
+            while (pos < length && text[pos] != '\r' && text[pos] != '\n')
+                pos++;
+            return makeToken(token, TokenType::Comment, start);
+        }
+
+        if (c == '/' && peek(1) == '*')
+        {
+            pos += 2;
+            currentState.mode = LexerState::BlockComment;
+            return continueToken(token, start);
+        }
+
+        if (c == '\'')
+        {
+            pos++;
+            currentState.mode = LexerState::String;
+            return continueToken(token, start);
+        }
+
+        if (c == '"')
+        {
+            pos++;
+            currentState.mode = LexerState::QuotedIdentifier;
+            return continueToken(token, start);
+        }
+
+        if (isIdentifierStart(c))
+        {
+            // N'...', Q'[...]' and NQ'[...]' literals start like identifiers
+            size_t quotePos = pos;
+            if ((c == 'N' || c == 'n') && peek(1) == '\'')
+            {
+                pos += 2;
+                currentState.mode = LexerState::String;
+                return continueToken(token, start);
+            }
+            if ((c == 'N' || c == 'n') && (peek(1) == 'Q' || peek(1) == 'q'))
+                quotePos++;
+            if ((text[quotePos] == 'Q' || text[quotePos] == 'q') && quotePos + 2 < length && text[quotePos + 1] == '\'')
+            {
+                pos = quotePos + 3;
+                currentState.mode = LexerState::QuoteDelimitedString;
+                currentState.quoteDelimiter = closingQuoteDelimiter(text[quotePos + 2]);
+                return continueToken(token, start);
+            }
+
+            pos++;
+            while (pos < length && isIdentifierPart(text[pos]))
+                pos++;
+            return makeToken(token, TokenType::Word, start);
+        }
+
+        if (isDigit(c) || (c == '.' && isDigit(peek(1))))
+        {
+            while (pos < length && isDigit(text[pos]))
+                pos++;
+            // 1..10 is a range, not a number followed by .10
+            if (pos < length && text[pos] == '.' && peek(1) != '.')
+            {
+                pos++;
+                while (pos < length && isDigit(text[pos]))
+                    pos++;
+            }
+            if (pos < length && (text[pos] == 'e' || text[pos] == 'E'))
+            {
+                size_t exponentPos = pos + 1;
+                if (exponentPos < length && (text[exponentPos] == '+' || text[exponentPos] == '-'))
+                    exponentPos++;
+                if (exponentPos < length && isDigit(text[exponentPos]))
+                {
+                    pos = exponentPos;
+                    while (pos < length && isDigit(text[pos]))
+                        pos++;
+                }
+            }
+            if (pos < length && (text[pos] == 'f' || text[pos] == 'F' || text[pos] == 'd' || text[pos] == 'D'))
+                pos++;
+            return makeToken(token, TokenType::Number, start);
+        }
+
+        if (c == ':' && (isIdentifierStart(peek(1)) || isDigit(peek(1))))
+        {
+            pos++;
+            while (pos < length && isIdentifierPart(text[pos]))
+                pos++;
+            return makeToken(token, TokenType::BindVariable, start);
+        }
+
+        pos += isTwoCharSymbol(c, peek(1)) ? 2 : 1;
+        return makeToken(token, TokenType::Symbol, start);
+    }
+
+    LexerState state() const { return currentState; }
+    size_t position() const { return pos; }
+
+    static bool isWhitespace(CharT c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+    }
+
+    static bool isDigit(CharT c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    static bool isIdentifierStart(CharT c)
+    {
+        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || static_cast<uint32_t>(c) >= 0x80;
+    }
+
+    static bool isIdentifierPart(CharT c)
+    {
+        return isIdentifierStart(c) || isDigit(c) || c == '_' || c == '$' || c == '#';
+    }
+
+private:
+    CharT peek(size_t ahead) const
+    {
+        return pos + ahead < length ? text[pos + ahead] : CharT(0);
+    }
+
+    bool makeToken(Token& token, TokenType type, size_t start)
+    {
+        token.type = type;
+        token.offset = static_cast<uint32_t>(start);
+        token.length = static_cast<uint32_t>(pos - start);
+        return true;
+    }
+
+    // Scans the rest of a multi-character literal or comment started at start
+    bool continueToken(Token& token, size_t start)
+    {
+        if (pos >= length && pos == start)
+            return false;
+
+        TokenType type = TokenType::String;
+        switch (currentState.mode)
+        {
+        case LexerState::BlockComment:
+            type = TokenType::Comment;
+            while (pos < length && !(text[pos] == '*' && peek(1) == '/'))
+                pos++;
+            if (pos < length)
+            {
+                pos += 2;
+                currentState.mode = LexerState::Code;
+            }
+            break;
+
+        case LexerState::String:
+            while (pos < length)
+            {
+                if (text[pos] == '\'')
+                {
+                    // '' is an escaped quote inside the literal
+                    if (peek(1) == '\'')
+                    {
+                        pos += 2;
+                        continue;
+                    }
+                    pos++;
+                    currentState.mode = LexerState::Code;
+                    break;
+                }
+                pos++;
+            }
+            break;
+
+        case LexerState::QuoteDelimitedString:
+            while (pos < length && !(static_cast<uint32_t>(text[pos]) == currentState.quoteDelimiter && peek(1) == '\''))
+                pos++;
+            if (pos < length)
+            {
+                pos += 2;
+                currentState.mode = LexerState::Code;
+                currentState.quoteDelimiter = 0;
+            }
+            break;
+
+        case LexerState::QuotedIdentifier:
+            type = TokenType::QuotedIdentifier;
+            while (pos < length && text[pos] != '"')
+                pos++;
+            if (pos < length)
+            {
+                pos++;
+                currentState.mode = LexerState::Code;
+            }
+            break;
+
+        case LexerState::Code:
+            break;
+        }
+
+        return makeToken(token, type, start);
+    }
+
+    static uint32_t closingQuoteDelimiter(CharT opening)
+    {
+        switch (opening)
+        {
+        case '[':
+            return ']';
+        case '(':
+            return ')';
+        case '{':
+            return '}';
+        case '<':
+            return '>';
+        }
+        return static_cast<uint32_t>(opening);
+    }
+
+    static bool isTwoCharSymbol(CharT first, CharT second)
+    {
+        switch (first)
+        {
+        case ':':
+            return second == '=';
+        case '=':
+            return second == '>';
+        case '|':
+            return second == '|';
+        case '.':
+            return second == '.';
+        case '*':
+            return second == '*';
+        case '<':
+            return second == '=' || second == '>' || second == '<';
+        case '>':
+            return second == '=' || second == '>';
+        case '!':
+        case '^':
+        case '~':
+            return second == '=';
+        }
+        return false;
+    }
+
+    const CharT* text;
+    size_t length;
+    size_t pos;
+    LexerState currentState;
+};
+
+// Keywords are ASCII, so folding only ASCII letters keeps text in other scripts from matching
+// them whatever the locale.
+template<typename CharT>
+constexpr CharT toUpperAsciiChar(CharT c)
+{
+    return c >= 'a' && c <= 'z' ? static_cast<CharT>(c - 'a' + 'A') : c;
+}
+
+// Case-insensitive comparison of a token against an uppercase ASCII keyword.
+template<typename CharT>
+bool tokenEquals(const CharT* text, const Token& token, const char* keyword)
+{
+    const CharT* tokenText = text + token.offset;
+    for (uint32_t i = 0; i < token.length; i++, keyword++)
+    {
+        if (*keyword == '\0')
+            return false;
+
+        if (toUpperAsciiChar(tokenText[i]) != static_cast<CharT>(*keyword))
+            return false;
+    }
+    return *keyword == '\0';
+}
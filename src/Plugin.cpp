@@ -0,0 +1,13 @@
+#include "pch.h"
+#include "PlSqlDevFunctions.hpp"
+#include "Plugin.hpp"
+
+int getPluginPreference(const char* name, int defaultValue)
+{
+    return IDE_GetPrefAsInteger(pluginId, "", name, defaultValue);
+}
+
+void setPluginPreference(const char* name, int value)
+{
+    IDE_SetPrefAsInteger(pluginId, "", name, value);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// Plug-in ID assigned by PL/SQL Developer in IdentifyPlugIn, needed by the session and preference callbacks.
+extern int pluginId;
+extern int ideVersion;
+
+// Integer settings kept in PL/SQL Developer's preferences under the plug-in's section.
+int getPluginPreference(const char* name, int defaultValue);
+void setPluginPreference(const char* name, int value);
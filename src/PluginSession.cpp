@@ -0,0 +1,14 @@
+#include "pch.h"
+#include "PlSqlDevFunctions.hpp"
+#include "Plugin.hpp"
+#include "PluginSession.hpp"
+
+PluginSession::PluginSession()
+{
+    open = SQL_UsePlugInSession(pluginId);
+}
+
+PluginSession::~PluginSession()
+{
+    SQL_UseDefaultSession(pluginId);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "pch.h"
+#include "PlSqlDevFunctions.hpp"
+#include "StatementTimings.hpp"
+
+// Makes the SQL_* callbacks use the plug-in's private Oracle session for the lifetime of the
+// object, so dictionary queries don't interfere with the user's transaction.
+class PluginSession
+{
+public:
+    PluginSession();
+    ~PluginSession();
+
+    PluginSession(const PluginSession&) = delete;
+    PluginSession& operator=(const PluginSession&) = delete;
+
+    bool isOpen() const { return open; }
+
+private:
+    bool open;
+};
+
+// Executes a query and calls rowHandler once per fetched row, the row fields being available
+// through SQL_Field. Returns false if the statement failed.
+template<typename RowHandler>
+bool queryRows(const char* sql, RowHandler rowHandler)
+{
+    if (executeTimedSql(sql) != 0)
+        return false;
+
+    while (!SQL_Eof())
+    {
+        rowHandler();
+        if (SQL_Next() != 0)
+            return false;
+    }
+
+    return true;
+}
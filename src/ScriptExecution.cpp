@@ -0,0 +1,306 @@
+#include "pch.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "EditorUtils.hpp"
+#include "FileUtils.hpp"
+#include "LogWindow.hpp"
+#include "PluginSession.hpp"
+#include "ScriptSplitter.hpp"
+#include "StatementTimings.hpp"
+#include "Ui.hpp"
+#include "ScriptExecution.hpp"
+
+constexpr size_t MAX_OUTPUT_LINES = 100000;
+constexpr size_t MAX_OUTPUT_BYTES = 16 * 1024 * 1024;
+// Script files are split through views of this size, which no statement may be larger than
+constexpr size_t SCRIPT_VIEW_BYTES = 64 * 1024 * 1024;
+
+const char* const ENABLE_OUTPUT_SQL = "begin dbms_output.enable(null); end;";
+const char* const ROLLBACK_SQL = "rollback";
+// Fetches buffered output in chunks that fit a varchar2 bind. A line that doesn't fit into the
+// current chunk is returned separately so it isn't lost, without its line break, which wouldn't
+// fit after a line of 32767 bytes; :drained tells if there's more to fetch.
+const char* const FETCH_OUTPUT_SQL =
+    "declare\n"
+    "  l_line varchar2(32767);\n"
+    "  l_status integer;\n"
+    "  l_lines varchar2(32767);\n"
+    "begin\n"
+    "  :drained := 'N';\n"
+    "  :haspending := 'N';\n"
+    "  loop\n"
+    "    dbms_output.get_line(l_line, l_status);\n"
+    "    if l_status <> 0 then\n"
+    "      :drained := 'Y';\n"
+    "      exit;\n"
+    "    end if;\n"
+    "    if nvl(lengthb(l_lines), 0) + nvl(lengthb(l_line), 0) + 1 > 32000 then\n"
+    "      :pending := l_line;\n"
+    "      :haspending := 'Y';\n"
+    "      exit;\n"
+    "    end if;\n"
+    "    l_lines := l_lines || l_line || chr(10);\n"
+    "  end loop;\n"
+    "  :lines := l_lines;\n"
+    "end;";
+
+bool scriptRunning = false;
+
+LogWindow& getOutputWindow()
+{
+    // Created on first use, the ring of lines is allocated up front
+    static LogWindow outputWindow(L"Script output", MAX_OUTPUT_LINES, MAX_OUTPUT_BYTES);
+    return outputWindow;
+}
+
+// Lets the IDE and the output window repaint and react between statements
+void pumpMessages()
+{
+    MSG message;
+    while (PeekMessage(&message, NULL, 0, 0, PM_REMOVE))
+    {
+        if (message.message == WM_QUIT)
+        {
+            PostQuitMessage(static_cast<int>(message.wParam));
+            return;
+        }
+        TranslateMessage(&message);
+        DispatchMessage(&message);
+    }
+}
+
+// Must be called on the plug-in session. Returns false if the output couldn't be fetched.
+bool fetchOutput(LogWindow& outputWindow)
+{
+    bool drained = false;
+    while (!drained)
+    {
+        SQL_ClearVariables();
+        SQL_SetVariable("lines", "");
+        SQL_SetVariable("pending", "");
+        SQL_SetVariable("drained", "");
+        SQL_SetVariable("haspending", "");
+        if (executeTimedSql(FETCH_OUTPUT_SQL) != 0)
+        {
+            outputWindow.append(std::string("Can't fetch DBMS_OUTPUT: ") + SQL_ErrorMessage() + "\n");
+            return false;
+        }
+
+        outputWindow.append(SQL_GetVariable("lines"));
+        if (*SQL_GetVariable("haspending") == 'Y')
+            outputWindow.append(std::string(SQL_GetVariable("pending")) + "\n");
+        drained = *SQL_GetVariable("drained") == 'Y';
+    }
+    SQL_ClearVariables();
+
+    return true;
+}
+
+// Statements are copied out of the script one at a time by statementText, so it may be a file
+// mapped a view at a time. An empty text means the statement couldn't be read.
+template<typename StatementText>
+void runStatements(const std::vector<ScriptStatement>& statements, StatementText statementText)
+{
+    scriptRunning = true;
+    auto& outputWindow = getOutputWindow();
+    outputWindow.show();
+
+    {
+        PluginSession session;
+        if (!session.isOpen() || executeTimedSql(ENABLE_OUTPUT_SQL) != 0)
+        {
+            outputWindow.append("Can't open the plug-in session.\n");
+            scriptRunning = false;
+            return;
+        }
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    size_t executedCount = 0;
+    std::string error;
+    for (auto& statement : statements)
+    {
+        pumpMessages();
+        // Closing the output window stops the script
+        if (!outputWindow.isOpen())
+            break;
+        outputWindow.setStatus(L"running statement " + std::to_wstring(executedCount + 1) + L" of " + std::to_wstring(statements.size()));
+
+        // The session is taken per statement, so nothing dispatched while pumping messages
+        // runs its own SQL on it. Without it the statement would run in the user's session.
+        PluginSession session;
+        if (!session.isOpen())
+        {
+            error = "Can't open the plug-in session, the script was stopped.\n";
+            break;
+        }
+        std::string sql = statementText(statement);
+        if (sql.empty())
+        {
+            error = "Can't read the statement at line " + std::to_string(statement.line + 1) + ".\n";
+            break;
+        }
+        auto statementStartTime = std::chrono::steady_clock::now();
+        if (executeTimedSql(sql.c_str()) != 0)
+            error = "Error in statement at line " + std::to_string(statement.line + 1) + ":\n" + SQL_ErrorMessage() + "\n";
+        double statementSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - statementStartTime).count();
+
+        bool outputFetched = fetchOutput(outputWindow);
+        std::ostringstream timing;
+        timing.precision(3);
+        timing << std::fixed << "-- statement at line " << statement.line + 1 << ": " << statementSeconds << " s\n";
+        outputWindow.append(timing.str());
+        if (!error.empty() || !outputFetched)
+            break;
+        executedCount++;
+    }
+
+    // Never in the user's session, where it would throw away their uncommitted work
+    bool rolledBack = false;
+    {
+        PluginSession session;
+        rolledBack = session.isOpen() && executeTimedSql(ROLLBACK_SQL) == 0;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::ostringstream summary;
+    summary.precision(1);
+    summary << std::fixed << error << "Executed " << executedCount << " of " << statements.size() << " statements in " << seconds
+        << (rolledBack ? " s. Changes not committed by the script were rolled back.\n"
+            : " s. Changes not committed by the script couldn't be rolled back.\n");
+    outputWindow.append(summary.str());
+    outputWindow.setStatus(error.empty() && executedCount == statements.size() ? L"finished" : L"stopped");
+
+    scriptRunning = false;
+}
+
+void runStatements(std::string_view script, const std::vector<ScriptStatement>& statements)
+{
+    runStatements(statements, [script](const ScriptStatement& statement) {
+        return std::string(script.substr(statement.offset, statement.length));
+    });
+}
+
+// Each view but the last ends at a line break and the next one starts where its last complete
+// statement ended, so only the statements split there are kept
+bool splitScriptFile(SlidingFileView& file, std::vector<ScriptStatement>& statements, std::wstring& error)
+{
+    uint64_t viewStart = 0;
+    size_t viewFirstLine = 0;
+    while (viewStart < file.fileSize())
+    {
+        std::string_view view = file.map(viewStart, SCRIPT_VIEW_BYTES);
+        if (view.empty())
+        {
+            error = L"Can't read ";
+            return false;
+        }
+
+        bool lastView = viewStart + view.size() == file.fileSize();
+        size_t resumeOffset = view.size();
+        std::vector<ScriptStatement> viewStatements;
+        if (lastView)
+            viewStatements = splitScript(view.data(), view.size());
+        else
+        {
+            view = view.substr(0, view.rfind('\n') + 1);
+            viewStatements = splitScriptPart(view.data(), view.size(), resumeOffset);
+            if (resumeOffset == 0)
+            {
+                error = L"A statement larger than " + std::to_wstring(SCRIPT_VIEW_BYTES >> 20) + L" MB can't be run from ";
+                return false;
+            }
+        }
+
+        for (auto& statement : viewStatements)
+            statements.push_back({ static_cast<size_t>(viewStart) + statement.offset, statement.length, viewFirstLine + statement.line });
+        viewFirstLine += std::count(view.begin(), view.begin() + resumeOffset, '\n');
+        viewStart += resumeOffset;
+    }
+    file.unmap();
+    return true;
+}
+
+bool canRunScript()
+{
+    if (scriptRunning)
+    {
+        showMessage(L"A script is already running; close its output window to stop it.", MB_OK | MB_ICONWARNING);
+        return false;
+    }
+    return IDE_Connected();
+}
+
+void executeScriptWithOutput()
+{
+    if (!canRunScript())
+        return;
+
+    const char* selectedText = IDE_GetSelectedText();
+    std::string script = selectedText != NULL && *selectedText != '\0' ? selectedText : IDE_GetText();
+    auto statements = splitScript(script.data(), script.size());
+    if (!statements.empty())
+        runStatements(script, statements);
+}
+
+void executeScriptFileWithOutput()
+{
+    if (!canRunScript())
+        return;
+
+    std::wstring fileName;
+    if (!showOpenFileDialog(L"SQL scripts (*.sql)\0*.sql\0All files (*.*)\0*.*\0", fileName))
+        return;
+    // The offsets of the statements are size_t
+    SlidingFileView file;
+    if (!file.open(fileName) || file.fileSize() > SIZE_MAX)
+    {
+        showMessage(L"Can't open " + fileName, MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    std::vector<ScriptStatement> statements;
+    std::wstring error;
+    if (!splitScriptFile(file, statements, error))
+    {
+        showMessage(error + fileName, MB_OK | MB_ICONERROR);
+        return;
+    }
+    if (!statements.empty())
+    {
+        runStatements(statements, [&file](const ScriptStatement& statement) {
+            return std::string(file.map(statement.offset, statement.length));
+        });
+    }
+}
+
+void executeStatementAtCaret()
+{
+    if (!canRunScript())
+        return;
+
+    HWND editorWindow = IDE_GetEditorHandle();
+    EditorString text = getEditorText(editorWindow);
+    auto statements = splitScript(text.data(), text.size());
+    DWORD selectionStart = 0;
+    DWORD selectionEnd = 0;
+    SendMessage(editorWindow, EM_GETSEL, reinterpret_cast<WPARAM>(&selectionStart), reinterpret_cast<LPARAM>(&selectionEnd));
+    size_t index = findStatementAt(statements, selectionStart);
+    if (index == statements.size())
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    // Selected, so that it's clear which statement ran
+    const ScriptStatement& statement = statements[index];
+    SendMessage(editorWindow, EM_SETSEL, statement.offset, statement.offset + statement.length);
+    std::string sql = toAnsiString(EditorStringView(text).substr(statement.offset, statement.length));
+    size_t line = SendMessage(editorWindow, EM_LINEFROMCHAR, statement.offset, 0);
+    runStatements(sql, { { 0, sql.size(), line } });
+}
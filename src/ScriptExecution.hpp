@@ -0,0 +1,10 @@
+#pragma once
+
+// Runs the selected text (or the whole window) statement by statement on the plug-in session,
+// streaming DBMS_OUTPUT to a log window after every statement instead of all at once at the end,
+// followed by the time the statement took.
+void executeScriptWithOutput();
+// Same for a script file, which is mapped rather than loaded into a window, however large it is
+void executeScriptFileWithOutput();
+// Same for the statement the caret is in, found in the statements of the whole window
+void executeStatementAtCaret();
@@ -0,0 +1,393 @@
+#include "pch.h"
+#include <algorithm>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "PlSqlDevFunctions.hpp"
+#include "BinaryIo.hpp"
+#include "BlobStore.hpp"
+#include "EditorUtils.hpp"
+#include "FileUtils.hpp"
+#include "LogWindow.hpp"
+#include "PlSqlLexer.hpp"
+#include "Ui.hpp"
+#include "ScriptRepository.hpp"
+
+constexpr auto SCRIPT_STORE_FILE_NAME = L"scripts.bin";
+constexpr auto SCRIPT_INDEX_FILE_NAME = L"scripts-index.bin";
+constexpr char SCRIPT_STORE_MAGIC[8] = { 'P', 'S', 'D', 'E', 'S', 'C', 'R', '1' };
+constexpr char SCRIPT_INDEX_MAGIC[8] = { 'P', 'S', 'D', 'E', 'S', 'I', 'X', '1' };
+// The index log is rewritten once it has this many records per script
+constexpr size_t MAX_INDEX_RECORDS_PER_SCRIPT = 2;
+// Imported texts are written whenever this much is waiting
+constexpr size_t IMPORT_FLUSH_BYTES = 16 * 1024 * 1024;
+constexpr size_t SCRIPT_LIST_MAX_LINES = 1000000;
+constexpr size_t SCRIPT_LIST_MAX_BYTES = 64 * 1024 * 1024;
+
+struct ScriptExtension
+{
+    const wchar_t* extension;
+    int windowType;
+};
+
+// Files imported from a folder, and the windows they open in
+const std::vector<ScriptExtension> SCRIPT_EXTENSIONS = {
+    { L".sql", PLSQL_WT_SQL },
+    { L".tst", PLSQL_WT_TEST },
+    { L".pck", PLSQL_WT_PROCEDURE },
+    { L".pks", PLSQL_WT_PROCEDURE },
+    { L".pkb", PLSQL_WT_PROCEDURE },
+    { L".spc", PLSQL_WT_PROCEDURE },
+    { L".bdy", PLSQL_WT_PROCEDURE },
+    { L".prc", PLSQL_WT_PROCEDURE },
+    { L".fnc", PLSQL_WT_PROCEDURE },
+    { L".trg", PLSQL_WT_PROCEDURE },
+    { L".typ", PLSQL_WT_PROCEDURE },
+    { L".tps", PLSQL_WT_PROCEDURE },
+    { L".tpb", PLSQL_WT_PROCEDURE },
+};
+
+struct ScriptEntry
+{
+    // Offset of the text in the store
+    uint64_t text;
+    int32_t windowType;
+    // FILETIME of the last save, in UTC
+    uint64_t time;
+};
+
+struct ScriptIndex
+{
+    bool loaded = false;
+    std::map<std::string, ScriptEntry> scripts;
+    size_t recordCount = 0;
+    // End of the last whole record, where the next one is written
+    uint64_t end = 0;
+    // File size when last read or written
+    uint64_t fileSize = 0;
+};
+
+BlobStore scriptTexts(SCRIPT_STORE_FILE_NAME, std::string_view(SCRIPT_STORE_MAGIC, sizeof(SCRIPT_STORE_MAGIC)));
+ScriptIndex scriptIndex;
+std::string loadedScriptText;
+std::vector<std::string> listedScripts;
+
+void appendIndexRecord(std::string& output, const std::string& name, const ScriptEntry& entry)
+{
+    appendBytes(output, name);
+    appendUint64(output, entry.text);
+    appendUint32(output, static_cast<uint32_t>(entry.windowType));
+    appendUint64(output, entry.time);
+}
+
+// Later records of a name replace the earlier ones
+void loadScriptIndex()
+{
+    scriptIndex = ScriptIndex();
+    scriptIndex.loaded = true;
+
+    std::wstring fileName = getPluginDataDirectory() + SCRIPT_INDEX_FILE_NAME;
+    scriptIndex.fileSize = getFileSize(fileName);
+    std::string contents;
+    if (!readFile(fileName, contents))
+        return;
+    ByteReader reader(contents);
+    if (reader.take(sizeof(SCRIPT_INDEX_MAGIC)) != std::string_view(SCRIPT_INDEX_MAGIC, sizeof(SCRIPT_INDEX_MAGIC)))
+        return;
+
+    scriptIndex.end = sizeof(SCRIPT_INDEX_MAGIC);
+    while (!reader.atEnd())
+    {
+        std::string name(reader.readBytes());
+        ScriptEntry entry;
+        entry.text = reader.readUint64();
+        entry.windowType = static_cast<int32_t>(reader.readUint32());
+        entry.time = reader.readUint64();
+        if (reader.failed())
+            break;
+
+        scriptIndex.end = contents.size() - reader.remaining();
+        scriptIndex.recordCount++;
+        scriptIndex.scripts[name] = entry;
+    }
+}
+
+void ensureScriptIndexLoaded()
+{
+    if (!scriptIndex.loaded || getFileSize(getPluginDataDirectory() + SCRIPT_INDEX_FILE_NAME) != scriptIndex.fileSize)
+        loadScriptIndex();
+}
+
+// Rewrites the log with a record per script
+void compactScriptIndex()
+{
+    std::string contents(SCRIPT_INDEX_MAGIC, sizeof(SCRIPT_INDEX_MAGIC));
+    for (auto& [name, entry] : scriptIndex.scripts)
+        appendIndexRecord(contents, name, entry);
+    if (!writeFile(getPluginDataDirectory() + SCRIPT_INDEX_FILE_NAME, contents))
+        return;
+
+    scriptIndex.recordCount = scriptIndex.scripts.size();
+    scriptIndex.end = contents.size();
+    scriptIndex.fileSize = contents.size();
+}
+
+// Writes the texts added to the store, then the index records pointing to them
+bool writeScriptEntries(const std::vector<std::pair<std::string, ScriptEntry>>& entries)
+{
+    if (entries.empty())
+        return true;
+
+    std::string records;
+    if (scriptIndex.end == 0)
+        records.assign(SCRIPT_INDEX_MAGIC, sizeof(SCRIPT_INDEX_MAGIC));
+    for (auto& [name, entry] : entries)
+        appendIndexRecord(records, name, entry);
+
+    OutputFile file;
+    bool written = scriptTexts.flush() && file.openAt(getPluginDataDirectory() + SCRIPT_INDEX_FILE_NAME, scriptIndex.end)
+        && file.write(records);
+    written = file.close() && written;
+    if (!written)
+    {
+        scriptIndex.loaded = false;
+        return false;
+    }
+
+    scriptIndex.end += records.size();
+    scriptIndex.fileSize = scriptIndex.end;
+    scriptIndex.recordCount += entries.size();
+    for (auto& [name, entry] : entries)
+        scriptIndex.scripts[name] = entry;
+    if (scriptIndex.recordCount > scriptIndex.scripts.size() * MAX_INDEX_RECORDS_PER_SCRIPT)
+        compactScriptIndex();
+    return true;
+}
+
+uint64_t getCurrentFileTime()
+{
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    return static_cast<uint64_t>(now.dwHighDateTime) << 32 | now.dwLowDateTime;
+}
+
+// Returns false if saving failed; saving a text the script already has writes nothing
+bool storeScript(const std::string& name, std::string_view text, int windowType)
+{
+    ensureScriptIndexLoaded();
+    uint64_t textOffset = scriptTexts.add(text);
+    auto found = scriptIndex.scripts.find(name);
+    if (found != scriptIndex.scripts.end() && found->second.text == textOffset && found->second.windowType == windowType)
+        return true;
+
+    return writeScriptEntries({ { name, { textOffset, windowType, getCurrentFileTime() } } });
+}
+
+const char* loadRepositoryScript(const char* name)
+{
+    ensureScriptIndexLoaded();
+    auto found = scriptIndex.scripts.find(name != NULL ? name : "");
+    loadedScriptText.clear();
+    if (found == scriptIndex.scripts.end() || !scriptTexts.read({ found->second.text }, loadedScriptText))
+        return NULL;
+    return loadedScriptText.c_str();
+}
+
+bool saveRepositoryScript(const char* tag, const char* name, int windowType)
+{
+    const char* data = IDE_GetFiledata();
+    if (name == NULL || *name == '\0' || data == NULL)
+        return false;
+    if (!storeScript(name, data, windowType))
+    {
+        showMessage(L"The script couldn't be saved to the script repository.", MB_OK | MB_ICONWARNING);
+        return false;
+    }
+
+    IDE_FileSaved(SCRIPT_REPOSITORY_NAME, tag, name);
+    return true;
+}
+
+void openRepositoryScript(const std::string& name)
+{
+    auto found = scriptIndex.scripts.find(name);
+    std::string text;
+    if (found == scriptIndex.scripts.end() || !scriptTexts.read({ found->second.text }, text))
+    {
+        showMessage(L"The script couldn't be read from the script repository.", MB_OK | MB_ICONWARNING);
+        return;
+    }
+    IDE_OpenFileExternal(found->second.windowType, text.c_str(), SCRIPT_REPOSITORY_NAME, "", name.c_str());
+}
+
+void openListedScript(size_t line)
+{
+    if (line >= listedScripts.size())
+        return;
+    ensureScriptIndexLoaded();
+    openRepositoryScript(listedScripts[line]);
+}
+
+bool containsIgnoringCase(std::string_view text, std::string_view part)
+{
+    return std::search(text.begin(), text.end(), part.begin(), part.end(),
+        [](char first, char second) { return toUpperAsciiChar(first) == toUpperAsciiChar(second); }) != text.end();
+}
+
+void openFromScriptRepository()
+{
+    std::wstring query;
+    if (!showInputBox(L"Open from script repository", L"Name, or a part of it (empty for all):", query))
+        return;
+
+    ensureScriptIndexLoaded();
+    std::string part = toAnsiString(query);
+    listedScripts.clear();
+    for (auto& [name, entry] : scriptIndex.scripts)
+    {
+        if (containsIgnoringCase(name, part))
+            listedScripts.push_back(name);
+    }
+
+    if (listedScripts.empty())
+    {
+        showMessage(L"No script in the repository has that name.");
+        return;
+    }
+    if (listedScripts.size() == 1)
+    {
+        openRepositoryScript(listedScripts.front());
+        return;
+    }
+
+    std::string lines;
+    for (auto& name : listedScripts)
+        lines += name + "\n";
+    static LogWindow scriptsWindow(L"Script repository", SCRIPT_LIST_MAX_LINES, SCRIPT_LIST_MAX_BYTES);
+    scriptsWindow.show();
+    scriptsWindow.setLineActivated(openListedScript);
+    scriptsWindow.append(lines);
+    scriptsWindow.setStatus(std::to_wstring(listedScripts.size()) + L" of " + std::to_wstring(scriptIndex.scripts.size())
+        + L" scripts; double-click one to open it");
+}
+
+void saveToScriptRepository()
+{
+    if (!IDE_CanSaveWindow())
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    const char* fileName = IDE_Filename();
+    std::wstring name = toEditorString(fileName != NULL ? fileName : "");
+    if (!showInputBox(L"Save to script repository", L"Name:", name) || name.empty())
+        return;
+    saveRepositoryScript("", toAnsiString(name).c_str(), IDE_GetWindowType());
+}
+
+int getScriptWindowType(const std::wstring& fileName)
+{
+    size_t dot = fileName.find_last_of(L'.');
+    if (dot == std::wstring::npos)
+        return PLSQL_WT_UNKNOWN;
+    std::wstring extension = fileName.substr(dot);
+    for (auto& script : SCRIPT_EXTENSIONS)
+    {
+        if (CompareStringOrdinal(extension.c_str(), -1, script.extension, -1, TRUE) == CSTR_EQUAL)
+            return script.windowType;
+    }
+    return PLSQL_WT_UNKNOWN;
+}
+
+// Depth-first, so the paths come in the order of a directory listing
+void findScriptFiles(const std::wstring& folder, const std::wstring& relativeFolder, std::vector<std::wstring>& files)
+{
+    WIN32_FIND_DATA found;
+    HANDLE search = FindFirstFile((folder + relativeFolder + L"*").c_str(), &found);
+    if (search == INVALID_HANDLE_VALUE)
+        return;
+
+    do
+    {
+        std::wstring name = found.cFileName;
+        if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            if (name != L"." && name != L"..")
+                findScriptFiles(folder, relativeFolder + name + L"\\", files);
+        }
+        else if (getScriptWindowType(name) != PLSQL_WT_UNKNOWN)
+            files.push_back(relativeFolder + name);
+    } while (FindNextFile(search, &found));
+    FindClose(search);
+}
+
+void importFolderToScriptRepository()
+{
+    std::wstring folder;
+    if (!showInputBox(L"Import into script repository", L"Folder:", folder) || folder.empty())
+        return;
+    if (folder.back() != L'\\' && folder.back() != L'/')
+        folder += L'\\';
+
+    std::vector<std::wstring> files;
+    findScriptFiles(folder, L"", files);
+    if (files.empty())
+    {
+        showMessage(L"The folder has no scripts to import.", MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    // Texts are written in large batches, each followed by the index records of its scripts
+    ensureScriptIndexLoaded();
+    std::vector<std::pair<std::string, ScriptEntry>> entries;
+    size_t unreadable = 0;
+    size_t unchanged = 0;
+    bool written = true;
+    uint64_t time = getCurrentFileTime();
+    for (size_t i = 0; i < files.size() && written; i++)
+    {
+        std::string text;
+        if (!readFile(folder + files[i], text))
+        {
+            unreadable++;
+            continue;
+        }
+
+        std::string name = toAnsiString(files[i]);
+        int windowType = getScriptWindowType(files[i]);
+        uint64_t textOffset = scriptTexts.add(text);
+        auto found = scriptIndex.scripts.find(name);
+        if (found != scriptIndex.scripts.end() && found->second.text == textOffset && found->second.windowType == windowType)
+        {
+            unchanged++;
+            continue;
+        }
+        entries.push_back({ name, { textOffset, windowType, time } });
+
+        if (scriptTexts.pendingBytes() >= IMPORT_FLUSH_BYTES)
+        {
+            written = writeScriptEntries(entries);
+            entries.clear();
+        }
+    }
+    written = written && writeScriptEntries(entries);
+
+    if (!written)
+    {
+        showMessage(L"The import stopped, the script repository couldn't be written.", MB_OK | MB_ICONWARNING);
+        return;
+    }
+    std::wstring report = std::to_wstring(files.size() - unreadable - unchanged) + L" scripts imported";
+    if (unchanged > 0)
+        report += L", " + std::to_wstring(unchanged) + L" already in the repository";
+    if (unreadable > 0)
+        report += L", " + std::to_wstring(unreadable) + L" couldn't be read";
+    showMessage(report + L".");
+}
+
+void closeScriptRepository()
+{
+    scriptTexts.close();
+}
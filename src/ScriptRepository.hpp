@@ -0,0 +1,25 @@
+#pragma once
+
+#include "pch.h"
+
+// Scripts kept in the plug-in's data directory rather than as separate files. Their contents go
+// to a BlobStore, so a text shared by several scripts or saved again unchanged is stored once,
+// compressed, and an index log maps the script names to them. Opening the repository reads just
+// the index; texts are read from a mapping of the store when opened. The repository is
+// registered as a PL/SQL Developer file system, so its windows are saved back to it.
+
+// Name of the file system, as the IDE shows it
+constexpr auto SCRIPT_REPOSITORY_NAME = "Script repository";
+
+// DirectFileLoad: the text of the script, valid until the next call. NULL if it isn't found.
+const char* loadRepositoryScript(const char* name);
+// DirectFileSave: stores the current window's data under the name
+bool saveRepositoryScript(const char* tag, const char* name, int windowType);
+
+// Prompts for part of a name and opens the matching script, or lists the matches
+void openFromScriptRepository();
+void saveToScriptRepository();
+// Adds the scripts in a folder and its subfolders, named by their paths relative to it
+void importFolderToScriptRepository();
+// Releases what the store keeps between uses, before the plug-in is unloaded
+void closeScriptRepository();
@@ -0,0 +1,285 @@
+#include "pch.h"
+#include <algorithm>
+#include <future>
+#include "PlSqlLexer.hpp"
+#include "WorkerPool.hpp"
+#include "ScriptSplitter.hpp"
+
+// Enough to see past CREATE OR REPLACE NONEDITIONABLE to the kind of object
+constexpr size_t LEADING_WORD_COUNT = 5;
+// Scripts up to this size are split on the calling thread in one go
+constexpr size_t SPLIT_CHUNK_LENGTH = 1024 * 1024;
+constexpr size_t NO_OFFSET = SIZE_MAX;
+
+// A ';' or a '/' line, which may end a statement depending on the statement
+struct StatementTerminator
+{
+    size_t offset;
+    // End of the last token before it other than a comment, NO_OFFSET if there is none in the chunk
+    size_t previousEnd;
+    // Start of the first token after it other than a comment, NO_OFFSET if there is none in the chunk
+    size_t nextStart;
+    bool isSlashLine;
+};
+
+// What a chunk holds, found without knowing the statement it starts in
+struct ChunkScan
+{
+    size_t start;
+    size_t end;
+    LexerState startState;
+    LexerState endState;
+    size_t firstTokenStart = NO_OFFSET;
+    size_t lastTokenEnd = NO_OFFSET;
+    size_t newlineCount = 0;
+    std::vector<StatementTerminator> terminators;
+};
+
+template<typename CharT>
+bool isAloneOnLine(const CharT* text, size_t length, const Token& token)
+{
+    for (size_t i = token.offset; i > 0 && text[i - 1] != '\n'; i--)
+    {
+        if (!BasicPlSqlLexer<CharT>::isWhitespace(text[i - 1]))
+            return false;
+    }
+    for (size_t i = token.offset + token.length; i < length && text[i] != '\n'; i++)
+    {
+        if (!BasicPlSqlLexer<CharT>::isWhitespace(text[i]))
+            return false;
+    }
+    return true;
+}
+
+// Anonymous blocks and stored program units contain ';' themselves, so only '/' ends them
+template<typename CharT>
+bool isPlSqlUnitStart(const CharT* text, const std::vector<Token>& words)
+{
+    if (words.empty())
+        return false;
+    if (tokenEquals(text, words[0], "BEGIN") || tokenEquals(text, words[0], "DECLARE"))
+        return true;
+    if (!tokenEquals(text, words[0], "CREATE"))
+        return false;
+
+    size_t i = 1;
+    if (i + 1 < words.size() && tokenEquals(text, words[i], "OR") && tokenEquals(text, words[i + 1], "REPLACE"))
+        i += 2;
+    if (i < words.size() && (tokenEquals(text, words[i], "EDITIONABLE") || tokenEquals(text, words[i], "NONEDITIONABLE")))
+        i++;
+    if (i >= words.size())
+        return false;
+
+    for (auto kind : { "PROCEDURE", "FUNCTION", "PACKAGE", "TRIGGER", "TYPE", "LIBRARY" })
+    {
+        if (tokenEquals(text, words[i], kind))
+            return true;
+    }
+    return false;
+}
+
+// Statements start with a token in code, so their leading words can be lexed on their own
+template<typename CharT>
+bool isPlSqlUnitStartAt(const CharT* text, size_t length, size_t statementStart, std::vector<Token>& leadingWords)
+{
+    leadingWords.clear();
+    BasicPlSqlLexer<CharT> lexer(text, length, statementStart);
+    Token token;
+    while (leadingWords.size() < LEADING_WORD_COUNT && lexer.next(token))
+    {
+        if (token.type == TokenType::Comment)
+            continue;
+        leadingWords.push_back(token);
+        // Most statements are told apart by their first word
+        if (leadingWords.size() == 1 && !tokenEquals(text, token, "CREATE"))
+            break;
+    }
+    return isPlSqlUnitStart(text, leadingWords);
+}
+
+// Chunks end just past a line break, where no token other than a comment or literal can be cut
+template<typename CharT>
+void scanChunk(const CharT* text, size_t length, ChunkScan& scan)
+{
+    scan.firstTokenStart = NO_OFFSET;
+    scan.lastTokenEnd = NO_OFFSET;
+    scan.terminators.clear();
+    scan.newlineCount = std::count(text + scan.start, text + scan.end, '\n');
+
+    BasicPlSqlLexer<CharT> lexer(text, scan.end, scan.start, scan.startState);
+    Token token;
+    while (lexer.next(token))
+    {
+        if (token.type == TokenType::Comment)
+            continue;
+
+        if (scan.firstTokenStart == NO_OFFSET)
+            scan.firstTokenStart = token.offset;
+        if (!scan.terminators.empty() && scan.terminators.back().nextStart == NO_OFFSET)
+            scan.terminators.back().nextStart = token.offset;
+
+        bool isTerminator = token.type == TokenType::Symbol && token.length == 1
+            && (text[token.offset] == ';' || (text[token.offset] == '/' && isAloneOnLine(text, length, token)));
+        if (isTerminator)
+            scan.terminators.push_back({ token.offset, scan.lastTokenEnd, NO_OFFSET, text[token.offset] == '/' });
+        scan.lastTokenEnd = token.offset + token.length;
+    }
+    scan.endState = lexer.state();
+}
+
+template<typename CharT>
+std::vector<ChunkScan> scanChunks(const CharT* text, size_t length)
+{
+    std::vector<ChunkScan> scans;
+    for (size_t start = 0; start < length;)
+    {
+        size_t end = std::min(length, start + SPLIT_CHUNK_LENGTH);
+        while (end < length && text[end - 1] != '\n' && text[end - 1] != '\r')
+            end++;
+        ChunkScan scan;
+        scan.start = start;
+        scan.end = end;
+        scans.push_back(std::move(scan));
+        start = end;
+    }
+
+    if (scans.size() == 1)
+        scanChunk(text, length, scans[0]);
+    else
+    {
+        WorkerPool& pool = getWorkerPool();
+        std::vector<std::future<void>> tasks;
+        for (auto& scan : scans)
+            tasks.push_back(pool.submit([text, length, &scan] { scanChunk(text, length, scan); }));
+        for (auto& task : tasks)
+            task.get();
+    }
+
+    // A chunk guessed wrong is lexed again, which may change the state the next one starts in
+    for (size_t i = 1; i < scans.size(); i++)
+    {
+        if (scans[i].startState == scans[i - 1].endState)
+            continue;
+        scans[i].startState = scans[i - 1].endState;
+        scanChunk(text, length, scans[i]);
+    }
+    return scans;
+}
+
+// Same rules as SQL*Plus, applied to the terminators in text order: a '/' with nothing before it
+// would rerun the previous statement in SQL*Plus, so it's skipped, and a lone ';' is an empty
+// statement. With resumeOffset, the text may end in the middle of a statement, which is left out.
+template<typename CharT>
+std::vector<ScriptStatement> splitScriptText(const CharT* text, size_t length, size_t* resumeOffset = nullptr)
+{
+    std::vector<ChunkScan> scans = scanChunks(text, length);
+
+    std::vector<ScriptStatement> statements;
+    std::vector<Token> leadingWords;
+    bool inStatement = false;
+    bool inPlSqlUnit = false;
+    size_t statementStart = 0;
+    size_t lastTokenEnd = 0;
+    size_t completeCount = 0;
+
+    auto startStatement = [&](size_t offset) {
+        inStatement = true;
+        statementStart = offset;
+        inPlSqlUnit = isPlSqlUnitStartAt(text, length, offset, leadingWords);
+    };
+    auto endStatement = [&](size_t previousEnd) {
+        size_t statementEnd = std::max(statementStart, previousEnd != NO_OFFSET ? previousEnd : lastTokenEnd);
+        inStatement = false;
+        if (statementEnd > statementStart)
+            statements.push_back({ statementStart, statementEnd - statementStart, 0 });
+    };
+
+    for (auto& scan : scans)
+    {
+        auto& terminators = scan.terminators;
+        auto isSkippedSlashLine = [&](size_t i, size_t offset) {
+            return i < terminators.size() && terminators[i].isSlashLine && terminators[i].offset == offset;
+        };
+
+        if (!inStatement && scan.firstTokenStart != NO_OFFSET && !isSkippedSlashLine(0, scan.firstTokenStart))
+            startStatement(scan.firstTokenStart);
+        for (size_t i = 0; i < terminators.size(); i++)
+        {
+            const StatementTerminator& terminator = terminators[i];
+            if (inStatement && (terminator.isSlashLine || !inPlSqlUnit))
+                endStatement(terminator.previousEnd);
+            // From a terminator outside any statement, the text can be split afresh: a ';' there
+            // ends nothing and a '/' is skipped, while what follows on the line still sees it
+            if (resumeOffset != nullptr && !inStatement)
+            {
+                *resumeOffset = terminator.offset;
+                completeCount = statements.size();
+            }
+            if (!inStatement && terminator.nextStart != NO_OFFSET && !isSkippedSlashLine(i + 1, terminator.nextStart))
+                startStatement(terminator.nextStart);
+        }
+        if (scan.lastTokenEnd != NO_OFFSET)
+            lastTokenEnd = scan.lastTokenEnd;
+    }
+    if (resumeOffset != nullptr)
+        statements.resize(completeCount);
+    else if (inStatement)
+        endStatement(NO_OFFSET);
+
+    // The lines are counted from the start of the chunk each statement starts in
+    std::vector<size_t> chunkFirstStatements;
+    for (auto& scan : scans)
+    {
+        chunkFirstStatements.push_back(std::lower_bound(statements.begin(), statements.end(), scan.start,
+            [](const ScriptStatement& statement, size_t offset) { return statement.offset < offset; }) - statements.begin());
+    }
+    chunkFirstStatements.push_back(statements.size());
+    size_t chunkFirstLine = 0;
+    std::vector<std::future<void>> tasks;
+    for (size_t i = 0; i < scans.size(); i++)
+    {
+        auto countLines = [text, &scans, &statements, &chunkFirstStatements, i, chunkFirstLine] {
+            size_t line = chunkFirstLine;
+            size_t countedUpTo = scans[i].start;
+            for (size_t s = chunkFirstStatements[i]; s < chunkFirstStatements[i + 1]; s++)
+            {
+                line += std::count(text + countedUpTo, text + statements[s].offset, '\n');
+                countedUpTo = statements[s].offset;
+                statements[s].line = line;
+            }
+        };
+        if (scans.size() == 1)
+            countLines();
+        else
+            tasks.push_back(getWorkerPool().submit(countLines));
+        chunkFirstLine += scans[i].newlineCount;
+    }
+    for (auto& task : tasks)
+        task.get();
+
+    return statements;
+}
+
+std::vector<ScriptStatement> splitScript(const char* text, size_t length)
+{
+    return splitScriptText(text, length);
+}
+
+std::vector<ScriptStatement> splitScript(const wchar_t* text, size_t length)
+{
+    return splitScriptText(text, length);
+}
+
+std::vector<ScriptStatement> splitScriptPart(const char* text, size_t length, size_t& resumeOffset)
+{
+    resumeOffset = 0;
+    return splitScriptText(text, length, &resumeOffset);
+}
+
+size_t findStatementAt(const std::vector<ScriptStatement>& statements, size_t offset)
+{
+    auto found = std::upper_bound(statements.begin(), statements.end(), offset, [](size_t offset, const ScriptStatement& statement) {
+        return offset < statement.offset;
+    });
+    return found == statements.begin() ? statements.size() : found - statements.begin() - 1;
+}
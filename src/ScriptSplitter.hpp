@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct ScriptStatement
+{
+    size_t offset;
+    size_t length;
+    // Zero-based line of the statement's first character, for error messages
+    size_t line;
+};
+
+// Splits a script the way SQL*Plus does: SQL statements end with ';', PL/SQL blocks and stored
+// program units end with '/' on a line of its own. The terminators are not part of the
+// statements, which are ready to be passed to SQL_Execute. The statements are in text order.
+//
+// Large scripts, like mapped files, are lexed in chunks on the worker pool, each chunk assuming
+// it starts in code; a chunk that actually starts inside a comment or literal is lexed again
+// once the state the previous one ended in is known. Must not be called from the pool's tasks.
+std::vector<ScriptStatement> splitScript(const char* text, size_t length);
+// Same for the editor's text, whose offsets are those of the EM_ messages
+std::vector<ScriptStatement> splitScript(const wchar_t* text, size_t length);
+// Same for a part of a script read a part at a time, which must end after a line break and may end
+// in the middle of a statement. Only the statements ended by a terminator in the part are returned.
+// resumeOffset is where the next part starts, at the last terminator that isn't inside a
+// statement, where the text is in code again; 0 if there's none past the start.
+std::vector<ScriptStatement> splitScriptPart(const char* text, size_t length, size_t& resumeOffset);
+
+// The statement the offset is in, or its terminator or the blanks after it, by binary search.
+// Returns statements.size() when the offset is before the first statement.
+size_t findStatementAt(const std::vector<ScriptStatement>& statements, size_t offset);
@@ -0,0 +1,684 @@
+#include "pch.h"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
+#include <unordered_map>
+#include "PlSqlDevFunctions.hpp"
+#include "BinaryIo.hpp"
+#include "EditorSearch.hpp"
+#include "EditorUtils.hpp"
+#include "Hash.hpp"
+#include "LogWindow.hpp"
+#include "PluginSession.hpp"
+#include "TextSearch.hpp"
+#include "Ui.hpp"
+#include "WorkerPool.hpp"
+#include "SourceIndex.hpp"
+
+constexpr char SOURCE_INDEX_MAGIC[8] = { 'P', 'S', 'D', 'E', 'S', 'R', 'C', '1' };
+constexpr size_t SOURCE_INDEX_HEADER_SIZE = 32;
+constexpr size_t TRIGRAM_ENTRY_SIZE = 16;
+// Trigrams of 7-bit characters
+constexpr uint32_t TRIGRAM_SPACE = uint32_t(1) << 21;
+constexpr size_t INDEX_CHUNK_BYTES = 8 * 1024 * 1024;
+constexpr size_t SEARCH_BATCH_BYTES = 1024 * 1024;
+constexpr size_t MAX_SOURCE_MATCHES = 10000;
+constexpr size_t SOURCE_MATCHES_LOG_MAX_BYTES = 4 * 1024 * 1024;
+
+const char* const SOURCE_OBJECTS_SQL =
+    "select object_type, object_name, to_char(last_ddl_time, 'yyyymmddhh24miss') from user_objects "
+    "where object_type in ('PACKAGE', 'PACKAGE BODY', 'PROCEDURE', 'FUNCTION', 'TRIGGER', 'TYPE', 'TYPE BODY')";
+const char* const CHANGED_SOURCES_SQL =
+    "select s.type, s.name, s.text from user_source s "
+    "join user_objects o on o.object_type = s.type and o.object_name = s.name "
+    "where o.last_ddl_time >= to_date(:since, 'yyyymmddhh24miss') "
+    "order by s.type, s.name, s.line";
+
+// Postings of a trigram within a chunk of sources: the first source number, then the
+// differences to the next ones in deltas
+struct PostingRun
+{
+    uint32_t trigram;
+    uint32_t firstSource;
+    uint32_t lastSource;
+    uint32_t count;
+    size_t offset;
+    size_t length;
+};
+
+struct PostingChunk
+{
+    // Sorted by trigram
+    std::vector<PostingRun> runs;
+    std::string deltas;
+};
+
+struct SourceMatch
+{
+    std::string type;
+    std::string name;
+    size_t line;
+    size_t column;
+};
+
+SourceIndex sourceIndex;
+// File of the connection the index is open for
+std::wstring sourceIndexFileName;
+bool sourceIndexUpdated = false;
+// Matches of the last search by result line
+std::vector<SourceMatch> sourceMatches;
+
+// Calls handler with every trigram of ASCII characters, folded to uppercase
+template<typename CharT, typename Handler>
+void forEachTrigram(const CharT* text, size_t length, Handler handler)
+{
+    uint32_t trigram = 0;
+    size_t asciiRun = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        uint32_t c = static_cast<std::make_unsigned_t<CharT>>(text[i]);
+        if (c >= 0x80)
+        {
+            asciiRun = 0;
+            continue;
+        }
+        if (c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+        trigram = (trigram << 7 | c) & (TRIGRAM_SPACE - 1);
+        if (++asciiRun >= 3)
+            handler(trigram);
+    }
+}
+
+uint32_t readTableUint32(std::string_view table, size_t offset)
+{
+    return ByteReader(table.substr(offset, 4)).readUint32();
+}
+
+std::string sourceKey(std::string_view type, std::string_view name)
+{
+    std::string key(type);
+    key += '\0';
+    key += name;
+    return key;
+}
+
+// Runs on a worker thread
+PostingChunk collectPostings(const std::vector<IndexedSource>& sources, size_t begin, size_t end)
+{
+    std::vector<bool> seen(TRIGRAM_SPACE);
+    std::vector<uint32_t> sourceTrigrams;
+    std::vector<uint64_t> pairs;
+    for (size_t i = begin; i < end; i++)
+    {
+        std::string_view text = sources[i].text;
+        forEachTrigram(text.data(), text.size(), [&](uint32_t trigram) {
+            if (!seen[trigram])
+            {
+                seen[trigram] = true;
+                sourceTrigrams.push_back(trigram);
+            }
+        });
+        for (uint32_t trigram : sourceTrigrams)
+        {
+            pairs.push_back(static_cast<uint64_t>(trigram) << 32 | i);
+            seen[trigram] = false;
+        }
+        sourceTrigrams.clear();
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    PostingChunk chunk;
+    for (uint64_t pair : pairs)
+    {
+        uint32_t trigram = static_cast<uint32_t>(pair >> 32);
+        uint32_t source = static_cast<uint32_t>(pair);
+        if (chunk.runs.empty() || chunk.runs.back().trigram != trigram)
+        {
+            chunk.runs.push_back({ trigram, source, source, 1, chunk.deltas.size(), 0 });
+            continue;
+        }
+
+        PostingRun& run = chunk.runs.back();
+        appendVarint(chunk.deltas, source - run.lastSource);
+        run.lastSource = source;
+        run.count++;
+        run.length = chunk.deltas.size() - run.offset;
+    }
+    return chunk;
+}
+
+// File layout: magic, source count, trigram count, lengths of the source table and postings,
+// then the source table, the trigram table of fixed-size entries sorted by trigram, postings
+// and the texts.
+bool SourceIndex::write(const std::wstring& fileName, const std::vector<IndexedSource>& sources)
+{
+    std::vector<std::future<PostingChunk>> chunkFutures;
+    size_t chunkStart = 0;
+    size_t chunkBytes = 0;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        chunkBytes += sources[i].text.size();
+        if (chunkBytes >= INDEX_CHUNK_BYTES || i + 1 == sources.size())
+        {
+            chunkFutures.push_back(getWorkerPool().submit([&sources, chunkStart, chunkEnd = i + 1] {
+                return collectPostings(sources, chunkStart, chunkEnd);
+            }));
+            chunkStart = i + 1;
+            chunkBytes = 0;
+        }
+    }
+    std::vector<PostingChunk> chunks;
+    chunks.reserve(chunkFutures.size());
+    for (auto& chunkFuture : chunkFutures)
+        chunks.push_back(chunkFuture.get());
+
+    // Runs of a trigram are joined in chunk order, which keeps the source numbers ascending
+    std::vector<uint64_t> runOrder;
+    for (size_t c = 0; c < chunks.size(); c++)
+    {
+        for (auto& run : chunks[c].runs)
+            runOrder.push_back(static_cast<uint64_t>(run.trigram) << 32 | c);
+    }
+    std::sort(runOrder.begin(), runOrder.end());
+
+    std::vector<size_t> nextRuns(chunks.size());
+    std::string trigramTable;
+    std::string postingData;
+    uint32_t trigramCount = 0;
+    for (size_t i = 0; i < runOrder.size();)
+    {
+        uint32_t trigram = static_cast<uint32_t>(runOrder[i] >> 32);
+        uint64_t postingsStart = postingData.size();
+        uint32_t count = 0;
+        uint32_t previousSource = 0;
+        for (; i < runOrder.size() && static_cast<uint32_t>(runOrder[i] >> 32) == trigram; i++)
+        {
+            size_t chunkIndex = static_cast<uint32_t>(runOrder[i]);
+            const PostingChunk& chunk = chunks[chunkIndex];
+            const PostingRun& run = chunk.runs[nextRuns[chunkIndex]++];
+            appendVarint(postingData, run.firstSource - previousSource);
+            postingData.append(chunk.deltas, run.offset, run.length);
+            count += run.count;
+            previousSource = run.lastSource;
+        }
+
+        appendUint32(trigramTable, trigram);
+        appendUint32(trigramTable, count);
+        appendUint64(trigramTable, postingsStart);
+        trigramCount++;
+    }
+
+    std::string sourceTable;
+    uint64_t textOffset = 0;
+    for (auto& source : sources)
+    {
+        appendBytes(sourceTable, source.type);
+        appendBytes(sourceTable, source.name);
+        appendBytes(sourceTable, source.lastDdlTime);
+        appendUint64(sourceTable, textOffset);
+        appendUint32(sourceTable, static_cast<uint32_t>(source.text.size()));
+        textOffset += source.text.size();
+    }
+
+    std::string header(SOURCE_INDEX_MAGIC, sizeof(SOURCE_INDEX_MAGIC));
+    appendUint32(header, static_cast<uint32_t>(sources.size()));
+    appendUint32(header, trigramCount);
+    appendUint64(header, sourceTable.size());
+    appendUint64(header, postingData.size());
+
+    OutputFile output;
+    bool success = output.open(fileName) && output.write(header) && output.write(sourceTable) && output.write(trigramTable)
+        && output.write(postingData);
+    for (size_t i = 0; i < sources.size() && success; i++)
+        success = output.write(sources[i].text);
+    success = output.close() && success;
+    if (!success)
+        DeleteFile(fileName.c_str());
+    return success;
+}
+
+bool SourceIndex::open(const std::wstring& fileName)
+{
+    close();
+    if (!file.open(fileName))
+        return false;
+
+    ByteReader reader(file.data());
+    bool valid = reader.take(sizeof(SOURCE_INDEX_MAGIC)) == std::string_view(SOURCE_INDEX_MAGIC, sizeof(SOURCE_INDEX_MAGIC));
+    uint32_t sourceCount = reader.readUint32();
+    trigramCount = reader.readUint32();
+    uint64_t sourceTableLength = reader.readUint64();
+    uint64_t postingsLength = reader.readUint64();
+    ByteReader sourceReader(reader.take(static_cast<size_t>(sourceTableLength)));
+    trigramTable = reader.take(trigramCount * TRIGRAM_ENTRY_SIZE);
+    postings = reader.take(static_cast<size_t>(postingsLength));
+    size_t textsStart = SOURCE_INDEX_HEADER_SIZE + static_cast<size_t>(sourceTableLength) + trigramTable.size() + postings.size();
+    std::string_view texts = valid && !reader.failed() ? file.data().substr(textsStart) : std::string_view();
+
+    sourceList.reserve(sourceCount);
+    for (uint32_t i = 0; i < sourceCount && valid && !reader.failed() && !sourceReader.failed(); i++)
+    {
+        IndexedSource source;
+        source.type = sourceReader.readBytes();
+        source.name = sourceReader.readBytes();
+        source.lastDdlTime = sourceReader.readBytes();
+        uint64_t textOffset = sourceReader.readUint64();
+        uint32_t textLength = sourceReader.readUint32();
+        valid = textOffset + textLength <= texts.size();
+        if (valid)
+            source.text = texts.substr(static_cast<size_t>(textOffset), textLength);
+        sourceList.push_back(source);
+    }
+
+    if (!valid || reader.failed() || sourceReader.failed())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SourceIndex::close()
+{
+    file.close();
+    sourceList.clear();
+    trigramTable = std::string_view();
+    postings = std::string_view();
+    trigramCount = 0;
+}
+
+size_t SourceIndex::findTrigram(uint32_t trigram) const
+{
+    size_t low = 0;
+    size_t high = trigramCount;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (readTableUint32(trigramTable, middle * TRIGRAM_ENTRY_SIZE) < trigram)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low < trigramCount && readTableUint32(trigramTable, low * TRIGRAM_ENTRY_SIZE) == trigram ? low : trigramCount;
+}
+
+uint32_t SourceIndex::postingCount(uint32_t trigram) const
+{
+    size_t entry = findTrigram(trigram);
+    return entry < trigramCount ? readTableUint32(trigramTable, entry * TRIGRAM_ENTRY_SIZE + 4) : 0;
+}
+
+void SourceIndex::readPostings(uint32_t trigram, std::vector<uint32_t>& sourceNumbers) const
+{
+    size_t entry = findTrigram(trigram);
+    if (entry == trigramCount)
+        return;
+
+    ByteReader entryReader(trigramTable.substr(entry * TRIGRAM_ENTRY_SIZE + 4, TRIGRAM_ENTRY_SIZE - 4));
+    uint32_t count = entryReader.readUint32();
+    uint64_t offset = entryReader.readUint64();
+    if (offset > postings.size())
+        return;
+
+    ByteReader reader(postings.substr(static_cast<size_t>(offset)));
+    uint32_t source = 0;
+    sourceNumbers.reserve(count);
+    for (uint32_t i = 0; i < count && !reader.failed(); i++)
+    {
+        source += reader.readVarint();
+        sourceNumbers.push_back(source);
+    }
+}
+
+void SourceIndex::findCandidates(const TextSearch& search, std::vector<uint32_t>& candidates) const
+{
+    std::vector<std::vector<EditorString>> groups;
+    search.requiredTexts(groups);
+
+    std::vector<uint32_t> groupCandidates;
+    std::vector<uint32_t> postingList;
+    std::vector<uint32_t> narrowed;
+    std::vector<uint32_t> merged;
+    for (auto& group : groups)
+    {
+        std::vector<uint32_t> trigrams;
+        for (auto& text : group)
+            forEachTrigram(text.data(), text.size(), [&trigrams](uint32_t trigram) { trigrams.push_back(trigram); });
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+        // Nothing is known about the group's matches, so any source can contain them
+        if (trigrams.empty())
+        {
+            candidates.resize(sourceList.size());
+            std::iota(candidates.begin(), candidates.end(), 0);
+            return;
+        }
+
+        // The rarest trigrams first, so the intersection shrinks fastest
+        std::vector<std::pair<uint32_t, uint32_t>> countedTrigrams;
+        for (uint32_t trigram : trigrams)
+            countedTrigrams.emplace_back(postingCount(trigram), trigram);
+        std::sort(countedTrigrams.begin(), countedTrigrams.end());
+
+        groupCandidates.clear();
+        for (size_t i = 0; i < countedTrigrams.size(); i++)
+        {
+            postingList.clear();
+            readPostings(countedTrigrams[i].second, postingList);
+            if (i == 0)
+            {
+                groupCandidates.swap(postingList);
+            }
+            else
+            {
+                narrowed.clear();
+                std::set_intersection(groupCandidates.begin(), groupCandidates.end(), postingList.begin(), postingList.end(),
+                    std::back_inserter(narrowed));
+                groupCandidates.swap(narrowed);
+            }
+            if (groupCandidates.empty())
+                break;
+        }
+
+        merged.clear();
+        std::set_union(candidates.begin(), candidates.end(), groupCandidates.begin(), groupCandidates.end(), std::back_inserter(merged));
+        candidates.swap(merged);
+    }
+}
+
+std::string getConnectedUser()
+{
+    const char* user;
+    const char* password;
+    const char* database;
+    IDE_GetConnectionInfo(&user, &password, &database);
+    std::string connectedUser = user != NULL ? user : "";
+    std::transform(connectedUser.begin(), connectedUser.end(), connectedUser.begin(), [](char c) {
+        return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+    });
+    return connectedUser;
+}
+
+// One file per schema and database
+std::wstring getSourceIndexFileName()
+{
+    const char* user;
+    const char* password;
+    const char* database;
+    IDE_GetConnectionInfo(&user, &password, &database);
+    std::string connection = getConnectedUser() + "@" + (database != NULL ? database : "");
+    uint64_t hash = hashBytes(connection.data(), connection.size());
+
+    std::wstring fileName = getPluginDataDirectory() + L"source-index-";
+    for (int shift = 60; shift >= 0; shift -= 4)
+        fileName += L"0123456789abcdef"[(hash >> shift) & 15];
+    return fileName + L".bin";
+}
+
+// Opens the index of the connected schema if it isn't yet
+SourceIndex& getSourceIndex()
+{
+    std::wstring fileName = getSourceIndexFileName();
+    if (fileName != sourceIndexFileName)
+    {
+        sourceIndex.open(fileName);
+        sourceIndexFileName = fileName;
+        sourceIndexUpdated = false;
+    }
+    return sourceIndex;
+}
+
+void updateSourceIndex()
+{
+    if (!IDE_Connected())
+    {
+        showMessage(L"Connect to the schema whose sources to index first.", MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    SourceIndex& index = getSourceIndex();
+    IDE_SplashCreate(0);
+    IDE_SplashWriteLn("Updating source index...");
+
+    struct SourceObject
+    {
+        std::string type;
+        std::string name;
+        std::string lastDdlTime;
+    };
+    std::vector<SourceObject> objects;
+    std::unordered_map<std::string, size_t> indexedSources;
+    for (size_t i = 0; i < index.sources().size(); i++)
+        indexedSources.emplace(sourceKey(index.sources()[i].type, index.sources()[i].name), i);
+    // Texts of the new and changed objects
+    std::unordered_map<std::string, std::string> changedTexts;
+    std::string error;
+    {
+        PluginSession session;
+        if (!session.isOpen())
+        {
+            IDE_SplashHide();
+            showMessage(L"Can't open the plug-in session to read the sources.", MB_OK | MB_ICONWARNING);
+            return;
+        }
+        bool success = queryRows(SOURCE_OBJECTS_SQL, [&objects] {
+            objects.push_back({ SQL_Field(0), SQL_Field(1), SQL_Field(2) });
+        });
+
+        // Objects indexed with the same LAST_DDL_TIME are unchanged
+        std::string changedSince;
+        for (auto& object : objects)
+        {
+            std::string key = sourceKey(object.type, object.name);
+            auto indexed = indexedSources.find(key);
+            if (indexed != indexedSources.end() && index.sources()[indexed->second].lastDdlTime == object.lastDdlTime)
+                continue;
+            changedTexts[key];
+            if (changedSince.empty() || object.lastDdlTime < changedSince)
+                changedSince = object.lastDdlTime;
+        }
+
+        if (success && !changedTexts.empty())
+        {
+            SQL_ClearVariables();
+            SQL_SetVariable("since", changedSince.c_str());
+            std::string previousKey;
+            std::string* text = nullptr;
+            success = queryRows(CHANGED_SOURCES_SQL, [&] {
+                // Rows come object by object
+                std::string key = sourceKey(SQL_Field(0), SQL_Field(1));
+                if (key != previousKey)
+                {
+                    auto changed = changedTexts.find(key);
+                    text = changed != changedTexts.end() ? &changed->second : nullptr;
+                    previousKey = std::move(key);
+                }
+                if (text != nullptr)
+                    *text += SQL_Field(2);
+            });
+            SQL_ClearVariables();
+        }
+        if (!success)
+            error = SQL_ErrorMessage();
+    }
+
+    if (!error.empty())
+    {
+        IDE_SplashHide();
+        showMessage(L"Can't read the sources:\n" + toEditorString(error), MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    // Nothing changed or was dropped
+    if (changedTexts.empty() && objects.size() == index.sources().size() && index.isOpen())
+    {
+        IDE_SplashHide();
+        sourceIndexUpdated = true;
+        IDE_SetStatusMessage("Source index is up to date");
+        return;
+    }
+
+    IDE_SplashWriteLn("Indexing...");
+    std::sort(objects.begin(), objects.end(), [](const SourceObject& a, const SourceObject& b) {
+        return a.type != b.type ? a.type < b.type : a.name < b.name;
+    });
+    std::vector<IndexedSource> sources;
+    sources.reserve(objects.size());
+    for (auto& object : objects)
+    {
+        std::string key = sourceKey(object.type, object.name);
+        auto changed = changedTexts.find(key);
+        std::string_view text = changed != changedTexts.end() ? changed->second : index.sources()[indexedSources[key]].text;
+        sources.push_back({ object.type, object.name, object.lastDdlTime, text });
+    }
+
+    // Unchanged texts are read from the old file, which can only be replaced once it's closed
+    std::wstring newFileName = sourceIndexFileName + L".new";
+    bool success = SourceIndex::write(newFileName, sources);
+    index.close();
+    if (success)
+        success = MoveFileEx(newFileName.c_str(), sourceIndexFileName.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+    index.open(sourceIndexFileName);
+    IDE_SplashHide();
+
+    if (!success)
+    {
+        DeleteFile(newFileName.c_str());
+        showMessage(L"Can't write the source index to " + sourceIndexFileName, MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    sourceIndexUpdated = true;
+    IDE_SetStatusMessage((std::to_string(changedTexts.size()) + " sources read, " + std::to_string(objects.size()) + " indexed").c_str());
+}
+
+const SourceIndex* getUpdatedSourceIndex()
+{
+    if (!IDE_Connected())
+    {
+        showMessage(L"Connect to the schema whose sources to use first.", MB_OK | MB_ICONWARNING);
+        return nullptr;
+    }
+
+    SourceIndex& index = getSourceIndex();
+    if (!sourceIndexUpdated)
+        updateSourceIndex();
+    return index.isOpen() ? &index : nullptr;
+}
+
+void editSchemaSource(std::string_view type, std::string_view name, size_t line, size_t column)
+{
+    if (!IDE_ObjectAction("EDIT", std::string(type).c_str(), getConnectedUser().c_str(), std::string(name).c_str()))
+    {
+        MessageBeep(MB_OK);
+        return;
+    }
+    IDE_SetCursor(static_cast<int>(column) + 1, static_cast<int>(line) + 1);
+    if (IDE_WindowHasEditor(false))
+        SendMessage(IDE_GetEditorHandle(), EM_SCROLLCARET, 0, 0);
+}
+
+void goToSourceMatch(size_t line)
+{
+    if (line >= sourceMatches.size())
+        return;
+
+    const SourceMatch& match = sourceMatches[line];
+    editSchemaSource(match.type, match.name, match.line, match.column);
+}
+
+void findInSchemaSources()
+{
+    if (!IDE_Connected())
+    {
+        showMessage(L"Connect to the schema whose sources to search first.", MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    const TextSearch* search = promptSearchQuery(L"Find in schema sources");
+    if (search == nullptr)
+        return;
+
+    const SourceIndex* index = getUpdatedSourceIndex();
+    if (index == nullptr)
+        return;
+
+    auto searchStart = std::chrono::steady_clock::now();
+    std::vector<uint32_t> candidates;
+    index->findCandidates(*search, candidates);
+
+    // Candidates are searched in parallel, in batches of similar size
+    typedef std::vector<std::pair<uint32_t, std::vector<ListedMatch>>> BatchMatches;
+    const std::vector<IndexedSource>& sources = index->sources();
+    std::vector<std::future<BatchMatches>> batches;
+    size_t batchStart = 0;
+    size_t batchBytes = 0;
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        batchBytes += sources[candidates[i]].text.size();
+        if (batchBytes < SEARCH_BATCH_BYTES && i + 1 < candidates.size())
+            continue;
+
+        batches.push_back(getWorkerPool().submit([&, batchStart, batchEnd = i + 1] {
+            BatchMatches batchMatches;
+            for (size_t j = batchStart; j < batchEnd; j++)
+            {
+                std::vector<ListedMatch> matches;
+                findListedMatches(*search, toEditorString(sources[candidates[j]].text), MAX_SOURCE_MATCHES, matches);
+                if (!matches.empty())
+                    batchMatches.emplace_back(candidates[j], std::move(matches));
+            }
+            return batchMatches;
+        }));
+        batchStart = i + 1;
+        batchBytes = 0;
+    }
+
+    sourceMatches.clear();
+    std::string report;
+    size_t matchedSourceCount = 0;
+    for (auto& batch : batches)
+    {
+        for (auto& [source, matches] : batch.get())
+        {
+            matchedSourceCount++;
+            std::string title = std::string(sources[source].type) + " " + std::string(sources[source].name);
+            for (size_t j = 0; j < matches.size() && sourceMatches.size() < MAX_SOURCE_MATCHES; j++)
+            {
+                sourceMatches.push_back({ std::string(sources[source].type), std::string(sources[source].name), matches[j].line, matches[j].column });
+                report += title + "(" + std::to_string(matches[j].line + 1) + "): " + matches[j].lineText + "\n";
+            }
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - searchStart);
+
+    std::wstring status = std::to_wstring(sourceMatches.size()) + L" matches in " + std::to_wstring(matchedSourceCount) + L" sources, "
+        + std::to_wstring(candidates.size()) + L" of " + std::to_wstring(sources.size()) + L" sources read in "
+        + std::to_wstring(elapsed.count()) + L" ms";
+    if (sourceMatches.empty())
+    {
+        IDE_SetStatusMessage(toAnsiString(status).c_str());
+        MessageBeep(MB_OK);
+        return;
+    }
+    if (sourceMatches.size() == MAX_SOURCE_MATCHES)
+        status += L", only the first " + std::to_wstring(MAX_SOURCE_MATCHES) + L" are listed";
+
+    static LogWindow resultsWindow(L"Find in schema sources", MAX_SOURCE_MATCHES, SOURCE_MATCHES_LOG_MAX_BYTES);
+    resultsWindow.setLineActivated(goToSourceMatch);
+    resultsWindow.show();
+    resultsWindow.append(report);
+    resultsWindow.setStatus(status);
+}
+
+void closeSourceIndex()
+{
+    sourceIndex.close();
+    sourceIndexFileName.clear();
+    sourceIndexUpdated = false;
+}
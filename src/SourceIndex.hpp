@@ -0,0 +1,65 @@
+#pragma once
+
+#include "pch.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "FileUtils.hpp"
+
+class TextSearch;
+
+struct IndexedSource
+{
+    std::string_view type;
+    std::string_view name;
+    // LAST_DDL_TIME as yyyymmddhh24miss, which tells when the source needs reading again
+    std::string_view lastDdlTime;
+    std::string_view text;
+};
+
+// Sources of the schema's PL/SQL objects in a memory-mapped file with a trigram index over them.
+//
+// Every trigram of ASCII characters, folded to uppercase, that appears in the sources has a list
+// of the sources containing it, stored as varint-encoded differences of their numbers. A search
+// intersects the lists of the trigrams of the texts its matches must contain, and only the
+// sources left are read and searched.
+class SourceIndex
+{
+public:
+    bool open(const std::wstring& fileName);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+
+    const std::vector<IndexedSource>& sources() const { return sourceList; }
+    // Numbers of the sources that can contain matches of the search, in ascending order
+    void findCandidates(const TextSearch& search, std::vector<uint32_t>& candidates) const;
+
+    // Indexes the sources, in parallel on the worker pool, and writes them to a new file.
+    static bool write(const std::wstring& fileName, const std::vector<IndexedSource>& sources);
+
+private:
+    void readPostings(uint32_t trigram, std::vector<uint32_t>& sourceNumbers) const;
+    uint32_t postingCount(uint32_t trigram) const;
+    // Index of the trigram's entry in the table, or trigramCount if it doesn't appear
+    size_t findTrigram(uint32_t trigram) const;
+
+    MappedFile file;
+    std::vector<IndexedSource> sourceList;
+    std::string_view trigramTable;
+    std::string_view postings;
+    size_t trigramCount = 0;
+};
+
+// Brings the index of the connected schema up to date, reading only the sources whose
+// LAST_DDL_TIME changed.
+void updateSourceIndex();
+// Index of the connected schema, updated if it wasn't yet since connecting, or nullptr after
+// telling why there's none
+const SourceIndex* getUpdatedSourceIndex();
+// Opens the connected schema's object in an editor with the caret at the 0-based position
+void editSchemaSource(std::string_view type, std::string_view name, size_t line, size_t column);
+// Searches the indexed sources, updating the index first if it wasn't yet since connecting.
+void findInSchemaSources();
+// Called when the connection changes
+void closeSourceIndex();
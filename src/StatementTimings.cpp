@@ -0,0 +1,367 @@
+#include "pch.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+#include "PlSqlDevFunctions.hpp"
+#include "BinaryIo.hpp"
+#include "BitUtils.hpp"
+#include "FileUtils.hpp"
+#include "Hash.hpp"
+#include "LogWindow.hpp"
+#include "PlSqlLexer.hpp"
+#include "StatementTimings.hpp"
+
+constexpr auto TIMINGS_FILE_NAME = L"statement-timings.bin";
+constexpr char TIMINGS_MAGIC[8] = { 'P', 'S', 'D', 'E', 'T', 'I', 'M', '1' };
+constexpr int HISTOGRAM_SUB_BUCKET_BITS = 4;
+constexpr uint64_t HISTOGRAM_SUB_BUCKETS = uint64_t(1) << HISTOGRAM_SUB_BUCKET_BITS;
+// Enough for any 64-bit value
+constexpr size_t MAX_HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS;
+constexpr size_t MAX_STORED_TEXT_LENGTH = 2000;
+constexpr size_t MAX_SHOWN_TEXT_LENGTH = 120;
+constexpr size_t REPORTED_STATEMENT_COUNT = 30;
+constexpr uint64_t MIN_REGRESSION_EXECUTIONS = 3;
+constexpr auto TIMINGS_SAVE_INTERVAL = std::chrono::minutes(1);
+constexpr size_t TIMINGS_LOG_MAX_LINES = 1000;
+constexpr size_t TIMINGS_LOG_MAX_BYTES = 1024 * 1024;
+
+struct StatementTiming
+{
+    // Normalized text, shown in the report
+    std::string text;
+    LatencyHistogram previous;
+    LatencyHistogram current;
+};
+
+std::unordered_map<uint64_t, StatementTiming> statementTimings;
+bool statementTimingsLoaded = false;
+bool statementTimingsChanged = false;
+std::chrono::steady_clock::time_point statementTimingsSaveTime;
+
+std::string editorStatement;
+std::chrono::steady_clock::time_point editorExecutionStart;
+
+size_t histogramBucket(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_BUCKETS)
+        return static_cast<size_t>(value);
+
+    int shift = static_cast<int>(highestSetBit(value)) - HISTOGRAM_SUB_BUCKET_BITS;
+    return static_cast<size_t>((shift + 1) * HISTOGRAM_SUB_BUCKETS + ((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1)));
+}
+
+// Middle of the range of values falling into the bucket
+uint64_t histogramBucketValue(size_t bucket)
+{
+    if (bucket < HISTOGRAM_SUB_BUCKETS)
+        return bucket;
+
+    int shift = static_cast<int>(bucket / HISTOGRAM_SUB_BUCKETS) - 1;
+    uint64_t lowest = (HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << shift;
+    return lowest + ((uint64_t(1) << shift) - 1) / 2;
+}
+
+void LatencyHistogram::record(uint64_t micros)
+{
+    size_t bucket = histogramBucket(micros);
+    if (bucket >= counts.size())
+        counts.resize(bucket + 1, 0);
+
+    counts[bucket]++;
+    totalCount++;
+    maxValue = std::max(maxValue, micros);
+}
+
+void LatencyHistogram::clear()
+{
+    counts.clear();
+    totalCount = 0;
+    maxValue = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double share) const
+{
+    if (totalCount == 0)
+        return 0;
+
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(share * totalCount)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < counts.size(); bucket++)
+    {
+        seen += counts[bucket];
+        if (seen >= rank)
+            return std::min(histogramBucketValue(bucket), maxValue);
+    }
+    return maxValue;
+}
+
+// Only buckets with values are stored, a handful for a typical statement
+void LatencyHistogram::write(std::string& output) const
+{
+    appendUint64(output, totalCount);
+    appendUint64(output, maxValue);
+    appendUint16(output, static_cast<uint16_t>(std::count_if(counts.begin(), counts.end(), [](uint32_t count) { return count > 0; })));
+    for (size_t bucket = 0; bucket < counts.size(); bucket++)
+    {
+        if (counts[bucket] == 0)
+            continue;
+        appendUint16(output, static_cast<uint16_t>(bucket));
+        appendUint32(output, counts[bucket]);
+    }
+}
+
+bool LatencyHistogram::read(ByteReader& reader)
+{
+    clear();
+    totalCount = reader.readUint64();
+    maxValue = reader.readUint64();
+    uint16_t bucketCount = reader.readUint16();
+    for (uint16_t i = 0; i < bucketCount; i++)
+    {
+        uint16_t bucket = reader.readUint16();
+        uint32_t count = reader.readUint32();
+        if (bucket >= MAX_HISTOGRAM_BUCKETS)
+            return false;
+        if (bucket >= counts.size())
+            counts.resize(bucket + 1, 0);
+        counts[bucket] = count;
+    }
+    return !reader.failed();
+}
+
+std::string normalizeStatement(std::string_view sql)
+{
+    std::string normalized;
+    normalized.reserve(sql.size());
+
+    BasicPlSqlLexer<char> lexer(sql.data(), sql.size());
+    Token token;
+    while (lexer.next(token))
+    {
+        std::string_view tokenText = sql.substr(token.offset, token.length);
+        switch (token.type)
+        {
+        case TokenType::Comment:
+            continue;
+
+        case TokenType::Number:
+        case TokenType::String:
+        case TokenType::BindVariable:
+            // "?, ?, ?" of IN lists and VALUES clauses becomes a single "?", so the statement
+            // keeps its fingerprint whatever the number of values
+            if (normalized.size() >= 3 && normalized.compare(normalized.size() - 3, 3, "? ,") == 0)
+            {
+                normalized.resize(normalized.size() - 2);
+                continue;
+            }
+            tokenText = "?";
+            break;
+
+        default:
+            break;
+        }
+
+        if (!normalized.empty())
+            normalized += ' ';
+
+        size_t tokenStart = normalized.size();
+        normalized.append(tokenText);
+        if (token.type == TokenType::Word)
+        {
+            for (size_t i = tokenStart; i < normalized.size(); i++)
+            {
+                if (normalized[i] >= 'a' && normalized[i] <= 'z')
+                    normalized[i] = static_cast<char>(normalized[i] - 'a' + 'A');
+            }
+        }
+    }
+
+    return normalized;
+}
+
+void loadStatementTimings()
+{
+    statementTimingsLoaded = true;
+    statementTimingsSaveTime = std::chrono::steady_clock::now();
+
+    std::string contents;
+    if (!readFile(getPluginDataDirectory() + TIMINGS_FILE_NAME, contents))
+        return;
+
+    ByteReader reader(contents);
+    if (reader.take(sizeof(TIMINGS_MAGIC)) != std::string_view(TIMINGS_MAGIC, sizeof(TIMINGS_MAGIC)))
+        return;
+
+    uint32_t statementCount = reader.readUint32();
+    for (uint32_t i = 0; i < statementCount && !reader.failed(); i++)
+    {
+        uint64_t fingerprint = reader.readUint64();
+        StatementTiming timing;
+        timing.text = reader.readBytes();
+        if (!timing.previous.read(reader) || !timing.current.read(reader))
+            break;
+        statementTimings[fingerprint] = std::move(timing);
+    }
+}
+
+void saveStatementTimings()
+{
+    if (!statementTimingsChanged)
+        return;
+
+    std::string contents(TIMINGS_MAGIC, sizeof(TIMINGS_MAGIC));
+    appendUint32(contents, static_cast<uint32_t>(statementTimings.size()));
+    for (auto& [fingerprint, timing] : statementTimings)
+    {
+        appendUint64(contents, fingerprint);
+        appendBytes(contents, timing.text);
+        timing.previous.write(contents);
+        timing.current.write(contents);
+    }
+
+    if (writeFile(getPluginDataDirectory() + TIMINGS_FILE_NAME, contents))
+        statementTimingsChanged = false;
+    statementTimingsSaveTime = std::chrono::steady_clock::now();
+}
+
+void recordStatementTiming(std::string_view sql, uint64_t micros)
+{
+    if (!statementTimingsLoaded)
+        loadStatementTimings();
+
+    std::string normalized = normalizeStatement(sql);
+    if (normalized.empty())
+        return;
+
+    auto& timing = statementTimings[hashBytes(normalized.data(), normalized.size())];
+    if (timing.text.empty())
+        timing.text = normalized.substr(0, MAX_STORED_TEXT_LENGTH);
+    timing.current.record(micros);
+    statementTimingsChanged = true;
+
+    if (std::chrono::steady_clock::now() - statementTimingsSaveTime > TIMINGS_SAVE_INTERVAL)
+        saveStatementTimings();
+}
+
+uint64_t elapsedMicros(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+int executeTimedSql(const char* sql)
+{
+    auto start = std::chrono::steady_clock::now();
+    int result = SQL_Execute(sql);
+    if (result == 0)
+        recordStatementTiming(sql, elapsedMicros(start));
+    return result;
+}
+
+void beginEditorExecution()
+{
+    // Executing with a selection runs just the selection
+    const char* selectedText = IDE_GetSelectedText();
+    const char* text = selectedText != NULL && *selectedText != '\0' ? selectedText : IDE_GetText();
+    editorStatement = text != NULL ? text : "";
+    editorExecutionStart = std::chrono::steady_clock::now();
+}
+
+void endEditorExecution(bool succeeded)
+{
+    if (succeeded && !editorStatement.empty())
+        recordStatementTiming(editorStatement, elapsedMicros(editorExecutionStart));
+    editorStatement.clear();
+}
+
+std::string formatDuration(uint64_t micros)
+{
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1);
+    if (micros < 1000)
+        text << micros << " us";
+    else if (micros < 1000000)
+        text << micros / 1000.0 << " ms";
+    else
+        text << micros / 1000000.0 << " s";
+    return text.str();
+}
+
+std::string shortenStatement(const std::string& text)
+{
+    return text.size() > MAX_SHOWN_TEXT_LENGTH ? text.substr(0, MAX_SHOWN_TEXT_LENGTH) + "..." : text;
+}
+
+void showStatementTimings()
+{
+    if (!statementTimingsLoaded)
+        loadStatementTimings();
+
+    std::vector<const StatementTiming*> slowest;
+    std::vector<std::pair<double, const StatementTiming*>> regressions;
+    for (auto& [fingerprint, timing] : statementTimings)
+    {
+        if (timing.current.count() > 0)
+            slowest.push_back(&timing);
+        if (timing.previous.count() >= MIN_REGRESSION_EXECUTIONS && timing.current.count() >= MIN_REGRESSION_EXECUTIONS)
+        {
+            double ratio = static_cast<double>(timing.current.percentile(0.5)) / std::max<uint64_t>(1, timing.previous.percentile(0.5));
+            if (ratio > 1)
+                regressions.emplace_back(ratio, &timing);
+        }
+    }
+
+    auto bySlowest = [](const StatementTiming* first, const StatementTiming* second) {
+        return first->current.percentile(0.95) > second->current.percentile(0.95);
+    };
+    size_t slowestCount = std::min(slowest.size(), REPORTED_STATEMENT_COUNT);
+    std::partial_sort(slowest.begin(), slowest.begin() + slowestCount, slowest.end(), bySlowest);
+    slowest.resize(slowestCount);
+    std::sort(regressions.begin(), regressions.end(), [](auto& first, auto& second) { return first.first > second.first; });
+    regressions.resize(std::min(regressions.size(), REPORTED_STATEMENT_COUNT));
+
+    std::ostringstream report;
+    report << "Slowest statements of the current period, by 95th percentile\n\n"
+        << std::setw(8) << "Count" << std::setw(11) << "Median" << std::setw(11) << "95%" << std::setw(11) << "Max" << "   Statement\n";
+    for (auto timing : slowest)
+    {
+        report << std::setw(8) << timing->current.count() << std::setw(11) << formatDuration(timing->current.percentile(0.5))
+            << std::setw(11) << formatDuration(timing->current.percentile(0.95)) << std::setw(11) << formatDuration(timing->current.max())
+            << "   " << shortenStatement(timing->text) << "\n";
+    }
+
+    report << "\nSlower than in the previous period, by median (" << MIN_REGRESSION_EXECUTIONS << "+ executions in both)\n\n"
+        << std::setw(8) << "Change" << std::setw(11) << "Before" << std::setw(11) << "Now" << std::setw(11) << "Count" << "   Statement\n";
+    for (auto& [ratio, timing] : regressions)
+    {
+        std::ostringstream change;
+        change << "+" << std::fixed << std::setprecision(0) << (ratio - 1) * 100 << "%";
+        report << std::setw(8) << change.str() << std::setw(11) << formatDuration(timing->previous.percentile(0.5))
+            << std::setw(11) << formatDuration(timing->current.percentile(0.5)) << std::setw(11) << timing->current.count()
+            << "   " << shortenStatement(timing->text) << "\n";
+    }
+
+    static LogWindow timingsWindow(L"Statement timings", TIMINGS_LOG_MAX_LINES, TIMINGS_LOG_MAX_BYTES);
+    timingsWindow.show();
+    timingsWindow.append(report.str());
+}
+
+void startStatementTimingPeriod()
+{
+    if (!statementTimingsLoaded)
+        loadStatementTimings();
+
+    for (auto& [fingerprint, timing] : statementTimings)
+    {
+        // Statements not run in the current period keep their older timings to compare against
+        if (timing.current.count() == 0)
+            continue;
+        timing.previous = std::move(timing.current);
+        timing.current.clear();
+    }
+
+    statementTimingsChanged = true;
+    saveStatementTimings();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ByteReader;
+
+// Log-linear latency histogram in the manner of HDR histograms: 16 buckets per power of two, so
+// a value read back is within 1/16 of the recorded one whatever its magnitude.
+class LatencyHistogram
+{
+public:
+    void record(uint64_t micros);
+    void clear();
+
+    uint64_t count() const { return totalCount; }
+    uint64_t max() const { return maxValue; }
+    // Value below which the given share (0 to 1) of the recorded values lie
+    uint64_t percentile(double share) const;
+
+    void write(std::string& output) const;
+    bool read(ByteReader& reader);
+
+private:
+    std::vector<uint32_t> counts;
+    uint64_t totalCount = 0;
+    uint64_t maxValue = 0;
+};
+
+// Reduces a statement to what identifies it regardless of the values it's run with: comments
+// dropped, literals and bind variables replaced by '?', lists of them collapsed to one, words
+// uppercased and tokens separated by single spaces.
+std::string normalizeStatement(std::string_view sql);
+
+// SQL_Execute that also records the execution time under the statement's fingerprint. The
+// plug-in runs all its statements through this.
+int executeTimedSql(const char* sql);
+
+// Time statements executed in editor windows, called from BeforeExecuteWindow and
+// AfterExecuteWindow.
+void beginEditorExecution();
+void endEditorExecution(bool succeeded);
+
+void showStatementTimings();
+// Starts a new period, e.g. after a deploy. Regressions are found by comparing executions of the
+// current period with the ones of the previous period.
+void startStatementTimingPeriod();
+void saveStatementTimings();
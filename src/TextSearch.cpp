@@ -0,0 +1,397 @@
+#include "pch.h"
+#include <intrin.h>
+#include <emmintrin.h>
+#include <algorithm>
+#include <cwctype>
+#include "TextSearch.hpp"
+
+constexpr size_t CHARACTER_COUNT = 0x10000;
+constexpr size_t VECTOR_CHARACTERS = sizeof(__m128i) / sizeof(EDITOR_CHAR);
+
+std::vector<EDITOR_CHAR> foldTable;
+// ASCII characters that other characters fold to as well, like I for the dotless i
+std::vector<bool> ambiguousFolds;
+
+// Uppercase of every UTF-16 code unit, by the same rules Windows compares text with
+const EDITOR_CHAR* getCaseFoldTable()
+{
+    if (foldTable.empty())
+    {
+        foldTable.resize(CHARACTER_COUNT);
+        for (size_t c = 0; c < CHARACTER_COUNT; c++)
+            foldTable[c] = static_cast<EDITOR_CHAR>(c);
+        CharUpperBuff(foldTable.data(), static_cast<DWORD>(foldTable.size()));
+    }
+    return foldTable.data();
+}
+
+const std::vector<bool>& getAmbiguousFolds()
+{
+    if (ambiguousFolds.empty())
+    {
+        const EDITOR_CHAR* caseFoldTable = getCaseFoldTable();
+        ambiguousFolds.resize(0x80);
+        for (size_t c = 0x80; c < CHARACTER_COUNT; c++)
+        {
+            if (caseFoldTable[c] < 0x80)
+                ambiguousFolds[caseFoldTable[c]] = true;
+        }
+    }
+    return ambiguousFolds;
+}
+
+bool isInBitmap(const std::vector<uint64_t>& bitmap, EDITOR_CHAR c)
+{
+    return (bitmap[c >> 6] >> (c & 63)) & 1;
+}
+
+bool TextSearch::compile(SearchMode searchMode, const std::vector<EditorString>& searchTerms, bool caseSensitive, std::wstring& error)
+{
+    mode = searchMode;
+    matchCase = caseSensitive;
+    caseFoldTable = matchCase ? nullptr : getCaseFoldTable();
+    terms.clear();
+    firstVariants.clear();
+    lastVariants.clear();
+    minimumTermLength = 0;
+    pattern.clear();
+    regex.reset();
+
+    if (mode == SearchMode::Regex)
+    {
+        pattern = searchTerms.empty() ? EditorString() : searchTerms[0];
+        auto flags = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+        if (!matchCase)
+            flags |= std::regex_constants::icase;
+        try
+        {
+            regex = std::make_unique<std::wregex>(pattern, flags);
+        }
+        catch (const std::regex_error& e)
+        {
+            error = L"Invalid regular expression: " + toEditorString(e.what());
+            return false;
+        }
+        return true;
+    }
+
+    for (auto& term : searchTerms)
+    {
+        if (term.empty())
+            continue;
+        Term folded;
+        folded.folded.resize(term.size());
+        std::transform(term.begin(), term.end(), folded.folded.begin(), [this](EDITOR_CHAR c) { return fold(c); });
+        terms.push_back(std::move(folded));
+    }
+    if (terms.empty())
+        return true;
+
+    std::sort(terms.begin(), terms.end(), [](const Term& a, const Term& b) {
+        return a.folded[0] != b.folded[0] ? a.folded[0] < b.folded[0] : a.folded.size() > b.folded.size();
+    });
+    minimumTermLength = std::min_element(terms.begin(), terms.end(), [](const Term& a, const Term& b) {
+        return a.folded.size() < b.folded.size();
+    })->folded.size();
+
+    firstBitmap.assign(CHARACTER_COUNT / 64, 0);
+    lastBitmap.assign(CHARACTER_COUNT / 64, 0);
+    auto addVariants = [this](std::vector<uint64_t>& bitmap, EDITOR_CHAR folded) {
+        if (matchCase)
+        {
+            bitmap[folded >> 6] |= uint64_t(1) << (folded & 63);
+            return;
+        }
+        for (size_t c = 0; c < CHARACTER_COUNT; c++)
+        {
+            if (caseFoldTable[c] == folded)
+                bitmap[c >> 6] |= uint64_t(1) << (c & 63);
+        }
+    };
+    for (auto& term : terms)
+    {
+        addVariants(firstBitmap, term.folded[0]);
+        addVariants(lastBitmap, term.folded[minimumTermLength - 1]);
+    }
+
+    auto collectVariants = [](const std::vector<uint64_t>& bitmap, std::vector<EDITOR_CHAR>& variants) {
+        for (size_t c = 0; c < CHARACTER_COUNT && variants.size() <= MAX_VECTOR_VARIANTS; c++)
+        {
+            if (isInBitmap(bitmap, static_cast<EDITOR_CHAR>(c)))
+                variants.push_back(static_cast<EDITOR_CHAR>(c));
+        }
+    };
+    collectVariants(firstBitmap, firstVariants);
+    collectVariants(lastBitmap, lastVariants);
+
+    return true;
+}
+
+bool TextSearch::findNext(EditorStringView text, size_t from, SearchMatch& match) const
+{
+    if (from > text.size())
+        return false;
+    return mode == SearchMode::Regex ? findRegex(text, from, match) : findLiteral(text, from, match);
+}
+
+void TextSearch::findAll(EditorStringView text, std::vector<SearchMatch>& matches) const
+{
+    SearchMatch match;
+    size_t from = 0;
+    while (findNext(text, from, match))
+    {
+        matches.push_back(match);
+        from = match.offset + match.length;
+    }
+}
+
+size_t TextSearch::countMatches(EditorStringView text) const
+{
+    size_t count = 0;
+    SearchMatch match;
+    size_t from = 0;
+    while (findNext(text, from, match))
+    {
+        count++;
+        from = match.offset + match.length;
+    }
+    return count;
+}
+
+EditorString TextSearch::formatReplacement(EditorStringView text, const SearchMatch& match, const EditorString& replacement) const
+{
+    if (mode != SearchMode::Regex || !regex)
+        return replacement;
+
+    // The match is repeated in its line, so lookaheads and \b see the same text as when it was found
+    const EDITOR_CHAR* data = text.data();
+    size_t lineEnd = text.find(EDT_TX('\n'), match.offset + match.length);
+    if (lineEnd == EditorStringView::npos)
+        lineEnd = text.size();
+    size_t contentEnd = lineEnd > match.offset && data[lineEnd - 1] == EDT_TX('\r') ? lineEnd - 1 : lineEnd;
+    auto flags = std::regex_constants::match_continuous | std::regex_constants::match_not_null;
+    if (match.offset > 0 && data[match.offset - 1] != EDT_TX('\n'))
+        flags |= std::regex_constants::match_prev_avail;
+    std::match_results<const EDITOR_CHAR*> result;
+    if (!std::regex_search(data + match.offset, data + std::max(contentEnd, match.offset + match.length), result, *regex, flags))
+        return replacement;
+    return result.format(replacement);
+}
+
+void TextSearch::requiredTexts(std::vector<std::vector<EditorString>>& groups) const
+{
+    if (mode != SearchMode::Regex)
+    {
+        for (auto& term : terms)
+        {
+            groups.emplace_back();
+            addRequiredText(term.folded, groups.back());
+        }
+        return;
+    }
+
+    // Literal characters of the regular expression that aren't optional. Groups, classes and
+    // alternatives are skipped rather than analyzed.
+    groups.emplace_back();
+    std::vector<EditorString>& group = groups.back();
+    if (pattern.find(EDT_TX('|')) != EditorString::npos)
+        return;
+
+    EditorString literal;
+    auto endLiteral = [&]() {
+        addRequiredText(literal, group);
+        literal.clear();
+    };
+    int depth = 0;
+    for (size_t i = 0; i < pattern.size(); i++)
+    {
+        EDITOR_CHAR c = pattern[i];
+        if (c == EDT_TX('\\'))
+        {
+            // Escaped punctuation is itself, escaped letters and digits are classes and the like
+            EDITOR_CHAR escaped = i + 1 < pattern.size() ? pattern[++i] : 0;
+            if (depth == 0 && escaped < 0x80 && escaped != 0 && !iswalnum(escaped) && escaped != EDT_TX('_'))
+                literal += escaped;
+            else
+                endLiteral();
+        }
+        else if (c == EDT_TX('('))
+        {
+            endLiteral();
+            depth++;
+        }
+        else if (c == EDT_TX(')'))
+        {
+            endLiteral();
+            depth = std::max(depth - 1, 0);
+        }
+        else if (c == EDT_TX('['))
+        {
+            endLiteral();
+            size_t classEnd = i + 1;
+            if (classEnd < pattern.size() && pattern[classEnd] == EDT_TX('^'))
+                classEnd++;
+            if (classEnd < pattern.size() && pattern[classEnd] == EDT_TX(']'))
+                classEnd++;
+            while (classEnd < pattern.size() && pattern[classEnd] != EDT_TX(']'))
+                classEnd += pattern[classEnd] == EDT_TX('\\') ? 2 : 1;
+            i = classEnd;
+        }
+        else if (c == EDT_TX('*') || c == EDT_TX('?') || c == EDT_TX('{'))
+        {
+            // The quantified character is optional, or repeated
+            if (!literal.empty())
+                literal.pop_back();
+            endLiteral();
+            if (c == EDT_TX('{'))
+            {
+                size_t quantifierEnd = pattern.find(EDT_TX('}'), i);
+                i = quantifierEnd == EditorString::npos ? pattern.size() : quantifierEnd;
+            }
+        }
+        else if (c == EDT_TX('+') || c == EDT_TX('.') || c == EDT_TX('^') || c == EDT_TX('$'))
+        {
+            endLiteral();
+        }
+        else if (depth == 0)
+        {
+            literal += c;
+        }
+    }
+    endLiteral();
+}
+
+// Splits the text at characters an index can't look up: non-ASCII ones and, when case doesn't
+// matter, ones other characters fold to
+void TextSearch::addRequiredText(EditorStringView text, std::vector<EditorString>& group) const
+{
+    const std::vector<bool>* ambiguous = matchCase ? nullptr : &getAmbiguousFolds();
+    size_t start = 0;
+    for (size_t i = 0; i <= text.size(); i++)
+    {
+        if (i < text.size() && text[i] < 0x80 && (ambiguous == nullptr || !(*ambiguous)[fold(text[i])]))
+            continue;
+        if (i > start)
+        {
+            EditorString part(text.substr(start, i - start));
+            if (!matchCase)
+                std::transform(part.begin(), part.end(), part.begin(), [this](EDITOR_CHAR c) { return fold(c); });
+            group.push_back(std::move(part));
+        }
+        start = i + 1;
+    }
+}
+
+bool TextSearch::matchTermAt(EditorStringView text, size_t position, SearchMatch& match) const
+{
+    EDITOR_CHAR first = fold(text[position]);
+    auto term = std::lower_bound(terms.begin(), terms.end(), first, [](const Term& term, EDITOR_CHAR c) { return term.folded[0] < c; });
+    for (; term != terms.end() && term->folded[0] == first; ++term)
+    {
+        size_t length = term->folded.size();
+        if (length > text.size() - position)
+            continue;
+
+        size_t i = 1;
+        while (i < length && fold(text[position + i]) == term->folded[i])
+            i++;
+        if (i == length)
+        {
+            match.offset = position;
+            match.length = length;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TextSearch::findLiteral(EditorStringView text, size_t from, SearchMatch& match) const
+{
+    if (minimumTermLength == 0 || text.size() < minimumTermLength)
+        return false;
+
+    const EDITOR_CHAR* data = text.data();
+    size_t lastOffset = minimumTermLength - 1;
+    // Positions a match can start at
+    size_t end = text.size() - lastOffset;
+    size_t i = from;
+
+    if (firstVariants.size() <= MAX_VECTOR_VARIANTS && lastVariants.size() <= MAX_VECTOR_VARIANTS)
+    {
+        __m128i firsts[MAX_VECTOR_VARIANTS];
+        __m128i lasts[MAX_VECTOR_VARIANTS];
+        for (size_t v = 0; v < firstVariants.size(); v++)
+            firsts[v] = _mm_set1_epi16(static_cast<short>(firstVariants[v]));
+        for (size_t v = 0; v < lastVariants.size(); v++)
+            lasts[v] = _mm_set1_epi16(static_cast<short>(lastVariants[v]));
+
+        for (; i + VECTOR_CHARACTERS <= end; i += VECTOR_CHARACTERS)
+        {
+            __m128i firstBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i lastBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + lastOffset));
+            __m128i firstEqual = _mm_cmpeq_epi16(firstBlock, firsts[0]);
+            for (size_t v = 1; v < firstVariants.size(); v++)
+                firstEqual = _mm_or_si128(firstEqual, _mm_cmpeq_epi16(firstBlock, firsts[v]));
+            __m128i lastEqual = _mm_cmpeq_epi16(lastBlock, lasts[0]);
+            for (size_t v = 1; v < lastVariants.size(); v++)
+                lastEqual = _mm_or_si128(lastEqual, _mm_cmpeq_epi16(lastBlock, lasts[v]));
+
+            // Two mask bits per character
+            unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(firstEqual, lastEqual)));
+            while (mask != 0)
+            {
+                unsigned long bit;
+                _BitScanForward(&bit, mask);
+                if (matchTermAt(text, i + bit / 2, match))
+                    return true;
+                mask &= ~(3u << bit);
+            }
+        }
+    }
+
+    for (; i < end; i++)
+    {
+        if (isInBitmap(firstBitmap, data[i]) && isInBitmap(lastBitmap, data[i + lastOffset]) && matchTermAt(text, i, match))
+            return true;
+    }
+    return false;
+}
+
+// Lines are searched one at a time, which keeps the backtracking of std::regex within a line
+// and lets ^ and $ match at line boundaries
+bool TextSearch::findRegex(EditorStringView text, size_t from, SearchMatch& match) const
+{
+    if (!regex)
+        return false;
+
+    const EDITOR_CHAR* data = text.data();
+    size_t lineStart = text.rfind(EDT_TX('\n'), from == 0 ? 0 : from - 1);
+    lineStart = lineStart == EditorStringView::npos || from == 0 ? 0 : lineStart + 1;
+    size_t searchStart = from;
+    while (true)
+    {
+        size_t lineEnd = text.find(EDT_TX('\n'), searchStart);
+        if (lineEnd == EditorStringView::npos)
+            lineEnd = text.size();
+        size_t contentEnd = lineEnd > lineStart && data[lineEnd - 1] == EDT_TX('\r') ? lineEnd - 1 : lineEnd;
+
+        if (searchStart <= contentEnd)
+        {
+            auto flags = std::regex_constants::match_not_null;
+            if (searchStart > lineStart)
+                flags |= std::regex_constants::match_prev_avail;
+            std::match_results<const EDITOR_CHAR*> result;
+            if (std::regex_search(data + searchStart, data + contentEnd, result, *regex, flags))
+            {
+                match.offset = searchStart + result.position(0);
+                match.length = result.length(0);
+                return true;
+            }
+        }
+
+        if (lineEnd == text.size())
+            return false;
+        lineStart = lineEnd + 1;
+        searchStart = lineStart;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+#include "EditorUtils.hpp"
+
+enum class SearchMode : uint8_t
+{
+    Literal,
+    // Any of several literal terms
+    AnyTerm,
+    // ECMAScript regular expression matched within lines
+    Regex,
+};
+
+struct SearchMatch
+{
+    size_t offset;
+    size_t length;
+};
+
+// Compiled search over the editor's UTF-16 text.
+//
+// Literal terms are searched with SSE2: 8 characters are compared at once against the possible
+// first characters of the terms and, minimumTermLength - 1 characters further, against the
+// possible characters at that position, and only positions where both match are verified. Case-
+// insensitive matching compares characters through a fold table covering all of UTF-16, the
+// possible characters being all that fold to the term's one. Several terms are verified in
+// buckets by their first character, longest first, so a scan finds the leftmost longest term.
+class TextSearch
+{
+public:
+    // Returns false and sets error if a regular expression doesn't compile.
+    bool compile(SearchMode mode, const std::vector<EditorString>& terms, bool matchCase, std::wstring& error);
+
+    // First match starting at or after from
+    bool findNext(EditorStringView text, size_t from, SearchMatch& match) const;
+    // All matches not overlapping a previous one
+    void findAll(EditorStringView text, std::vector<SearchMatch>& matches) const;
+    size_t countMatches(EditorStringView text) const;
+    // Text replacing a match found in text: the replacement itself, or for regular expressions the
+    // replacement with $&, $1 and the like substituted
+    EditorString formatReplacement(EditorStringView text, const SearchMatch& match, const EditorString& replacement) const;
+
+    // Texts of ASCII characters that matches contain, for narrowing down what to search with an
+    // index: every match contains all texts of one of the groups. A group without texts means
+    // nothing is known. Without matchCase the texts are uppercase and match any case.
+    void requiredTexts(std::vector<std::vector<EditorString>>& groups) const;
+
+private:
+    static constexpr size_t MAX_VECTOR_VARIANTS = 4;
+
+    struct Term
+    {
+        EditorString folded;
+    };
+
+    bool findLiteral(EditorStringView text, size_t from, SearchMatch& match) const;
+    bool findRegex(EditorStringView text, size_t from, SearchMatch& match) const;
+    bool matchTermAt(EditorStringView text, size_t position, SearchMatch& match) const;
+    void addRequiredText(EditorStringView text, std::vector<EditorString>& group) const;
+    EDITOR_CHAR fold(EDITOR_CHAR c) const { return matchCase ? c : caseFoldTable[c]; }
+
+    SearchMode mode = SearchMode::Literal;
+    bool matchCase = true;
+    const EDITOR_CHAR* caseFoldTable = nullptr;
+
+    // Terms sorted by their folded first character, longest first
+    std::vector<Term> terms;
+    size_t minimumTermLength = 0;
+    // Characters that can appear first and at minimumTermLength - 1 in a match
+    std::vector<EDITOR_CHAR> firstVariants;
+    std::vector<EDITOR_CHAR> lastVariants;
+    // The same as bitmaps for when there are too many variants to compare with vectors
+    std::vector<uint64_t> firstBitmap;
+    std::vector<uint64_t> lastBitmap;
+
+    EditorString pattern;
+    std::unique_ptr<std::wregex> regex;
+};
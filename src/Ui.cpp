@@ -0,0 +1,204 @@
+#include "pch.h"
+#include <commdlg.h>
+#include <cwchar>
+#include "PlSqlDevFunctions.hpp"
+#include "Ui.hpp"
+
+constexpr auto PLUGIN_CAPTION = L"Editor enhancements";
+constexpr auto INPUT_BOX_EDIT_ID = 100;
+
+// Builds a dialog template in memory so the plug-in needs no resource script
+class DialogTemplateBuilder
+{
+public:
+    DialogTemplateBuilder(const wchar_t* title, short width, short height, WORD itemCount)
+    {
+        addDword(WS_POPUP | WS_CAPTION | WS_SYSMENU | DS_MODALFRAME | DS_CENTER | DS_SETFONT);
+        addDword(0);
+        data.push_back(itemCount);
+        data.push_back(0);
+        data.push_back(0);
+        data.push_back(width);
+        data.push_back(height);
+        data.push_back(0); // no menu
+        data.push_back(0); // default dialog class
+        addString(title);
+        data.push_back(8);
+        addString(L"MS Shell Dlg");
+    }
+
+    void addItem(WORD classAtom, DWORD style, short x, short y, short width, short height, WORD id, const wchar_t* text)
+    {
+        // Items must start on a DWORD boundary
+        if (data.size() % 2 != 0)
+            data.push_back(0);
+
+        addDword(style | WS_CHILD | WS_VISIBLE);
+        addDword(0);
+        data.push_back(x);
+        data.push_back(y);
+        data.push_back(width);
+        data.push_back(height);
+        data.push_back(id);
+        data.push_back(0xFFFF);
+        data.push_back(classAtom);
+        addString(text);
+        data.push_back(0); // no creation data
+    }
+
+    const DLGTEMPLATE* get() const { return reinterpret_cast<const DLGTEMPLATE*>(data.data()); }
+
+private:
+    void addDword(DWORD value)
+    {
+        data.push_back(LOWORD(value));
+        data.push_back(HIWORD(value));
+    }
+
+    void addString(const wchar_t* text)
+    {
+        while (*text)
+            data.push_back(*text++);
+        data.push_back(0);
+    }
+
+    std::vector<WORD> data;
+};
+
+constexpr WORD DIALOG_CLASS_BUTTON = 0x0080;
+constexpr WORD DIALOG_CLASS_EDIT = 0x0081;
+constexpr WORD DIALOG_CLASS_STATIC = 0x0082;
+
+INT_PTR CALLBACK inputBoxProc(HWND dialog, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    switch (message)
+    {
+    case WM_INITDIALOG:
+    {
+        SetWindowLongPtr(dialog, GWLP_USERDATA, lParam);
+        auto value = reinterpret_cast<std::wstring*>(lParam);
+        HWND edit = GetDlgItem(dialog, INPUT_BOX_EDIT_ID);
+        SetWindowText(edit, value->c_str());
+        SendMessage(edit, EM_SETSEL, 0, -1);
+        SetFocus(edit);
+        return FALSE;
+    }
+    case WM_COMMAND:
+        switch (LOWORD(wParam))
+        {
+        case IDOK:
+        {
+            auto value = reinterpret_cast<std::wstring*>(GetWindowLongPtr(dialog, GWLP_USERDATA));
+            HWND edit = GetDlgItem(dialog, INPUT_BOX_EDIT_ID);
+            value->resize(GetWindowTextLength(edit) + 1);
+            value->resize(GetWindowText(edit, value->data(), static_cast<int>(value->size())));
+            EndDialog(dialog, IDOK);
+            return TRUE;
+        }
+        case IDCANCEL:
+            EndDialog(dialog, IDCANCEL);
+            return TRUE;
+        }
+        break;
+    }
+
+    return FALSE;
+}
+
+int showPopupList(HWND ownerWindow, POINT screenPosition, const std::vector<std::wstring>& items)
+{
+    if (items.empty())
+        return -1;
+
+    HMENU menu = CreatePopupMenu();
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        // Command 0 means "nothing picked", so items are numbered from 1
+        AppendMenu(menu, MF_STRING, i + 1, items[i].c_str());
+    }
+
+    int picked = TrackPopupMenu(menu, TPM_LEFTALIGN | TPM_TOPALIGN | TPM_RETURNCMD | TPM_NONOTIFY,
+        screenPosition.x, screenPosition.y, 0, ownerWindow, NULL);
+    DestroyMenu(menu);
+
+    return picked - 1;
+}
+
+bool showInputBox(const wchar_t* title, const wchar_t* prompt, std::wstring& value)
+{
+    DialogTemplateBuilder dialogTemplate(title, 240, 62, 4);
+    dialogTemplate.addItem(DIALOG_CLASS_STATIC, 0, 7, 7, 226, 10, 0xFFFF, prompt);
+    dialogTemplate.addItem(DIALOG_CLASS_EDIT, WS_BORDER | WS_TABSTOP | ES_AUTOHSCROLL, 7, 20, 226, 14, INPUT_BOX_EDIT_ID, L"");
+    dialogTemplate.addItem(DIALOG_CLASS_BUTTON, WS_TABSTOP | BS_DEFPUSHBUTTON, 129, 41, 50, 14, IDOK, L"OK");
+    dialogTemplate.addItem(DIALOG_CLASS_BUTTON, WS_TABSTOP | BS_PUSHBUTTON, 183, 41, 50, 14, IDCANCEL, L"Cancel");
+
+    std::wstring editedValue = value;
+    INT_PTR result = DialogBoxIndirectParam(GetModuleHandle(NULL), dialogTemplate.get(), IDE_GetWindowHandle(), inputBoxProc,
+        reinterpret_cast<LPARAM>(&editedValue));
+    if (result != IDOK)
+        return false;
+
+    value = editedValue;
+    return true;
+}
+
+bool showIntegerInputBox(const wchar_t* title, const wchar_t* prompt, int& value)
+{
+    std::wstring text = std::to_wstring(value);
+    if (!showInputBox(title, prompt, text))
+        return false;
+
+    wchar_t* end;
+    long parsed = std::wcstol(text.c_str(), &end, 10);
+    if (end == text.c_str() || parsed <= 0)
+        return false;
+
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+bool showOpenFileDialog(const wchar_t* filter, std::wstring& fileName)
+{
+    wchar_t fileNameBuffer[MAX_PATH] = L"";
+
+    OPENFILENAME openFileName = {};
+    openFileName.lStructSize = sizeof(openFileName);
+    openFileName.hwndOwner = IDE_GetWindowHandle();
+    openFileName.lpstrFilter = filter;
+    openFileName.lpstrFile = fileNameBuffer;
+    openFileName.nMaxFile = MAX_PATH;
+    openFileName.Flags = OFN_EXPLORER | OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST | OFN_HIDEREADONLY;
+    if (!GetOpenFileName(&openFileName))
+        return false;
+
+    fileName = fileNameBuffer;
+    return true;
+}
+
+bool showSaveFileDialog(const wchar_t* filter, std::wstring& fileName, int& filterIndex)
+{
+    wchar_t fileNameBuffer[MAX_PATH] = L"";
+    fileName.copy(fileNameBuffer, MAX_PATH - 1);
+
+    OPENFILENAME saveFileName = {};
+    saveFileName.lStructSize = sizeof(saveFileName);
+    saveFileName.hwndOwner = IDE_GetWindowHandle();
+    saveFileName.lpstrFilter = filter;
+    saveFileName.nFilterIndex = filterIndex + 1;
+    saveFileName.lpstrFile = fileNameBuffer;
+    saveFileName.nMaxFile = MAX_PATH;
+    // A non-null default extension makes the dialog append the one of the selected filter
+    saveFileName.lpstrDefExt = L"";
+    saveFileName.Flags = OFN_EXPLORER | OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT | OFN_HIDEREADONLY;
+    if (!GetSaveFileName(&saveFileName))
+        return false;
+
+    fileName = fileNameBuffer;
+    filterIndex = static_cast<int>(saveFileName.nFilterIndex) - 1;
+    return true;
+}
+
+void showMessage(const std::wstring& text, UINT type)
+{
+    MessageBox(IDE_GetWindowHandle(), text.c_str(), PLUGIN_CAPTION, type);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "pch.h"
+#include <string>
+#include <vector>
+
+// Shows a popup menu with the given items at a screen position and returns the index of the
+// picked item, or -1 if the menu was dismissed. Text after a tab is shown right-aligned.
+int showPopupList(HWND ownerWindow, POINT screenPosition, const std::vector<std::wstring>& items);
+
+// Modal single-line prompt. value holds the initial text and receives the entered one; returns
+// false if the user cancelled.
+bool showInputBox(const wchar_t* title, const wchar_t* prompt, std::wstring& value);
+
+// Same as showInputBox for positive integers; also returns false if the text isn't one.
+bool showIntegerInputBox(const wchar_t* title, const wchar_t* prompt, int& value);
+
+// Filter uses the OPENFILENAME format: pairs of null-terminated strings ending with an empty one.
+bool showOpenFileDialog(const wchar_t* filter, std::wstring& fileName);
+
+// filterIndex is the zero-based index of the initially selected filter and receives the picked
+// one. The extension of the picked filter is appended when the user doesn't type one.
+bool showSaveFileDialog(const wchar_t* filter, std::wstring& fileName, int& filterIndex);
+
+void showMessage(const std::wstring& text, UINT type = MB_OK | MB_ICONINFORMATION);
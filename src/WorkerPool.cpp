@@ -0,0 +1,59 @@
+#include "pch.h"
+#include <algorithm>
+#include "WorkerPool.hpp"
+
+std::unique_ptr<WorkerPool> sharedWorkerPool;
+
+WorkerPool::WorkerPool(size_t threadCount)
+{
+    for (size_t i = 0; i < std::max<size_t>(threadCount, 1); i++)
+        threads.emplace_back(&WorkerPool::run, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAdded.notify_all();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void WorkerPool::run()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAdded.wait(lock, [this] { return stopping || !tasks.empty(); });
+            // Queued tasks still run when stopping, so no future is left without a result
+            if (tasks.empty())
+                return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+WorkerPool& getWorkerPool()
+{
+    if (!sharedWorkerPool)
+    {
+        size_t coreCount = std::thread::hardware_concurrency();
+        sharedWorkerPool = std::make_unique<WorkerPool>(coreCount > 1 ? coreCount - 1 : 1);
+    }
+
+    return *sharedWorkerPool;
+}
+
+void shutdownWorkerPool()
+{
+    sharedWorkerPool.reset();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads picking queued tasks in submission order. Tasks must not call the IDE
+// callbacks, which are only safe on the IDE's main thread.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(size_t threadCount);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t threadCount() const { return threads.size(); }
+
+    template<typename Task>
+    auto submit(Task task) -> std::future<decltype(task())>
+    {
+        auto packagedTask = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
+        auto result = packagedTask->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace_back([packagedTask] { (*packagedTask)(); });
+        }
+        taskAdded.notify_one();
+        return result;
+    }
+
+private:
+    void run();
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAdded;
+    bool stopping = false;
+};
+
+// Shared pool with a thread per core but one, the remaining one being the IDE's. Created on
+// first use.
+WorkerPool& getWorkerPool();
+
+// Stable sort on the shared pool: ranges of the elements are sorted in parallel, then merged
+// in pairs, the merges of a round also in parallel. Not for use in the pool's tasks, which would
+// wait for tasks queued behind them.
+template<typename Iterator, typename Compare>
+void parallelSort(Iterator first, Iterator last, Compare compare)
+{
+    WorkerPool& pool = getWorkerPool();
+    size_t count = static_cast<size_t>(last - first);
+    size_t rangeCount = std::max<size_t>(1, std::min(pool.threadCount(), count / 4096));
+    std::vector<Iterator> bounds;
+    for (size_t i = 0; i < rangeCount; i++)
+        bounds.push_back(first + count * i / rangeCount);
+    bounds.push_back(last);
+
+    std::vector<std::future<void>> tasks;
+    for (size_t i = 0; i + 1 < bounds.size(); i++)
+        tasks.push_back(pool.submit([&bounds, i, compare] { std::stable_sort(bounds[i], bounds[i + 1], compare); }));
+    for (auto& task : tasks)
+        task.get();
+
+    while (bounds.size() > 2)
+    {
+        tasks.clear();
+        std::vector<Iterator> mergedBounds;
+        for (size_t i = 0; i + 2 < bounds.size(); i += 2)
+        {
+            tasks.push_back(pool.submit([&bounds, i, compare] { std::inplace_merge(bounds[i], bounds[i + 1], bounds[i + 2], compare); }));
+            mergedBounds.push_back(bounds[i]);
+        }
+        // An odd range out waits for the next round
+        if (bounds.size() % 2 == 0)
+            mergedBounds.push_back(bounds[bounds.size() - 2]);
+        mergedBounds.push_back(last);
+        for (auto& task : tasks)
+            task.get();
+        bounds = std::move(mergedBounds);
+    }
+}
+
+// Joins the shared pool's threads. Must happen before the DLL is unloaded, as threads can't be
+// joined while the loader lock is held.
+void shutdownWorkerPool();
@@ -2,4 +2,5 @@
 
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 #include <windows.h>
-#include <Richedit.h>
\ No newline at end of file
+#include <Richedit.h>
+#include <CommCtrl.h>
\ No newline at end of file
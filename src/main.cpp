@@ -7,22 +7,90 @@
 #include <algorithm>
 #include <string_view>
 #include "PlSqlDevFunctions.hpp"
-
-typedef WCHAR EDITOR_CHAR;
-#define EDT_TX(quote) L##quote
+#include "EditorUtils.hpp"
+#include "Plugin.hpp"
+#include "Autocomplete.hpp"
+#include "BatchExecution.hpp"
+#include "ScriptExecution.hpp"
+#include "GridExport.hpp"
+#include "ColumnStatistics.hpp"
+#include "StatementTimings.hpp"
+#include "CodeModel.hpp"
+#include "CodeSymbols.hpp"
+#include "BlockMatches.hpp"
+#include "EditorSearch.hpp"
+#include "SourceIndex.hpp"
+#include "CodeDuplicates.hpp"
+#include "CodeLint.hpp"
+#include "LineTransforms.hpp"
+#include "ColumnSelection.hpp"
+#include "KeywordCase.hpp"
+#include "EditJournal.hpp"
+#include "LocalHistory.hpp"
+#include "ClipboardRing.hpp"
+#include "ScriptRepository.hpp"
+#include "LargeScript.hpp"
+#include "WorkerPool.hpp"
 
 LRESULT CALLBACK getMsgProcHook(int nCode, WPARAM wParam, LPARAM lParam);
+LRESULT CALLBACK callWndProcHook(int nCode, WPARAM wParam, LPARAM lParam);
 void selectWord();
 void duplicateLine();
 void cutSelectionOrLine();
 void moveLinesDown();
 void moveLinesUp();
-char* searchString(char* str, char c);
 
 constexpr auto MENU_ITEM_INDEX_DUPLICATE_LINE = 1;
 constexpr auto MENU_ITEM_INDEX_CUT_SELECTION_OR_LINE = 2;
 constexpr auto MENU_ITEM_INDEX_MOVE_LINES_DOWN = 3;
 constexpr auto MENU_ITEM_INDEX_MOVE_LINES_UP = 4;
+constexpr auto MENU_ITEM_INDEX_COMPLETE_IDENTIFIER = 5;
+constexpr auto MENU_ITEM_INDEX_BATCH_EXECUTE_GRID = 6;
+constexpr auto MENU_ITEM_INDEX_BATCH_EXECUTE_CSV = 7;
+constexpr auto MENU_ITEM_INDEX_EXECUTE_WITH_OUTPUT = 8;
+constexpr auto MENU_ITEM_INDEX_COLUMN_STATISTICS = 9;
+constexpr auto MENU_ITEM_INDEX_STATEMENT_TIMINGS = 10;
+constexpr auto MENU_ITEM_INDEX_NEW_TIMING_PERIOD = 11;
+constexpr auto MENU_ITEM_INDEX_GO_TO_SYMBOL = 12;
+constexpr auto MENU_ITEM_INDEX_FIND = 13;
+constexpr auto MENU_ITEM_INDEX_FIND_NEXT = 14;
+constexpr auto MENU_ITEM_INDEX_HIGHLIGHT_ALL = 15;
+constexpr auto MENU_ITEM_INDEX_COUNT_MATCHES = 16;
+constexpr auto MENU_ITEM_INDEX_REPLACE_ALL = 17;
+constexpr auto MENU_ITEM_INDEX_JUMP_TO_MATCH = 18;
+constexpr auto MENU_ITEM_INDEX_SELECT_ENCLOSING_BLOCK = 19;
+constexpr auto MENU_ITEM_INDEX_FIND_IN_OPEN_WINDOWS = 20;
+constexpr auto MENU_ITEM_INDEX_FIND_IN_SCHEMA_SOURCES = 21;
+constexpr auto MENU_ITEM_INDEX_UPDATE_SOURCE_INDEX = 22;
+constexpr auto MENU_ITEM_INDEX_FIND_DUPLICATE_CODE = 23;
+constexpr auto MENU_ITEM_INDEX_LINT_FINDINGS = 24;
+constexpr auto MENU_ITEM_INDEX_SORT_LINES = 25;
+constexpr auto MENU_ITEM_INDEX_REMOVE_DUPLICATE_LINES = 26;
+constexpr auto MENU_ITEM_INDEX_REVERSE_LINES = 27;
+constexpr auto MENU_ITEM_INDEX_SHUFFLE_LINES = 28;
+constexpr auto MENU_ITEM_INDEX_NUMBER_LINES = 29;
+constexpr auto MENU_ITEM_INDEX_COLUMN_SELECTION = 30;
+constexpr auto MENU_ITEM_INDEX_UPPER_CASE_KEYWORDS = 31;
+constexpr auto MENU_ITEM_INDEX_LOWER_CASE_KEYWORDS = 32;
+constexpr auto MENU_ITEM_INDEX_TOGGLE_LINE_COMMENT = 33;
+constexpr auto MENU_ITEM_INDEX_TOGGLE_BLOCK_COMMENT = 34;
+constexpr auto MENU_ITEM_INDEX_SPLIT_LIST = 35;
+constexpr auto MENU_ITEM_INDEX_JOIN_LINES = 36;
+constexpr auto MENU_ITEM_INDEX_UNDO_LINE_MOVE = 37;
+constexpr auto MENU_ITEM_INDEX_REDO_LINE_MOVE = 38;
+constexpr auto MENU_ITEM_INDEX_LOCAL_HISTORY = 39;
+constexpr auto MENU_ITEM_INDEX_PASTE_FROM_CLIPBOARD_RING = 40;
+constexpr auto MENU_ITEM_INDEX_OPEN_FROM_SCRIPT_REPOSITORY = 41;
+constexpr auto MENU_ITEM_INDEX_SAVE_TO_SCRIPT_REPOSITORY = 42;
+constexpr auto MENU_ITEM_INDEX_IMPORT_INTO_SCRIPT_REPOSITORY = 43;
+constexpr auto MENU_ITEM_INDEX_OPEN_LARGE_SCRIPT = 44;
+constexpr auto MENU_ITEM_INDEX_NEXT_LARGE_SCRIPT_PART = 45;
+constexpr auto MENU_ITEM_INDEX_PREVIOUS_LARGE_SCRIPT_PART = 46;
+constexpr auto MENU_ITEM_INDEX_GO_TO_LARGE_SCRIPT_LINE = 47;
+constexpr auto MENU_ITEM_INDEX_EXECUTE_FILE_WITH_OUTPUT = 48;
+constexpr auto MENU_ITEM_INDEX_EXECUTE_STATEMENT_AT_CARET = 49;
+// AfterExecuteWindow results: 0 means an error, 1 a cancelled execution
+constexpr auto EXECUTE_RESULT_SUCCESS = 2;
 
 typedef std::initializer_list<std::basic_string_view<EDITOR_CHAR>> EditorPatternList;
 const EditorPatternList INDENT_AFTER_LINE = { EDT_TX("IF "), EDT_TX("IF("), EDT_TX("FOR "), EDT_TX("FOR("), EDT_TX("LOOP\n"), EDT_TX("DECLARE\n"),
@@ -32,8 +100,10 @@ const EditorPatternList INDENT_BEFORE_LINE = { EDT_TX("END;"), EDT_TX("END ") };
 
 
 HHOOK getMsgProcHookHandle;
+HHOOK callWndProcHookHandle;
 int cutMenuItem;
 int ideVersion;
+int pluginId;
 
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved)
 {
@@ -43,6 +113,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
 
 const char* IdentifyPlugIn(int nID)
 {
+    pluginId = nID;
     return "Editor enhancements";
 }
 
@@ -58,6 +129,96 @@ const char* CreateMenuItem(int nIndex)
         return "Edit/Enhancements/Move line down";
     case MENU_ITEM_INDEX_MOVE_LINES_UP:
         return "Edit/Enhancements/Move line up";
+    case MENU_ITEM_INDEX_COMPLETE_IDENTIFIER:
+        return "Edit/Enhancements/Complete identifier";
+    case MENU_ITEM_INDEX_BATCH_EXECUTE_GRID:
+        return "Edit/Enhancements/Batch execute with result grid binds";
+    case MENU_ITEM_INDEX_BATCH_EXECUTE_CSV:
+        return "Edit/Enhancements/Batch execute with CSV binds";
+    case MENU_ITEM_INDEX_EXECUTE_WITH_OUTPUT:
+        return "Edit/Enhancements/Execute with streamed output";
+    case MENU_ITEM_INDEX_COLUMN_STATISTICS:
+        return "Edit/Enhancements/Result grid column statistics";
+    case MENU_ITEM_INDEX_STATEMENT_TIMINGS:
+        return "Edit/Enhancements/Statement timings";
+    case MENU_ITEM_INDEX_NEW_TIMING_PERIOD:
+        return "Edit/Enhancements/Start new statement timing period";
+    case MENU_ITEM_INDEX_GO_TO_SYMBOL:
+        return "Edit/Enhancements/Go to symbol";
+    case MENU_ITEM_INDEX_FIND:
+        return "Edit/Enhancements/Find";
+    case MENU_ITEM_INDEX_FIND_NEXT:
+        return "Edit/Enhancements/Find next";
+    case MENU_ITEM_INDEX_HIGHLIGHT_ALL:
+        return "Edit/Enhancements/Highlight all matches";
+    case MENU_ITEM_INDEX_COUNT_MATCHES:
+        return "Edit/Enhancements/Count matches";
+    case MENU_ITEM_INDEX_REPLACE_ALL:
+        return "Edit/Enhancements/Replace all";
+    case MENU_ITEM_INDEX_JUMP_TO_MATCH:
+        return "Edit/Enhancements/Jump to match";
+    case MENU_ITEM_INDEX_SELECT_ENCLOSING_BLOCK:
+        return "Edit/Enhancements/Select enclosing block";
+    case MENU_ITEM_INDEX_FIND_IN_OPEN_WINDOWS:
+        return "Edit/Enhancements/Find in open windows";
+    case MENU_ITEM_INDEX_FIND_IN_SCHEMA_SOURCES:
+        return "Edit/Enhancements/Find in schema sources";
+    case MENU_ITEM_INDEX_UPDATE_SOURCE_INDEX:
+        return "Edit/Enhancements/Update schema source index";
+    case MENU_ITEM_INDEX_FIND_DUPLICATE_CODE:
+        return "Edit/Enhancements/Find duplicate code";
+    case MENU_ITEM_INDEX_LINT_FINDINGS:
+        return "Edit/Enhancements/Lint findings";
+    case MENU_ITEM_INDEX_SORT_LINES:
+        return "Edit/Enhancements/Sort lines";
+    case MENU_ITEM_INDEX_REMOVE_DUPLICATE_LINES:
+        return "Edit/Enhancements/Remove duplicate lines";
+    case MENU_ITEM_INDEX_REVERSE_LINES:
+        return "Edit/Enhancements/Reverse lines";
+    case MENU_ITEM_INDEX_SHUFFLE_LINES:
+        return "Edit/Enhancements/Shuffle lines";
+    case MENU_ITEM_INDEX_NUMBER_LINES:
+        return "Edit/Enhancements/Number lines";
+    case MENU_ITEM_INDEX_COLUMN_SELECTION:
+        return "Edit/Enhancements/Column selection";
+    case MENU_ITEM_INDEX_UPPER_CASE_KEYWORDS:
+        return "Edit/Enhancements/Keywords to upper case";
+    case MENU_ITEM_INDEX_LOWER_CASE_KEYWORDS:
+        return "Edit/Enhancements/Keywords to lower case";
+    case MENU_ITEM_INDEX_TOGGLE_LINE_COMMENT:
+        return "Edit/Enhancements/Toggle line comment";
+    case MENU_ITEM_INDEX_TOGGLE_BLOCK_COMMENT:
+        return "Edit/Enhancements/Toggle block comment";
+    case MENU_ITEM_INDEX_SPLIT_LIST:
+        return "Edit/Enhancements/Split list";
+    case MENU_ITEM_INDEX_JOIN_LINES:
+        return "Edit/Enhancements/Join lines";
+    case MENU_ITEM_INDEX_UNDO_LINE_MOVE:
+        return "Edit/Enhancements/Undo line move";
+    case MENU_ITEM_INDEX_REDO_LINE_MOVE:
+        return "Edit/Enhancements/Redo line move";
+    case MENU_ITEM_INDEX_LOCAL_HISTORY:
+        return "Edit/Enhancements/Local history";
+    case MENU_ITEM_INDEX_PASTE_FROM_CLIPBOARD_RING:
+        return "Edit/Enhancements/Paste from clipboard ring";
+    case MENU_ITEM_INDEX_OPEN_FROM_SCRIPT_REPOSITORY:
+        return "Edit/Enhancements/Open from script repository";
+    case MENU_ITEM_INDEX_SAVE_TO_SCRIPT_REPOSITORY:
+        return "Edit/Enhancements/Save to script repository";
+    case MENU_ITEM_INDEX_IMPORT_INTO_SCRIPT_REPOSITORY:
+        return "Edit/Enhancements/Import folder into script repository";
+    case MENU_ITEM_INDEX_OPEN_LARGE_SCRIPT:
+        return "Edit/Enhancements/Open large script";
+    case MENU_ITEM_INDEX_NEXT_LARGE_SCRIPT_PART:
+        return "Edit/Enhancements/Next large script part";
+    case MENU_ITEM_INDEX_PREVIOUS_LARGE_SCRIPT_PART:
+        return "Edit/Enhancements/Previous large script part";
+    case MENU_ITEM_INDEX_GO_TO_LARGE_SCRIPT_LINE:
+        return "Edit/Enhancements/Go to large script line";
+    case MENU_ITEM_INDEX_EXECUTE_FILE_WITH_OUTPUT:
+        return "Edit/Enhancements/Execute script file with streamed output";
+    case MENU_ITEM_INDEX_EXECUTE_STATEMENT_AT_CARET:
+        return "Edit/Enhancements/Execute statement at caret";
     }
 
     return "";
@@ -79,6 +240,141 @@ void OnMenuClick(int nIndex)
     case MENU_ITEM_INDEX_MOVE_LINES_UP:
         moveLinesUp();
         break;
+    case MENU_ITEM_INDEX_COMPLETE_IDENTIFIER:
+        completeIdentifier();
+        break;
+    case MENU_ITEM_INDEX_BATCH_EXECUTE_GRID:
+        batchExecuteFromResultGrid();
+        break;
+    case MENU_ITEM_INDEX_BATCH_EXECUTE_CSV:
+        batchExecuteFromCsvFile();
+        break;
+    case MENU_ITEM_INDEX_EXECUTE_WITH_OUTPUT:
+        executeScriptWithOutput();
+        break;
+    case MENU_ITEM_INDEX_COLUMN_STATISTICS:
+        showResultGridColumnStatistics();
+        break;
+    case MENU_ITEM_INDEX_STATEMENT_TIMINGS:
+        showStatementTimings();
+        break;
+    case MENU_ITEM_INDEX_NEW_TIMING_PERIOD:
+        startStatementTimingPeriod();
+        break;
+    case MENU_ITEM_INDEX_GO_TO_SYMBOL:
+        goToSymbol();
+        break;
+    case MENU_ITEM_INDEX_FIND:
+        findInEditor();
+        break;
+    case MENU_ITEM_INDEX_FIND_NEXT:
+        findNextInEditor();
+        break;
+    case MENU_ITEM_INDEX_HIGHLIGHT_ALL:
+        highlightAllInEditor();
+        break;
+    case MENU_ITEM_INDEX_COUNT_MATCHES:
+        countMatchesInEditor();
+        break;
+    case MENU_ITEM_INDEX_REPLACE_ALL:
+        replaceAllInEditor();
+        break;
+    case MENU_ITEM_INDEX_JUMP_TO_MATCH:
+        jumpToMatch();
+        break;
+    case MENU_ITEM_INDEX_SELECT_ENCLOSING_BLOCK:
+        selectEnclosingBlock();
+        break;
+    case MENU_ITEM_INDEX_FIND_IN_OPEN_WINDOWS:
+        findInOpenWindows();
+        break;
+    case MENU_ITEM_INDEX_FIND_IN_SCHEMA_SOURCES:
+        findInSchemaSources();
+        break;
+    case MENU_ITEM_INDEX_UPDATE_SOURCE_INDEX:
+        updateSourceIndex();
+        break;
+    case MENU_ITEM_INDEX_FIND_DUPLICATE_CODE:
+        findDuplicateCode();
+        break;
+    case MENU_ITEM_INDEX_LINT_FINDINGS:
+        showLintFindings();
+        break;
+    case MENU_ITEM_INDEX_SORT_LINES:
+        sortLines();
+        break;
+    case MENU_ITEM_INDEX_REMOVE_DUPLICATE_LINES:
+        removeDuplicateLines();
+        break;
+    case MENU_ITEM_INDEX_REVERSE_LINES:
+        reverseLines();
+        break;
+    case MENU_ITEM_INDEX_SHUFFLE_LINES:
+        shuffleLines();
+        break;
+    case MENU_ITEM_INDEX_NUMBER_LINES:
+        numberLines();
+        break;
+    case MENU_ITEM_INDEX_COLUMN_SELECTION:
+        startColumnSelection();
+        break;
+    case MENU_ITEM_INDEX_UPPER_CASE_KEYWORDS:
+        upperCaseKeywords();
+        break;
+    case MENU_ITEM_INDEX_LOWER_CASE_KEYWORDS:
+        lowerCaseKeywords();
+        break;
+    case MENU_ITEM_INDEX_TOGGLE_LINE_COMMENT:
+        toggleLineComment();
+        break;
+    case MENU_ITEM_INDEX_TOGGLE_BLOCK_COMMENT:
+        toggleBlockComment();
+        break;
+    case MENU_ITEM_INDEX_SPLIT_LIST:
+        splitList();
+        break;
+    case MENU_ITEM_INDEX_JOIN_LINES:
+        joinSelectedLines();
+        break;
+    case MENU_ITEM_INDEX_UNDO_LINE_MOVE:
+        undoLineMove();
+        break;
+    case MENU_ITEM_INDEX_REDO_LINE_MOVE:
+        redoLineMove();
+        break;
+    case MENU_ITEM_INDEX_LOCAL_HISTORY:
+        showLocalHistory();
+        break;
+    case MENU_ITEM_INDEX_PASTE_FROM_CLIPBOARD_RING:
+        pasteFromClipboardRing();
+        break;
+    case MENU_ITEM_INDEX_OPEN_FROM_SCRIPT_REPOSITORY:
+        openFromScriptRepository();
+        break;
+    case MENU_ITEM_INDEX_SAVE_TO_SCRIPT_REPOSITORY:
+        saveToScriptRepository();
+        break;
+    case MENU_ITEM_INDEX_IMPORT_INTO_SCRIPT_REPOSITORY:
+        importFolderToScriptRepository();
+        break;
+    case MENU_ITEM_INDEX_OPEN_LARGE_SCRIPT:
+        openLargeScript();
+        break;
+    case MENU_ITEM_INDEX_NEXT_LARGE_SCRIPT_PART:
+        showNextLargeScriptPart();
+        break;
+    case MENU_ITEM_INDEX_PREVIOUS_LARGE_SCRIPT_PART:
+        showPreviousLargeScriptPart();
+        break;
+    case MENU_ITEM_INDEX_GO_TO_LARGE_SCRIPT_LINE:
+        goToLargeScriptLine();
+        break;
+    case MENU_ITEM_INDEX_EXECUTE_FILE_WITH_OUTPUT:
+        executeScriptFileWithOutput();
+        break;
+    case MENU_ITEM_INDEX_EXECUTE_STATEMENT_AT_CARET:
+        executeStatementAtCaret();
+        break;
     }
 }
 
@@ -87,12 +383,83 @@ void OnActivate()
     ideVersion = SYS_Version();
     cutMenuItem = IDE_GetMenuItem(ideVersion >= 1200 ?  "edit / clipboard / cut" : "edit / cut"); // Not sure about exact version
     getMsgProcHookHandle = SetWindowsHookEx(WH_GETMESSAGE, getMsgProcHook, (HINSTANCE)NULL, GetCurrentThreadId());
+    callWndProcHookHandle = SetWindowsHookEx(WH_CALLWNDPROC, callWndProcHook, (HINSTANCE)NULL, GetCurrentThreadId());
+    startLocalHistory();
+    startClipboardRing();
 }
 
 void OnDeactivate()
 {
     if (getMsgProcHookHandle != NULL)
         UnhookWindowsHookEx(getMsgProcHookHandle);
+    if (callWndProcHookHandle != NULL)
+        UnhookWindowsHookEx(callWndProcHookHandle);
+    removeSearchHighlights();
+    removeColumnSelection();
+    stopLint();
+    stopLocalHistory();
+    stopClipboardRing();
+    closeScriptRepository();
+    closeLargeScript();
+    shutdownWorkerPool();
+    saveStatementTimings();
+}
+
+void OnConnectionChange()
+{
+    resetSchemaIdentifiers();
+    closeSourceIndex();
+}
+
+BOOL BeforeExecuteWindow(int windowType)
+{
+    beginEditorExecution();
+    return TRUE;
+}
+
+void AfterExecuteWindow(int windowType, int result)
+{
+    endEditorExecution(result == EXECUTE_RESULT_SUCCESS);
+}
+
+const char* RegisterFileSystem()
+{
+    return SCRIPT_REPOSITORY_NAME;
+}
+
+const char* DirectFileLoad(char* tag, char* fileName, int windowType)
+{
+    return loadRepositoryScript(fileName);
+}
+
+BOOL DirectFileSave(char* tag, char* fileName, int windowType)
+{
+    return saveRepositoryScript(tag, fileName, windowType);
+}
+
+const char* RegisterExport()
+{
+    return GRID_EXPORT_NAME;
+}
+
+BOOL ExportInit()
+{
+    return beginGridExport();
+}
+
+BOOL ExportPrepare()
+{
+    return prepareGridExport();
+}
+
+BOOL ExportData(char* value)
+{
+    return addGridExportCell(value);
+}
+
+void ExportFinished()
+{
+    finishGridExport();
 }
 
 void OnWindowCreated(int windowType)
@@ -102,6 +469,7 @@ void OnWindowCreated(int windowType)
     LRESULT mask = SendMessage(editorWindow, EM_GETEVENTMASK, 0, 0);
     SendMessage(editorWindow, EM_SETEVENTMASK, 0, mask | ENM_SELCHANGE | ENM_LINK | ENM_SCROLL | ENM_CHANGE | ENM_UPDATE);
     SendMessage(editorWindow, EM_AUTOURLDETECT, FALSE, NULL);
+    noteLintEdit();
 }
 
 
@@ -113,20 +481,44 @@ LRESULT CALLBACK getMsgProcHook(int nCode, WPARAM wParam, LPARAM lParam)
     if (nCode == HC_ACTION)
     {
         auto msg = reinterpret_cast<MSG*>(lParam);
+        // Peeked messages come again when they're removed
+        if (wParam == PM_REMOVE && handleColumnSelectionMessage(*msg))
+            msg->message = WM_NULL;
         switch (msg->message)
         {
         case WM_LBUTTONUP:
             selectWord();
             break;
+        case WM_KEYDOWN:
+            if (msg->wParam == VK_ESCAPE)
+                clearSearchHighlights(msg->hwnd);
+            break;
         }
     }
 
     return CallNextHookEx(NULL, nCode, wParam, lParam);
 }
 
-bool isWordCharacter(EDITOR_CHAR c)
+// Change notifications are sent, so they don't pass the WH_GETMESSAGE hook
+LRESULT CALLBACK callWndProcHook(int nCode, WPARAM wParam, LPARAM lParam)
 {
-    return std::isalnum(c) || c == EDT_TX('_') || c == EDT_TX('$') || c == EDT_TX('#');
+    if (nCode < 0)
+        return CallNextHookEx(NULL, nCode, wParam, lParam);
+
+    if (nCode == HC_ACTION)
+    {
+        auto msg = reinterpret_cast<CWPSTRUCT*>(lParam);
+        // Enabled by ENM_CHANGE in OnWindowCreated
+        if (msg->message == WM_COMMAND && HIWORD(msg->wParam) == EN_CHANGE)
+        {
+            noteEditorChanged(reinterpret_cast<HWND>(msg->lParam));
+            noteEditJournalEdit(reinterpret_cast<HWND>(msg->lParam));
+            clearSearchHighlights(reinterpret_cast<HWND>(msg->lParam));
+            noteLintEdit();
+        }
+    }
+
+    return CallNextHookEx(NULL, nCode, wParam, lParam);
 }
 
 void selectWord()
@@ -160,19 +552,8 @@ void selectWord()
     if (!isWordCharacter(lineBuffer[caretX]))
         return;
 
-    int selFromLineIdx = caretX;
-    int selToLineIdx = caretX;
-    while (++selToLineIdx < currLineLength)
-    {
-        if (!isWordCharacter(lineBuffer[selToLineIdx]))
-            break;
-    }
-    while (selFromLineIdx > 0)
-    {
-        if (!isWordCharacter(lineBuffer[selFromLineIdx - 1]))
-            break;
-        selFromLineIdx--;
-    }
+    int selFromLineIdx = findWordStart(lineBuffer.get(), caretX);
+    int selToLineIdx = findWordEnd(lineBuffer.get(), currLineLength, caretX);
 
     int selFrom = currLineCharIndex + selFromLineIdx;
     int selTo = currLineCharIndex + selToLineIdx;
@@ -246,6 +627,11 @@ bool checkLineIndentPattern(EDITOR_CHAR* textStart, EDITOR_CHAR* lineEnd, const
                 if (textStart + i == lineEnd)
                     break;
 
+                // A comment ends the code of the line, so BEGIN -- main still opens a block
+                if (textStart + i + 1 < lineEnd && ((textStart[i] == EDT_TX('-') && textStart[i + 1] == EDT_TX('-'))
+                    || (textStart[i] == EDT_TX('/') && textStart[i + 1] == EDT_TX('*'))))
+                    break;
+
                 if (textStart[i] != EDT_TX(' ') && textStart[i] != EDT_TX('\t'))
                 {
                     matching = false;
@@ -266,7 +652,7 @@ bool checkLineIndentPattern(EDITOR_CHAR* textStart, EDITOR_CHAR* lineEnd, const
                         break;
                     }
 
-                    if (std::toupper(textStart[i]) != pattern[i])
+                    if (toUpperAsciiChar(textStart[i]) != pattern[i])
                     {
                         matching = false;
                         break;
@@ -290,7 +676,7 @@ EDITOR_CHAR* findFirstNonWhiteChar(EDITOR_CHAR* str, EDITOR_CHAR* end, int& inde
         if (*str == EDT_TX(' '))
             indentValue++;
         else if (*str == EDT_TX('\t'))
-            indentValue += 3;
+            indentValue += EDITOR_TAB_WIDTH;
         else
             break;
 
@@ -403,6 +789,9 @@ void moveLines(bool moveUp)
         }
     }
 
+    // Leading whitespace of the moved lines before and after, for the edit journal
+    std::vector<EditorString> indentsBefore;
+    std::vector<EditorString> indentsAfter;
     for (int lineIdx = moveUp ? 1 : 0; lineIdx < lineToMoveCount + (moveUp ? 1 : 0); lineIdx++)
     {
         if(!moveUp)
@@ -410,27 +799,26 @@ void moveLines(bool moveUp)
 
         auto lineStart = linesToAlterBuffer.get() + lineToAlterRanges[lineIdx];
         auto lineEnd = linesToAlterBuffer.get() + lineToAlterRanges[lineIdx + 1];
+        int lineIndent;
+        auto lineTextStart = findFirstNonWhiteChar(lineStart, lineEnd, lineIndent);
+        indentsBefore.emplace_back(lineStart, lineTextStart);
         if (changeIndentation)
         {
-            ss.write(anchorLineStart, anchorLineTextStart - anchorLineStart);
-
-            int lineIndent;
-            auto lineTextStart = findFirstNonWhiteChar(lineStart, lineEnd, lineIndent);
+            EditorString indent(anchorLineStart, anchorLineTextStart);
             int additionalIndent = lineIndent - linesToMoveMinIndent;
 
             if (indentOneMore)
                 additionalIndent += 3;
 
-            for (size_t i = 0; i < additionalIndent; i++)
-            {
-                ss << ' ';
-            }
-
+            indent.append(additionalIndent, EDT_TX(' '));
+            ss << indent;
             ss.write(lineTextStart, lineEnd - lineTextStart);
+            indentsAfter.push_back(std::move(indent));
         }
         else
         {
             ss.write(lineStart, lineToAlterRanges[lineIdx + 1] - lineToAlterRanges[lineIdx]);
+            indentsAfter.push_back(indentsBefore.back());
         }
 
         if (moveUp)
@@ -441,14 +829,15 @@ void moveLines(bool moveUp)
         ss.write(anchorLineStart, lineToAlterRanges[anchorLineIndex + 1] - lineToAlterRanges[anchorLineIndex]);
 
 
-    int replacementStartLine = linesToAlterStart;
-    int replacementEndLine = linesToAlterStart + lineToAlterCount - 1;
-    int replacementEndLineLength = lineToAlterRanges[lineToAlterCount] - lineToAlterRanges[lineToAlterCount - 1];
-    int replacementStartCharIndex = SendMessage(editorWindow, EM_LINEINDEX, replacementStartLine, NULL);
-    int replacementEndCharIndex = SendMessage(editorWindow, EM_LINEINDEX, replacementEndLine, NULL) + replacementEndLineLength;
-    SendMessage(editorWindow, EM_SETSEL, replacementStartCharIndex, replacementEndCharIndex);
+    std::vector<EditorStringView> linesToAlter;
+    for (int i = 0; i < lineToAlterCount; i++)
+        linesToAlter.emplace_back(linesToAlterBuffer.get() + lineToAlterRanges[i], lineToAlterRanges[i + 1] - lineToAlterRanges[i]);
+    EditorString alteredText = ss.str();
 
-    SendMessage(editorWindow, EM_REPLACESEL, TRUE, reinterpret_cast<LPARAM>(ss.str().c_str()));
+    // Only the lines that changed are replaced, so the editor's undo keeps as little as it can
+    prepareEditJournal(editorWindow);
+    replaceChangedLines(editorWindow, linesToAlterStart, linesToAlter, splitLines(alteredText));
+    journalLineMove(editorWindow, selectionStartLine, lineToMoveCount, moveUp ? -1 : 1, std::move(indentsBefore), std::move(indentsAfter));
 
     cursorY += moveUp ? -1 : 1;
     IDE_SetCursor(cursorX + 1, cursorY + 1);
@@ -462,11 +851,4 @@ void moveLinesDown()
 void moveLinesUp()
 {
     moveLines(true);
-}
-
-char* searchString(char* str, char c)
-{
-    while (*str != c && *str != '\0')
-        ++str;
-    return str;
 }
\ No newline at end of file